@@ -0,0 +1,35 @@
+#!/bin/sh
+# Run the headless benchmark over every level and fail if any of them has got slower than the baseline.
+# This doesn't need a GPU, so it can run on a Linux build machine.
+#
+# Usage: Scripts/RunBenchmark.sh <Path to UE4Editor> [Baseline directory] [Extra arguments]
+# Results are written to Saved/Benchmarks. Copy them somewhere safe to use them as the next baseline.
+
+set -e
+
+EDITOR="$1"
+BASELINE="$2"
+if [ -z "$EDITOR" ]; then
+	echo "Usage: $0 <Path to UE4Editor> [Baseline directory] [Extra arguments]"
+	exit 2
+fi
+shift
+[ $# -gt 0 ] && shift
+
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+OUTPUT="$PROJECT_DIR/Saved/Benchmarks"
+rm -rf "$OUTPUT"
+
+BASELINE_ARG=""
+if [ -n "$BASELINE" ]; then
+	BASELINE_ARG="-BenchmarkBaseline=$(cd "$BASELINE" && pwd)"
+fi
+
+"$EDITOR" "$PROJECT_DIR/Golf.uproject" -game -nullrhi -nosound -unattended -nosplash -benchmark -fps=60 \
+	-UltraBallBenchmark -BenchmarkOutput="$OUTPUT" $BASELINE_ARG "$@"
+
+if [ -s "$OUTPUT/Regressions.txt" ]; then
+	echo "Performance regressions:"
+	cat "$OUTPUT/Regressions.txt"
+	exit 1
+fi
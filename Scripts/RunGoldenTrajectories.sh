@@ -0,0 +1,30 @@
+#!/bin/sh
+# Play the benchmark's scripted shots in deterministic mode and check every shot still follows its golden trajectory.
+# Pass Record to write the golden trajectories to GoldenTrajectories/ instead, and check the new files in.
+# Goldens are only comparable between runs on the same platform and engine build.
+#
+# Usage: Scripts/RunGoldenTrajectories.sh <Path to UE4Editor> [Record|Verify] [Extra arguments]
+
+set -e
+
+EDITOR="$1"
+MODE="${2:-Verify}"
+if [ -z "$EDITOR" ]; then
+	echo "Usage: $0 <Path to UE4Editor> [Record|Verify] [Extra arguments]"
+	exit 2
+fi
+shift
+[ $# -gt 0 ] && shift
+
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+OUTPUT="$PROJECT_DIR/Saved/GoldenTrajectories"
+rm -rf "$OUTPUT"
+
+"$EDITOR" "$PROJECT_DIR/Golf.uproject" -game -nullrhi -nosound -unattended -nosplash -benchmark -fps=60 \
+	-UltraBallBenchmark -BenchmarkOutput="$OUTPUT" -BenchmarkGolden="$MODE" -GoldenDir="$PROJECT_DIR/GoldenTrajectories" "$@"
+
+if [ -s "$OUTPUT/Regressions.txt" ]; then
+	echo "Shots that strayed from their golden trajectories:"
+	cat "$OUTPUT/Regressions.txt"
+	exit 1
+fi
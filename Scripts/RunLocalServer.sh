@@ -0,0 +1,40 @@
+#!/bin/sh
+# Run a dedicated server and some clients on this machine, to play online without a second machine.
+# Each client shows its network stats, so the bandwidth each ball uses can be read off while playing.
+#
+# Usage: Scripts/RunLocalServer.sh <Path to UE4Editor> <Map> [Number of clients] [Extra arguments]
+# The extra arguments are passed to the clients, for example -nullrhi to run them headless.
+
+set -e
+
+EDITOR="$1"
+MAP="$2"
+CLIENTS="${3:-2}"
+if [ -z "$EDITOR" ] || [ -z "$MAP" ]; then
+	echo "Usage: $0 <Path to UE4Editor> <Map> [Number of clients] [Extra arguments]"
+	exit 2
+fi
+shift 2
+[ $# -gt 0 ] && shift
+
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+PORT=7777
+
+"$EDITOR" "$PROJECT_DIR/Golf.uproject" "$MAP?game=/Script/Golf.GolfGameModeBase" -server -log -unattended -port=$PORT &
+SERVER=$!
+trap 'kill $SERVER 2>/dev/null' EXIT INT TERM
+
+# Give the server time to load the map before the clients connect.
+sleep 10
+
+CLIENT_PIDS=""
+i=0
+while [ $i -lt "$CLIENTS" ]; do
+	"$EDITOR" "$PROJECT_DIR/Golf.uproject" 127.0.0.1:$PORT -game -windowed -ResX=960 -ResY=540 -WinX=$((i * 40)) -WinY=$((i * 40)) \
+		-nosound -ExecCmds="stat net" "$@" &
+	CLIENT_PIDS="$CLIENT_PIDS $!"
+	i=$((i + 1))
+done
+
+# Stop the server once every client has been closed.
+wait $CLIENT_PIDS
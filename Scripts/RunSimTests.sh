@@ -0,0 +1,29 @@
+#!/bin/sh
+# Build and run the simulation tests. The simulation doesn't use the engine, so this only needs a C++17 compiler.
+# The reference scene's shots are checked against Tests/Simulation/Goldens/ReferenceScene.csv. Pass Record to write it
+# again after a change that is meant to alter how UltraBall moves, and check in the new file.
+#
+# Usage: Scripts/RunSimTests.sh [Compiler] [Record]
+# The compiler defaults to $CXX, or c++ if that isn't set.
+
+set -e
+
+CXX="${1:-${CXX:-c++}}"
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+SIM_DIR="$PROJECT_DIR/Source/Golf/Simulation"
+GOLDEN_FILE="$PROJECT_DIR/Tests/Simulation/Goldens/ReferenceScene.csv"
+OUTPUT="$(mktemp -d)"
+trap 'rm -rf "$OUTPUT"' EXIT
+
+# Fused multiply-adds would round differently on different machines, so they are kept off to match the goldens everywhere.
+"$CXX" -std=c++17 -O2 -ffp-contract=off -Wall -Wextra -Werror -I"$SIM_DIR" \
+	"$PROJECT_DIR/Tests/Simulation/UltraBallSimTests.cpp" "$SIM_DIR/UltraBallSim.cpp" "$SIM_DIR/BatchIntegrator.cpp" \
+	"$SIM_DIR/Replay.cpp" "$SIM_DIR/MappedFile.cpp" "$SIM_DIR/LevelSnapshot.cpp" \
+	"$SIM_DIR/DistanceField.cpp" "$SIM_DIR/SimThreadPool.cpp" "$SIM_DIR/ParSolver.cpp" -pthread \
+	-o "$OUTPUT/UltraBallSimTests"
+
+if [ "$2" = "Record" ]; then
+	mkdir -p "$(dirname "$GOLDEN_FILE")"
+fi
+# Scratch files written by the tests go in the output folder, so they are removed with it.
+TMPDIR="$OUTPUT" "$OUTPUT/UltraBallSimTests" "$GOLDEN_FILE" $2
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BakeDistanceFieldCommandlet.h"
+#include "Misc/Paths.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Simulation/DistanceField.h"
+#include "DistanceFieldSubsystem.h"
+#include "SimWorldBuilder.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogBakeDistanceField, Log, All);
+
+UBakeDistanceFieldCommandlet::UBakeDistanceFieldCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UBakeDistanceFieldCommandlet::Main(const FString& Params)
+{
+	FString LevelFilter;
+	FParse::Value(*Params, TEXT("Level="), LevelFilter);
+
+	// The band has to reach past UltraBall's radius plus the distance it can cover between two queries.
+	float VoxelSize = 25.0f;
+	float Band = 120.0f;
+	FParse::Value(*Params, TEXT("VoxelSize="), VoxelSize);
+	FParse::Value(*Params, TEXT("Band="), Band);
+
+	int32 NumThreads = 0;
+	FParse::Value(*Params, TEXT("Threads="), NumThreads);
+	FSimThreadPool ThreadPool(NumThreads);
+
+	TArray<FString> LevelFiles;
+	FSimWorldBuilder::FindLevelFiles(LevelFiles);
+
+	int32 NumFailed = 0;
+	for (const FString& LevelFile : LevelFiles)
+	{
+		const FString LevelName = FPaths::GetBaseFilename(LevelFile);
+		if (!LevelFilter.IsEmpty() && LevelName != LevelFilter)
+			continue;
+
+		FSimSettings SimSettings;
+		FSimWorld SimWorld;
+		FSimLevelInfo LevelInfo;
+		if (!FSimWorldBuilder::BuildLevel(LevelFile, SimSettings, SimWorld, LevelInfo))
+		{
+			NumFailed++;
+			UE_LOG(LogBakeDistanceField, Warning, TEXT("%s: Could not load the level."), *LevelName);
+			continue;
+		}
+
+		const FString FieldFile = UDistanceFieldSubsystem::GetDistanceFieldFile(LevelName);
+		IFileManager::Get().MakeDirectory(*FPaths::GetPath(FieldFile), true);
+
+		const double StartTime = FPlatformTime::Seconds();
+		if (!FSimDistanceField::Bake(TCHAR_TO_UTF8(*FieldFile), SimWorld, VoxelSize, Band, ThreadPool))
+		{
+			NumFailed++;
+			UE_LOG(LogBakeDistanceField, Warning, TEXT("%s: Could not bake %s."), *LevelName, *FieldFile);
+			continue;
+		}
+
+		UE_LOG(LogBakeDistanceField, Display, TEXT("%s: Baked %s (%lld KB) in %.1fs."),
+			*LevelName, *FieldFile, IFileManager::Get().FileSize(*FieldFile) / 1024, FPlatformTime::Seconds() - StartTime);
+	}
+
+	return NumFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BakeDistanceFieldCommandlet.generated.h"
+
+/**
+ * Bakes a Distance Field of every level under Content/Levels into Content/DistanceFields. Run this before cooking.
+ *
+ * Usage: UE4Editor-Cmd.exe Golf.uproject -run=BakeDistanceField [-Level=Name] [-VoxelSize=25] [-Band=120] [-Threads=0]
+ */
+UCLASS()
+class UBakeDistanceFieldCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UBakeDistanceFieldCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -3,6 +3,7 @@
 #include "Ball.h"
 #include "UObject/ConstructorHelpers.h" 
 #include "Components/StaticMeshComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
 #include "Components/InputComponent.h" 
 #include "Components/PointLightComponent.h" 
 #include "Components/AudioComponent.h"
@@ -12,12 +13,51 @@
 #include <Runtime/Engine/Classes/Engine/Engine.h>
 #include "Kismet/GameplayStatics.h"
 #include "PhysicsEngine/BodySetup.h"
+#include "PhysicsEngine/BodyInstance.h"
+#include "Physics/PhysicsInterfaceCore.h"
 #include "TimerManager.h"
+#include "Net/UnrealNetwork.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "Misc/ScopeLock.h"
+#include "GravityWell.h"
+#include "UltraBallSimTypes.h"
+#include "DistanceFieldSubsystem.h"
+#include "GolfPerf.h"
+#include "GolfMemory.h"
+#include "GolfDeterminism.h"
+#include "ReplaySubsystem.h"
+#include "BallManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Ball Predictor"), STAT_BallPredictor, STATGROUP_UltraBall);
+DECLARE_CYCLE_STAT(TEXT("Ball Uncertainty Markers"), STAT_BallUncertaintyMarkers, STATGROUP_UltraBall);
+DECLARE_CYCLE_STAT(TEXT("Ball Mesh Swap"), STAT_BallMeshSwap, STATGROUP_UltraBall);
+DECLARE_CYCLE_STAT(TEXT("Ball Zone Forces"), STAT_BallZoneForces, STATGROUP_UltraBall);
+DECLARE_CYCLE_STAT(TEXT("Ball OnHit"), STAT_BallOnHit, STATGROUP_UltraBall);
+DECLARE_CYCLE_STAT(TEXT("Ball Reconcile"), STAT_BallReconcile, STATGROUP_UltraBall);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ball Hits"), STAT_BallHits, STATGROUP_UltraBall);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ball Impact Sounds"), STAT_BallImpactSounds, STATGROUP_UltraBall);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ball Reconcile Snaps"), STAT_BallReconcileSnaps, STATGROUP_UltraBall);
+
+DEFINE_LOG_CATEGORY_STATIC(LogBall, Log, All);
+
+// Contacts with a surface facing at least this far upwards count as touching the ground.
+static const float GroundContactMinNormalZ = 0.7f;
+
+// Name of the charge parameter on UltraBall's material. The others are written by the Ball Manager.
+static const FName PowerParameterName(TEXT("Power"));
+
+// How long a client waits for the server to fire its shot before giving up on it. The server doesn't fire shots it wouldn't have allowed.
+static const float MaxShotConfirmTime = 1.0f;
 
 ABall::ABall()
 {
- 	// Set this pawn to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	GOLF_LLM_SCOPE(BallAssets);
+
+ 	// UltraBall is ticked by the Ball Manager along with every other ball, so it doesn't tick itself.
+	PrimaryActorTick.bCanEverTick = false;
+	Manager = nullptr;
+	BallIndex = INDEX_NONE;
 
 	// Setup static mesh for UltraBall
 	UltraBall = CreateDefaultSubobject<UStaticMeshComponent>("UltraBall");
@@ -39,35 +79,48 @@ ABall::ABall()
 	UltraBall->SetAngularDamping(2.0f);
 	RootComponent = UltraBall;
 
+	// Setup the Sphere Colider. This is welded onto UltraBall's body at the start of play,
+	// so swapping between the Sphere and Dodecahedron Coliders doesn't have to rebuild the body.
+	SimpleColider = CreateDefaultSubobject<USphereComponent>("SimpleColider");
+	SimpleColider->SetSimulatePhysics(false);
+	SimpleColider->SetCollisionProfileName(UltraBall->GetCollisionProfileName());
+	SimpleColider->SetNotifyRigidBodyCollision(true);
+	SimpleColider->OnComponentHit.AddDynamic(this, &ABall::OnHit);
+	SimpleColider->SetHiddenInGame(true);
+	SimpleColider->SetupAttachment(RootComponent);
+
 	// Apply the Dynamic Material to UltraBall.
 	ConstructorHelpers::FObjectFinder<UMaterialInstance> Material(TEXT("MaterialInstanceConstant'/Game/Textures/MaterialInstance/UltraBall_MI.UltraBall_MI'"));
 	if (Material.Succeeded())
 		UltraBall->SetMaterial(0, Material.Object);
 
-	// Setup the six Predictor rings used to show where the UltraBall will go when fired.
-	PredictorRing01 = CreateDefaultSubobject<UStaticMeshComponent>("PredictorRing01");
-	SetupRing(PredictorRing01);
-	PredictorArray.Add(PredictorRing01);
-
-	PredictorRing02 = CreateDefaultSubobject<UStaticMeshComponent>("PredictorRing02");
-	SetupRing(PredictorRing02);
-	PredictorArray.Add(PredictorRing02);
-
-	PredictorRing03 = CreateDefaultSubobject<UStaticMeshComponent>("PredictorRing03");
-	SetupRing(PredictorRing03);
-	PredictorArray.Add(PredictorRing03);
-
-	PredictorRing04 = CreateDefaultSubobject<UStaticMeshComponent>("PredictorRing04");
-	SetupRing(PredictorRing04);
-	PredictorArray.Add(PredictorRing04);
-
-	PredictorRing05 = CreateDefaultSubobject<UStaticMeshComponent>("PredictorRing05");
-	SetupRing(PredictorRing05);
-	PredictorArray.Add(PredictorRing05);
-
-	PredictorRing06 = CreateDefaultSubobject<UStaticMeshComponent>("PredictorRing06");
-	SetupRing(PredictorRing06);
-	PredictorArray.Add(PredictorRing06);
+	// Setup the Predictor Rings used to show where the UltraBall will go when fired.
+	// The rings are placed in world space, so they don't follow UltraBall as it moves.
+	PredictorRings = CreateDefaultSubobject<UInstancedStaticMeshComponent>("PredictorRings");
+	static ConstructorHelpers::FObjectFinder<UStaticMesh> PredictorRing(TEXT("StaticMesh'/Game/Models/M_aim_guide.M_aim_guide'"));
+	if (PredictorRing.Succeeded())
+		PredictorRings->SetStaticMesh(PredictorRing.Object);
+	PredictorRings->SetSimulatePhysics(false);
+	PredictorRings->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	PredictorRings->SetGenerateOverlapEvents(false);
+	PredictorRings->SetCanEverAffectNavigation(false);
+	PredictorRings->SetCastShadow(false);
+	PredictorRings->SetVisibility(false);
+	PredictorRings->SetAbsolute(true, true, true);
+	PredictorRings->SetupAttachment(RootComponent);
+
+	// Setup the Uncertainty Markers. These use the same mesh as the Predictor Rings, drawn smaller.
+	UncertaintyMarkers = CreateDefaultSubobject<UInstancedStaticMeshComponent>("UncertaintyMarkers");
+	if (PredictorRing.Succeeded())
+		UncertaintyMarkers->SetStaticMesh(PredictorRing.Object);
+	UncertaintyMarkers->SetSimulatePhysics(false);
+	UncertaintyMarkers->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	UncertaintyMarkers->SetGenerateOverlapEvents(false);
+	UncertaintyMarkers->SetCanEverAffectNavigation(false);
+	UncertaintyMarkers->SetCastShadow(false);
+	UncertaintyMarkers->SetVisibility(false);
+	UncertaintyMarkers->SetAbsolute(true, true, true);
+	UncertaintyMarkers->SetupAttachment(RootComponent);
 
 	// Setup the Sound Component that is called when the ball colides with the floor.
 	Sound = CreateDefaultSubobject<UAudioComponent>("Sound");
@@ -99,179 +152,249 @@ ABall::ABall()
 	SpeedAtWhichMeshTransitionsBackToComplex = 300.0f;	// The Speed/Velocity at which to Swap Back to a Complex Mesh from a Simple Mesh.
 	MaxParAllowed = 20;									// The Maximum Allowed Par to win the Level
 	isLastLevel = false;								// Whether this UltraBall is on the last level.
+	RestTickInterval = 0.5f;							// How often UltraBall ticks while it is resting.
+	GroundContactFallbackTicks = 4;						// How many ticks without a ground contact before tracing for the ground.
+	MinTimeBetweenImpactSounds = 0.1f;					// How long before the same surface can play the bounce sound again.
+	PredictorRingCount = 6;								// How many Predictor Rings are drawn.
+	PredictorRingSpacing = 250.0f;						// The distance between each Predictor Ring.
+	PredictorLocationTolerance = 1.0f;					// How far UltraBall can move before the predictor is re-traced.
+	PredictorVelocityTolerance = 1.0f;					// How far the launch velocity can change before the predictor is re-traced.
+	PredictorMaxBounces = 3;							// How many bounces and zones the predictor follows.
+	isPredictorUsingDistanceField = true;				// Whether the predictor uses the level's Distance Field when it has one.
+	UncertaintySampleCount = 256;						// How many slightly different shots are simulated.
+	UncertaintyDirectionSpread = 3.0f;					// How far in degrees a shot can stray from the aimed direction.
+	UncertaintyChargeSpread = 0.05f;					// How far the charge can stray, as a fraction of the current charge.
+	UncertaintyMaxTime = 3.0f;							// How long each uncertain shot is followed.
 
 	// Update the Camera based on their inital values.
 	UpdateComponents();
 
+	// Bind the physics step callback used to apply the Gravity and Launcher fields.
+	OnCalculateCustomPhysics.BindUObject(this, &ABall::SubstepFields);
+
 	// Tell the game controller to possess this player.
 	AutoPossessPlayer = EAutoReceiveInput::Player0;
 
+	// Online, the server's body is sent through the Net State rather than the engine's movement replication,
+	// so it can be quantised and clients can predict their own shots.
+	bReplicates = true;
+	bReplicateMovement = false;
+	NetUpdateFrequency = 30.0f;
+	MinNetUpdateFrequency = 2.0f;
+	NetRelevancyDistance = 15000.0f;					// How close a player's camera has to be for UltraBall to be sent to them.
+	ReconcileTime = 0.2f;								// How long a client takes to steer back onto the server's path.
+	ReconcileSnapDistance = 300.0f;						// How far off a client can be before UltraBall is moved straight there.
+
 }
 
 // Called when the game starts or when spawned
 void ABall::BeginPlay()
 {
+	// Take a slot in the Ball Manager, which holds UltraBall's state and ticks it. The slot starts with the default state.
+	// This is done before the Blueprint's BeginPlay runs, so the state is there for it.
+	Manager = ABallManager::Get(GetWorld());
+	BallIndex = Manager != nullptr ? Manager->Register(this) : INDEX_NONE;
 	Super::BeginPlay();
+	if (BallIndex == INDEX_NONE)
+	{
+		UE_LOG(LogBall, Warning, TEXT("%s was removed because the level already has %d balls."), *GetName(), ABallManager::MaxBalls);
+		Manager = nullptr;
+		Destroy();
+		return;
+	}
 
 	// Setup default values.
-	CurrentFireState = Idle;
-	CurrentZoneState = InNoZone;
-	CurrentLocationState = OnTheGround;
-	CurrentChargeState = HaveCharges;
 	CurrentZoomAmount = 0.0f;
 	CurrentPar = 0;
-	CurrentCharge = 0.0f;
 	isCameraLocked = false;
 	CameraZoomAmountLock = 0.0f;
-	isMeshChangeAllowed = false;
 	hasAttemptedShotWhileMoving = false;
-	hasPlayedSoundOnTheGroundBefore = false;
 	isFailLevelAllowed = true;
-	BlackeningAmount = 0.0f;
+	ShotCount = 0;
+	LastShotTime = 0.0f;
+
+	// Only send UltraBall to players close enough to see it, so each player's bandwidth doesn't grow with the lobby.
+	NetCullDistanceSquared = FMath::Square(NetRelevancyDistance);
+
+	// Use a fixed step for every frame if deterministic mode is on, or give the engine its own settings back if it has been turned off.
+	FGolfDeterminism::Apply();
+
+	// Create the Dynamic Material once. Parameters are only written to it when they change.
+	BallMaterial = UltraBall->CreateAndSetMaterialInstanceDynamic(0);
+
+	// Build the body with both coliders.
+	SetupSimpleColider();
+
+	// Find the fields that pull UltraBall around.
+	GravityFieldSubsystem = UGravityFieldSubsystem::Get(GetWorld());
+	{
+		FScopeLock Lock(&SubstepLock);
+		ActiveFieldIds.Reset();
+		ReleasedFieldIds.Reset();
+		SubstepZoneState = EBallZoneState::InNoZone;
+		SubstepGravityZ = GetWorld()->GetGravityZ();
+		hasPendingLaunch = false;
+		PendingLaunchVelocity = FVector::ZeroVector;
+	}
+
+	// Setup the Shot Predictor.
+	ShotPredictor.SetIgnoredActor(this);
+	ShotPredictor.LocationTolerance = PredictorLocationTolerance;
+	ShotPredictor.VelocityTolerance = PredictorVelocityTolerance;
+	ShotPredictor.MaxBounces = PredictorMaxBounces;
+
+	// Stream in the Distance Field for this level. The predictor uses sweeps until it arrives.
+	DistanceFieldSubsystem = UDistanceFieldSubsystem::Get(GetWorld());
+	if (DistanceFieldSubsystem.IsValid())
+		DistanceFieldSubsystem->StreamIn(UWorld::RemovePIEPrefix(GetWorld()->GetMapName()));
+
+	// Record this run. Only player one's ball is recorded when there are several.
+	UReplaySubsystem* ReplaySubsystem = UReplaySubsystem::Get(GetWorld());
+	if (ReplaySubsystem != nullptr && AutoPossessPlayer == EAutoReceiveInput::Player0)
+		ReplaySubsystem->StartRecording(this, UWorld::RemovePIEPrefix(GetWorld()->GetMapName()));
+
+	// Create one instance for every Predictor Ring. Unused rings are scaled to nothing.
+	PredictorRings->SetWorldTransform(FTransform::Identity);
+	PredictorRings->ClearInstances();
+	PredictorRingTransforms.Init(FTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector), PredictorRingCount);
+	for (const FTransform& RingTransform : PredictorRingTransforms)
+		PredictorRings->AddInstance(RingTransform);
+
+	// Create one Uncertainty Marker for every uncertain shot.
+	UncertaintyMarkers->SetWorldTransform(FTransform::Identity);
+	UncertaintyMarkers->ClearInstances();
+	UncertaintyMarkerTransforms.Init(FTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector), UncertaintySampleCount);
+	for (const FTransform& MarkerTransform : UncertaintyMarkerTransforms)
+		UncertaintyMarkers->AddInstance(MarkerTransform);
+	UncertaintyBatch.Reset(UncertaintySampleCount);
+
+	// The uncertain shots land on the level's boxes, which the Ball Manager builds once for every ball. Build them now rather than on the first shot.
+	// A dedicated server never shows them.
+	if (UncertaintySampleCount > 0 && !IsRunningDedicatedServer())
+		Manager->GetUncertaintyBoxes();
 }
 
-// Called every frame
-void ABall::Tick(float DeltaTime)
+void ABall::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaTime);
+	if (Manager != nullptr)
+		Manager->Unregister(BallIndex);
+	Manager = nullptr;
+	BallIndex = INDEX_NONE;
 
-	// Check if UltraBall is in the Air or on the ground and reactivate the ability to play the bounce sound and reactivate charges.
-	ECollisionChannel CollisionChannel = ECC_Visibility;
-	FCollisionQueryParams CollisionParameters;
-	FHitResult Result;
-	CollisionParameters.AddIgnoredActor(this);
-	FVector EndLocation = GetActorLocation();
-	EndLocation.Z -= 100.0f;
+	Super::EndPlay(EndPlayReason);
+}
 
-	GetWorld()->LineTraceSingleByChannel(Result, GetActorLocation(), EndLocation, CollisionChannel, CollisionParameters, FCollisionResponseParams::DefaultResponseParam);
-	if (Result.GetActor() == NULL)
-		hasPlayedSoundOnTheGroundBefore = false;
-	else
+void ABall::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ABall, NetState);
+}
+
+void ABall::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+	if (Manager == nullptr)
+		return;
+
+	// The state is quantised before it is stored, so it only counts as changed when the client would see the difference.
+	// A ball at rest stops changing, so nothing more is sent for it.
+	FBallNetState State;
+	State.Location = UltraBall->GetComponentLocation();
+	State.Rotation = UltraBall->GetComponentRotation();
+	State.isAsleep = !UltraBall->RigidBodyIsAwake();
+	State.LinearVelocity = UltraBall->GetPhysicsLinearVelocity();
+	State.ShotCount = ShotCount;
+	State.Par = (uint8)FMath::Clamp(CurrentPar, 0, 255);
+	State.hasCharges = ChargeState() == EBallChargeState::HaveCharges;
+	State.Quantise();
+	NetState = State;
+}
+
+void ABall::OnRep_NetState()
+{
+	if (Manager == nullptr)
+		return;
+	ULTRABALL_SCOPE_CYCLE_COUNTER(STAT_BallReconcile);
+
+	// Until the server has fired the shot this client predicted, its state is from before the shot. Ignore it,
+	// unless the shot has been waiting so long that the server must have refused it.
+	if ((int8)(ShotCount - NetState.ShotCount) > 0 && GetWorld()->GetTimeSeconds() - LastShotTime < MaxShotConfirmTime)
+		return;
+	ShotCount = NetState.ShotCount;
+	CurrentPar = NetState.Par;
+
+	// Take the server's word on whether UltraBall can be fired.
+	const bool hasCharges = ChargeState() == EBallChargeState::HaveCharges;
+	if (NetState.hasCharges && !hasCharges)
 	{
-		if (CurrentChargeState == HaveNoCharges)
-		{
-			CurrentChargeState = HaveCharges;
-			EndBlackening();
-		}
+		ChargeState() = EBallChargeState::HaveCharges;
+		EndBlackening();
 	}
-	
-	// Hide each Predictor Ring at the start of the tick.
-	for (int i = 0; i < PredictorArray.Num(); i++)
-		PredictorArray[i]->SetVisibility(false);
-
-		// This section predicts what direction the shot will go roughly. It's only activated when the player attempts to fire.
-	if (CurrentFireState == Charging)
+	else if (!NetState.hasCharges && hasCharges)
 	{
-
-		// Determine what way to fire.
-		FVector offset;
-		if (isCameraLocked)
-			offset = GetActorLocation() - CameraLocationLock;
-		else
-			offset = GetActorLocation() - Camera->GetComponentLocation();
-		float ChargeAmount = CurrentCharge * MaxChargePossibleAtFullChargeUp;
-		offset = offset.GetSafeNormal(1.0f) * UltraBall->GetMass() * ChargeAmount * 10.0f;
-
-		// Setup the predictor.
-		FPredictProjectilePathParams Predictor;
-		FPredictProjectilePathResult ProjectileResult;
-		ECollisionChannel CollisionChannel = ECC_Visibility;
-
-		// Setup the initial variables used by the predictor.
-		Predictor.StartLocation = GetActorLocation();
-		Predictor.LaunchVelocity = offset;
-		Predictor.bTraceComplex = true;
-		Predictor.ProjectileRadius = 30.0f;
-		Predictor.TraceChannel = CollisionChannel;
-		TArray<AActor*> ActorsToIgnore;
-		ActorsToIgnore.Add(this);
-		Predictor.ActorsToIgnore = ActorsToIgnore;
-		Predictor.SimFrequency = 12.0f;
-		Predictor.MaxSimTime = 2.0f;
-
-		// Project the Path.
-		UGameplayStatics::PredictProjectilePath(GetWorld(), Predictor, ProjectileResult);
-
-		// Get the Location Data.
-		TArray<FPredictProjectilePathPointData> Locations;
-		Locations = ProjectileResult.PathData;
-		
-		// Update Each Predictor Ring according to the location data.
-		for (int i = 0; i < PredictorArray.Num(); i++)
-			SetRing(PredictorArray[i], Locations[1 + (i * 2)].Location);
+		ChargeState() = EBallChargeState::HaveNoCharges;
+		StartBlackening();
 	}
 
-	// Change to a Sphere Mesh Colider if UltraBall is moving too fast and a Dodecahedron Mesh Colider if it's moving too slow.
-	if (isMeshChangeAllowed)
+	// The state left the server half a round trip ago, so move it on by that much.
+	float Latency = 0.0f;
+	const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	if (PlayerController != nullptr && PlayerController->PlayerState != nullptr)
+		Latency = PlayerController->PlayerState->ExactPing * 0.0005f;
+	const FVector ServerLocation = NetState.Location + NetState.LinearVelocity * Latency;
+	const FVector Error = ServerLocation - UltraBall->GetComponentLocation();
+
+	// Leave UltraBall alone when both agree it has stopped.
+	if (NetState.isAsleep && Error.SizeSquared() < 1.0f)
+		return;
+	WakeFromRest();
+
+	if (Error.SizeSquared() > FMath::Square(ReconcileSnapDistance))
 	{
-		if (UltraBall->GetPhysicsLinearVelocity().Size() >= SpeedAtWhichMeshTransitionsBackToComplex)
-		{
-			if (UltraBall->GetStaticMesh() != SimpleAsset)
-				SetMesh(SimpleAsset);
-		}
-		else
-		{
-			if (UltraBall->GetStaticMesh() != ComplexAsset)
-				SetMesh(ComplexAsset);
-		}
+		// Too far out to steer back without it looking wrong, so move UltraBall to where the server has it.
+		ULTRABALL_INC_COUNTER(STAT_BallReconcileSnaps);
+		UltraBall->SetWorldLocationAndRotation(ServerLocation, NetState.Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+		UltraBall->SetPhysicsLinearVelocity(NetState.LinearVelocity);
 	}
-
-	// Update the Dynamic Material and Lights.
-	FVector CameraDistance = Camera->GetComponentLocation() - GetActorLocation();
-	if (CameraDistance.Size() < 60.0f)
-		UltraBall->SetVisibility(false);
 	else
 	{
-		UltraBall->SetVisibility(true);
-		float transparency = 1.0f - ((1.0f / CurrentZoomAmount) * (CameraDistance.Size() - 100.0f));
-		if (transparency < 0.5f) { transparency = 0.0f; }
-		if (transparency >= 0.5f) { transparency = -((0.5 - transparency) * 2); }
-		if (transparency > 0.8f) { transparency = 1.0f; }
-		UltraBall->SetScalarParameterValueOnMaterials("Alpha", transparency);
+		// Move with the server and close the gap over the Reconcile Time, so the correction isn't seen as a jump.
+		UltraBall->SetPhysicsLinearVelocity(NetState.LinearVelocity + Error / ReconcileTime);
 	}
-	UltraBall->SetScalarParameterValueOnMaterials("Blackening", BlackeningAmount);
+}
 
-	// If in a Gravity Zone
-	if (CurrentZoneState == InGravityZone)
-	{
-		// Move the UltraBall Towards the Center of Gravity
-		FVector Offset = CenterOfGravity - GetActorLocation();
-		FVector DistanceToCenter = CenterOfGravity - GetActorLocation();
+void ABall::UpdatePredictor()
+{
+	ULTRABALL_SCOPE_CYCLE_COUNTER(STAT_BallPredictor);
 
-		if (DistanceToCenter.Size() < 10.0)
-		{
-			UltraBall->SetAllPhysicsLinearVelocity(FVector(0.0f), false);
-			SetActorLocation(CenterOfGravity);
-		}
-		else
-		{
-			Offset = Offset.GetSafeNormal(1.0) * 800;
-			UltraBall->SetAllPhysicsLinearVelocity(Offset, false);
-		}
-	}
+	// This section predicts what direction the shot will go roughly. It's only activated when the player attempts to fire.
+	// Determine what way to fire.
+	FVector offset;
+	if (isCameraLocked)
+		offset = GetActorLocation() - CameraLocationLock;
+	else
+		offset = GetActorLocation() - Camera->GetComponentLocation();
+	// Use the same launch velocity FireShot will, so the rings follow the shot that is actually fired.
+	offset = UltraBallSim::FromSim(FUltraBallSim::GetLaunchVelocity(UltraBallSim::ToSim(offset), Charge(), MaxChargePossibleAtFullChargeUp));
 
-	// If in a Launcher Zone
-	if (CurrentZoneState == InLaunchZone)
-	{
-		// Move the UltraBall Towards the Center of Gravity
-		FVector Offset = CenterOfGravity - GetActorLocation();
-		FVector DistanceToCenter = CenterOfGravity - GetActorLocation();
+	// Trace against the Distance Field once it has streamed in.
+	if (isPredictorUsingDistanceField && DistanceFieldSubsystem.IsValid())
+		ShotPredictor.SetDistanceField(DistanceFieldSubsystem->GetDistanceField());
+	else
+		ShotPredictor.SetDistanceField(nullptr);
 
-		if (DistanceToCenter.Size() < 10.0)
-		{
-			SetActorLocation(CenterOfGravity);
-			CurrentZoneState = InNoZone;
-			UltraBall->SetEnableGravity(true);
-			UltraBall->SetPhysicsLinearVelocity(FVector(0.0f, 0.0f, 0.0f));
-			UltraBall->AddImpulse(LaunchDirection * LaunchPower);
-		}
-		else
-		{
-			Offset = Offset.GetSafeNormal(1.0) * 800;
-			UltraBall->SetAllPhysicsLinearVelocity(Offset, false);
-		}
-	}
+	// Get the predicted path. This is traced asynchronously, so it may be empty until the first whole path has been traced.
+	const TArray<FVector>& Locations = ShotPredictor.GetPath(GetWorld(), GetActorLocation(), offset, isCameraLocked);
+
+	// Update the Predictor Rings according to the location data.
+	SetRings(Locations);
 
+	// Show where slightly different shots would land.
+	if (isCameraLocked)
+		SetUncertaintyMarkers(GetActorLocation() - CameraLocationLock);
+	else
+		SetUncertaintyMarkers(GetActorLocation() - Camera->GetComponentLocation());
 }
 
 // Called to bind functionality to input
@@ -294,22 +417,26 @@ void ABall::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
 
 void ABall::setCurrentCharge(float CurrentCharge)
 {
-	// Set the current charge to be applied to UltraBall.
-	this->CurrentCharge = CurrentCharge;
+	// Set the current charge to be applied to UltraBall, as a fraction of a full charge.
+	Charge() = FMath::Clamp(CurrentCharge, 0.0f, 1.0f);
 
-	// Update the Dynamic Material and the internal light.
-	float ReddishGlow = (1.0f / MaxChargePossibleAtFullChargeUp) * CurrentCharge;
-	UltraBall->SetScalarParameterValueOnMaterials("Power", ReddishGlow);
+	// Update the Dynamic Material and the internal light. The glow keeps its original scale, so it isn't brightened by the clamp.
+	float ReddishGlow = (1.0f / MaxChargePossibleAtFullChargeUp) * Charge();
+	SetMaterialParameter(Manager->MaterialPowers[BallIndex], PowerParameterName, ReddishGlow);
 	Pointlight->SetIntensity(ReddishGlow * 9000.0f);
 }
 
 void ABall::setCurrentBlackening(float CurrentBlackening)
 {
-	BlackeningAmount = CurrentBlackening;
+	WakeFromRest();
+
+	BlackeningAmount() = CurrentBlackening;
 }
 
 void ABall::ZoomIn()
 {
+	WakeFromRest();
+
 	// Zoom the Camera in.
 	CurrentZoomAmount -= (CurrentZoomAmount / (100.0f - ZoomInSpeed));
 	UpdateComponents();
@@ -317,6 +444,8 @@ void ABall::ZoomIn()
 
 void ABall::ZoomOut()
 {
+	WakeFromRest();
+
 	// Zoom the Camera out.
 	CurrentZoomAmount += (CurrentZoomAmount / (100.0f - ZoomInSpeed));
 	UpdateComponents();
@@ -324,11 +453,14 @@ void ABall::ZoomOut()
 
 void ABall::Fire()
 {
+	WakeFromRest();
+
 	// If UltraBall still has charges then allow the charging of UltraBall.
-	if (CurrentChargeState == HaveCharges && CurrentPar != MaxParAllowed)
+	if (CanFire())
 	{
 		StartCharging();
-		CurrentFireState = Charging;
+		FireState() = EBallFireState::Charging;
+		ShotPredictor.Invalidate();
 	}
 	else
 	{
@@ -342,31 +474,10 @@ void ABall::Fire()
 
 void ABall::EndFire()
 {
-	if (CurrentFireState == Charging)
+	if (FireState() == EBallFireState::Charging)
 	{
-		// Start Blackening Process.
-		if (CurrentZoneState == InNoZone)
-		{
-			CurrentChargeState = HaveNoCharges;
-			StartBlackening();
-		}
-
 		// Charge back to an Idle Charge State.
-		CurrentFireState = Idle;
-		CurrentZoneState = InNoZone;
-		UltraBall->SetEnableGravity(true);
-
-		// Load the Simple Mesh or the Complex mesh depending on the Charge going to be applied.
-		// If the Charge is low use the Complex mesh otherwise use the Simple mesh.
-		if (CurrentCharge > 0.1f)
-			UltraBall->SetStaticMesh(SimpleAsset);
-		else
-			UltraBall->SetStaticMesh(ComplexAsset);
-
-		// Set a timer so a mesh change can't happen again too soon.
-		isMeshChangeAllowed = false;
-		FTimerHandle MeshChangeTimer;
-		GetWorldTimerManager().SetTimer(MeshChangeTimer, this, &ABall::MeshChangeTimerExpired, 1.0f);
+		FireState() = EBallFireState::Idle;
 
 		// Calculate the launch direction for UltraBall.
 		FVector LaunchDirection;
@@ -374,28 +485,88 @@ void ABall::EndFire()
 			LaunchDirection = UltraBall->GetComponentLocation() - CameraLocationLock;
 		else
 			LaunchDirection = UltraBall->GetComponentLocation() - Camera->GetComponentLocation();
+		LaunchDirection = LaunchDirection.GetSafeNormal();
 
-		// Apply the charge to UltraBall as a Impulse.
-		float ChargeAmount = CurrentCharge * MaxChargePossibleAtFullChargeUp;
-		LaunchDirection = LaunchDirection.GetSafeNormal(1.0f) * UltraBall->GetMass() * ChargeAmount * 1000.0f;
-		UltraBall->SetPhysicsLinearVelocity(FVector(0.0f, 0.0f, 0.0f));
-		UltraBall->AddImpulse(LaunchDirection);
-
-		// Increase the Par.
-		CurrentPar++;
+		// A client fires straight away rather than waiting a round trip, and asks the server to fire the same shot.
+		if (!HasAuthority())
+		{
+			LastShotTime = GetWorld()->GetTimeSeconds();
+			ServerFire(LaunchDirection, Charge());
+		}
+		FireShot(LaunchDirection, Charge());
 
 		// Call the Blueprint EndCharging Event.
 		EndCharging();
 	}
 }
 
+void ABall::ServerFire_Implementation(FVector_NetQuantizeNormal LaunchDirection, float ShotCharge)
+{
+	// Only fire shots the player could have made on the server's ball. A refused shot is undone by the client's next state.
+	if (Manager == nullptr || !CanFire())
+		return;
+
+	WakeFromRest();
+	Charge() = ShotCharge;
+	FireShot(LaunchDirection, ShotCharge);
+}
+
+bool ABall::ServerFire_Validate(FVector_NetQuantizeNormal LaunchDirection, float ShotCharge)
+{
+	return FMath::IsFinite(ShotCharge) && ShotCharge >= 0.0f && ShotCharge <= 1.0f && !LaunchDirection.ContainsNaN();
+}
+
+void ABall::FireShot(const FVector& LaunchDirection, float ShotCharge)
+{
+	// Start Blackening Process.
+	if (ZoneState() == EBallZoneState::InNoZone)
+	{
+		ChargeState() = EBallChargeState::HaveNoCharges;
+		StartBlackening();
+	}
+
+	// Firing releases UltraBall from any field it is in.
+	ZoneState() = EBallZoneState::InNoZone;
+
+	// Use the Simple Colider or the Complex Colider depending on the Charge going to be applied.
+	// If the Charge is low use the Complex Colider otherwise use the Simple Colider.
+	SetColider(ShotCharge > 0.1f);
+
+	// Set a timer so a mesh change can't happen again too soon.
+	isMeshChangeAllowed() = false;
+	FTimerHandle MeshChangeTimer;
+	GetWorldTimerManager().SetTimer(MeshChangeTimer, this, &ABall::MeshChangeTimerExpired, 1.0f);
+
+	// Fire UltraBall at the start of the next physics step, replacing its velocity. This is the same as an impulse of Mass * Charge * 1000.
+	// Applying it in the step rather than now means the shot doesn't depend on when in the frame it was fired.
+	// The step releases UltraBall from its fields at the same time, so neither side sees one without the other.
+	const FVector LaunchVelocity = UltraBallSim::FromSim(FUltraBallSim::GetLaunchVelocity(UltraBallSim::ToSim(LaunchDirection), ShotCharge, MaxChargePossibleAtFullChargeUp));
+	{
+		FScopeLock Lock(&SubstepLock);
+		ReleasedFieldIds.Append(ActiveFieldIds);
+		ActiveFieldIds.Reset();
+		SubstepZoneState = EBallZoneState::InNoZone;
+		PendingLaunchVelocity = LaunchVelocity;
+		hasPendingLaunch = true;
+	}
+	UltraBall->WakeRigidBody();
+
+	// Increase the Par.
+	CurrentPar++;
+	ShotCount++;
+
+	// Record the shot in the replay.
+	if (UReplaySubsystem* ReplaySubsystem = UReplaySubsystem::Get(GetWorld()))
+		ReplaySubsystem->RecordShot(this, LaunchVelocity, ShotCharge, CurrentPar);
+}
+
 void ABall::CancelFire()
 {
 	// Only proceed if the player is Charging UltraBall.
-	if (CurrentFireState == Charging)
+	if (FireState() == EBallFireState::Charging)
 	{
 		// Cancel the Charging.
-		CurrentFireState = Idle;
+		FireState() = EBallFireState::Idle;
 
 		// Call the Blueprint EndCharging Event.
 		EndCharging();
@@ -404,6 +575,9 @@ void ABall::CancelFire()
 
 void ABall::LookUp(float value)
 {
+	if (value != 0.0f)
+		WakeFromRest();
+
 	// Restrict how far up and down the Camera can look to stop control reversing when flipping over the axis.
 	FRotator cameraRotation = SpringArm->GetComponentRotation();
 	if (cameraRotation.Pitch < -70)
@@ -419,6 +593,9 @@ void ABall::LookUp(float value)
 
 void ABall::LookLeft(float value)
 {
+	if (value != 0.0f)
+		WakeFromRest();
+
 	// Apply the new Yaw.
 	FRotator cameraRotation = SpringArm->GetComponentRotation();
 	cameraRotation.Yaw += value;
@@ -427,6 +604,8 @@ void ABall::LookLeft(float value)
 
 void ABall::CameraLock()
 {
+	WakeFromRest();
+
 	// Lock the current direcion for shooting based on the camera and allow free movement of the camera.
 	isCameraLocked = true;
 	CameraAngleLock = SpringArm->GetComponentRotation();
@@ -435,6 +614,8 @@ void ABall::CameraLock()
 
 void ABall::CameraUnLock()
 {
+	WakeFromRest();
+
 	// Return the camera back to the locked position.
 	isCameraLocked = false;
 	SpringArm->SetRelativeRotation(CameraAngleLock);
@@ -442,7 +623,9 @@ void ABall::CameraUnLock()
 
 void ABall::BumperHit()
 {
-	isMeshChangeAllowed = false;
+	WakeFromRest();
+
+	isMeshChangeAllowed() = false;
 	FTimerHandle MeshChangeTimer;
 	GetWorldTimerManager().SetTimer(MeshChangeTimer, this, &ABall::MeshChangeTimerExpired, 1.0f);
 
@@ -453,136 +636,309 @@ void ABall::BumperHit()
 
 void ABall::OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
 {
-	// This section attempts to play a sound if UltraBall colides with the ground.
+	ULTRABALL_SCOPE_CYCLE_COUNTER(STAT_BallOnHit);
+	ULTRABALL_INC_COUNTER(STAT_BallHits);
+	WakeFromRest();
+
+	// Any contact with a surface facing upwards means UltraBall is on the ground.
+	if (Hit.ImpactNormal.Z >= GroundContactMinNormalZ)
+		RecordGroundContact(Hit.ImpactNormal);
+
+	// This section attempts to play a sound if UltraBall colides with the ground or a wall.
+	// The contact already says what was hit and which way it faces, so no extra traces are needed.
 	if (Sound != nullptr)
 	{
 		if (GetVelocity().Size() > 50.0f)
-		{
+			PlaySoundOnImpact(Hit, NormalImpulse);
+	}
+}
 
-			FVector Location = GetActorLocation();
-			Location.Z -= 100.0f;
-			PlaySoundOnImpact(Location, true);
+void ABall::FieldEnter(EGravityFieldType FieldType)
+{
+	// The field's pull is applied by the physics step, which needs UltraBall to be ticking.
+	WakeFromRest();
+}
 
-			Location = GetActorLocation();
-			Location.Z += 100.0f;
-			PlaySoundOnImpact(Location, false);
+void ABall::ZoneEnter(int ZoneType, FVector CenterOfGravity, FVector LaunchDirection, float LaunchPower)
+{
+	WakeFromRest();
 
-			Location = GetActorLocation();
-			Location.X += 150.0f;
-			PlaySoundOnImpact(Location, false);
+	// Find the Gravity Well that called this. It's the overlapping well closest to the Center of Gravity.
+	TArray<AActor*> OverlappingWells;
+	GetOverlappingActors(OverlappingWells, AGravityWell::StaticClass());
+	AGravityWell* Well = nullptr;
+	for (AActor* Actor : OverlappingWells)
+	{
+		if (Well == nullptr || FVector::DistSquared(Actor->GetActorLocation(), CenterOfGravity) < FVector::DistSquared(Well->GetActorLocation(), CenterOfGravity))
+			Well = Cast<AGravityWell>(Actor);
+	}
 
-			Location = GetActorLocation();
-			Location.X -= 150.0f;
-			PlaySoundOnImpact(Location, false);
+	// Apply the Blueprint's zone data to the well's field.
+	if (Well != nullptr)
+		Well->SetLegacyZoneData(ZoneType == 1 ? EGravityFieldType::Launcher : EGravityFieldType::Gravity, CenterOfGravity, LaunchDirection, LaunchPower);
+}
 
-			Location = GetActorLocation();
-			Location.Y += 150.0f;
-			PlaySoundOnImpact(Location, false);
+void ABall::UpdateComponents()
+{
+	// Updated the Spring Arms length to match the new Zoom settings.
+	if (CurrentZoomAmount < MinZoomInLength) { CurrentZoomAmount = MinZoomInLength; }
+	if (CurrentZoomAmount > MaxZoomOutLength) { CurrentZoomAmount = MaxZoomOutLength; }
+	SpringArm->TargetArmLength = CurrentZoomAmount;
+}
 
-			Location = GetActorLocation();
-			Location.Y -= 150.0f;
-			PlaySoundOnImpact(Location, false);
+void ABall::SetupSimpleColider()
+{
+	// Size the sphere to match the sphere colider on the Simple Mesh.
+	float Radius = UltraBall->Bounds.SphereRadius;
+	UBodySetup* SimpleBodySetup = SimpleAsset != nullptr ? SimpleAsset->BodySetup : nullptr;
+	if (SimpleBodySetup != nullptr && SimpleBodySetup->AggGeom.SphereElems.Num() > 0)
+		Radius = SimpleBodySetup->AggGeom.SphereElems[0].Radius;
+	SimpleColider->SetSphereRadius(Radius);
+	if (SimpleBodySetup != nullptr && SimpleBodySetup->PhysMaterial != nullptr)
+		SimpleColider->SetPhysMaterialOverride(SimpleBodySetup->PhysMaterial);
+
+	// Weld the sphere onto UltraBall's body so both coliders belong to the same rigid body.
+	SimpleColider->WeldTo(UltraBall);
+
+	// Start on the Complex Colider.
+	isUsingSimpleColider() = true;
+	SetColider(false);
+}
 
+void ABall::SetColider(bool isSimple)
+{
+	if (isUsingSimpleColider() == isSimple)
+		return;
+	isUsingSimpleColider() = isSimple;
+	ULTRABALL_SCOPE_CYCLE_COUNTER(STAT_BallMeshSwap);
+
+	// Both shapes are already on the body, so only their collision flags need to change.
+	// The body keeps its velocity and contacts because nothing is recreated.
+	FBodyInstance* BodyInstance = UltraBall->GetBodyInstance();
+	if (BodyInstance == nullptr)
+		return;
+
+	FPhysicsCommand::ExecuteWrite(BodyInstance->ActorHandle, [&](const FPhysicsActorHandle& Actor)
+	{
+		TArray<FPhysicsShapeHandle> Shapes;
+		BodyInstance->GetAllShapes_AssumedLocked(Shapes);
+		for (FPhysicsShapeHandle& Shape : Shapes)
+		{
+			const bool isSphere = FPhysicsInterface::GetShapeType(Shape) == ECollisionShapeType::Sphere;
+			FPhysicsInterface::SetIsSimulationShape(Shape, isSphere == isSimple);
+			FPhysicsInterface::SetIsQueryShape(Shape, isSphere == isSimple);
 		}
-	}
+	});
 }
 
-void ABall::ZoneEnter(int ZoneType, FVector CenterOfGravity, FVector LaunchDirection, float LaunchPower)
+void ABall::SubstepFields(float DeltaTime, FBodyInstance* BodyInstance)
 {
+	ULTRABALL_SCOPE_CYCLE_COUNTER(STAT_BallZoneForces);
+	FScopeLock Lock(&SubstepLock);
 
-	// Set Local Variables
-	this->CenterOfGravity = CenterOfGravity;
-	this->LaunchDirection = LaunchDirection;
-	this->LaunchPower = LaunchPower * UltraBall->GetMass() * 1000.0f;
+	// Fire a shot that was released since the last step.
+	if (hasPendingLaunch)
+	{
+		hasPendingLaunch = false;
+		BodyInstance->SetLinearVelocity(PendingLaunchVelocity, false);
+	}
+	UGravityFieldSubsystem* GravityFields = GravityFieldSubsystem.Get();
+	if (GravityFields == nullptr || DeltaTime <= 0.0f)
+		return;
+
+	const FVector Location = BodyInstance->GetUnrealWorldTransform_AssumesLocked().GetLocation();
+	TArray<FGravityField, TInlineAllocator<4>> Fields;
+	GravityFields->FindFieldsAt(Location, Fields);
 
-	// Gravity Zone Enter
-	if (ZoneType == 0)
-		CurrentZoneState = InGravityZone;
+	// Fields UltraBall has been fired out of are ignored until it has left them.
+	ReleasedFieldIds.RemoveAll([&Fields](int32 FieldId) { return !Fields.ContainsByPredicate([FieldId](const FGravityField& Field) { return Field.Id == FieldId; }); });
+	Fields.RemoveAll([this](const FGravityField& Field) { return ReleasedFieldIds.Contains(Field.Id); });
 
-	// Gravity Launcher Enter
-	if (ZoneType == 1)
-		CurrentZoneState = InLaunchZone;
+	ActiveFieldIds.Reset();
+	if (Fields.Num() == 0)
+	{
+		SubstepZoneState = EBallZoneState::InNoZone;
+		return;
+	}
 
-	// Disable All Gravity.
-	UltraBall->SetEnableGravity(false);
-	UltraBall->SetAllPhysicsLinearVelocity(FVector(0.0f), false);
-	// UltraBall->SetAllPhysicsAngularVelocity(FVector(0.0f), false);
+	// Work out the pull with the same rules the offline simulation uses.
+	TArray<FSimField, TInlineAllocator<4>> SimFields;
+	for (const FGravityField& Field : Fields)
+	{
+		ActiveFieldIds.Add(Field.Id);
+		SimFields.Add(UltraBallSim::ToSim(Field));
+	}
+	const FSimFieldPull Pull = FUltraBallSim::GetFieldPull(UltraBallSim::ToSim(Location), SimFields.GetData(), SimFields.Num(), SubstepGravityZ, DeltaTime);
+	SubstepZoneState = SimFields[Pull.NearestIndex].isLauncher ? EBallZoneState::InLaunchZone : EBallZoneState::InGravityZone;
 
+	// Launchers fire UltraBall out of every field it is in.
+	if (Pull.Result == ESimFieldResult::Launched)
+	{
+		ReleasedFieldIds.Append(ActiveFieldIds);
+		ActiveFieldIds.Reset();
+		SubstepZoneState = EBallZoneState::InNoZone;
+	}
+	BodyInstance->SetLinearVelocity(UltraBallSim::FromSim(Pull.Velocity), false);
 }
 
-void ABall::UpdateComponents()
+EBallZoneState ABall::GetSubstepZoneState()
 {
-	// Updated the Spring Arms length to match the new Zoom settings.
-	if (CurrentZoomAmount < MinZoomInLength) { CurrentZoomAmount = MinZoomInLength; }
-	if (CurrentZoomAmount > MaxZoomOutLength) { CurrentZoomAmount = MaxZoomOutLength; }
-	SpringArm->TargetArmLength = CurrentZoomAmount;
+	FScopeLock Lock(&SubstepLock);
+	return SubstepZoneState;
 }
 
-void ABall::SetMesh(UStaticMesh* MeshToUse)
+void ABall::RecordGroundContact(const FVector& SupportNormal)
 {
-	// Record the current physics.
-	FVector LinearVelocity = UltraBall->GetPhysicsLinearVelocity();
-	FVector AngularVelocity = UltraBall->GetPhysicsAngularVelocity();
-
-	// Change the mesh.
-	UltraBall->SetStaticMesh(MeshToUse);
+	LocationState() = EBallLocationState::OnTheGround;
+	Manager->LastGroundContactTimes[BallIndex] = GetWorld()->GetTimeSeconds();
+	Manager->GroundSupportNormals[BallIndex] = SupportNormal;
+	Manager->TicksSinceGroundContact[BallIndex] = 0;
 
-	// Apply the previous physics to the new mesh.
-	UltraBall->SetPhysicsLinearVelocity(LinearVelocity);
-	UltraBall->SetPhysicsAngularVelocity(AngularVelocity);
+	// Reactivate the charges now UltraBall has landed.
+	if (ChargeState() == EBallChargeState::HaveNoCharges)
+	{
+		ChargeState() = EBallChargeState::HaveCharges;
+		EndBlackening();
+	}
 }
 
-void ABall::SetupRing(UStaticMeshComponent *Mesh)
+void ABall::SetMaterialParameter(float& CachedValue, FName ParameterName, float Value)
 {
-	// Configure the Predictor Ring.
-	ConstructorHelpers::FObjectFinder<UStaticMesh> Predictor(TEXT("StaticMesh'/Game/Models/M_aim_guide.M_aim_guide'"));
-	Mesh->SetStaticMesh(Predictor.Object);
-	Mesh->SetSimulatePhysics(false);
-	Mesh->SetGenerateOverlapEvents(false);
-	Mesh->SetCanEverAffectNavigation(false);
-	Mesh->SetVisibility(false);
-	Mesh->SetRelativeScale3D(FVector(0.5f));
+	if (BallMaterial == nullptr)
+		return;
+
+	// Skip the write if the material already has this value.
+	if (CachedValue == Value)
+		return;
+
+	CachedValue = Value;
+	BallMaterial->SetScalarParameterValue(ParameterName, Value);
 }
 
-void ABall::SetRing(UStaticMeshComponent *Mesh, FVector Location)
+void ABall::WakeFromRest()
 {
-	// Set the Predictor Rings World Location.
-	Mesh->SetWorldLocation(Location);
-	Mesh->SetWorldRotation(SpringArm->GetComponentRotation());
-	Mesh->SetVisibility(true);
+	isResting() = false;
 }
 
-void ABall::PlaySoundOnImpact(FVector EndLocation, bool isGroundLevel)
+void ABall::SetRings(const TArray<FVector>& Path)
 {
-	// Initialise Paramaters for a Ray Trace.
-	FVector StartLocation = GetActorLocation();
-	ECollisionChannel CollisionChannel = ECC_Visibility;
-	FCollisionQueryParams CollisionParameters;
-	FHitResult Result;
-	CollisionParameters.AddIgnoredActor(this);
-
-	// Setup Parameters for the Ray Trace.
-	GetWorld()->LineTraceSingleByChannel(Result, StartLocation, EndLocation, CollisionChannel, CollisionParameters, FCollisionResponseParams::DefaultResponseParam);
-	if (isGroundLevel)
+	// Walk along the path and drop a ring every time the spacing distance is covered.
+	const FQuat RingRotation = SpringArm->GetComponentQuat();
+	const FVector RingScale(0.5f);
+	int RingIndex = 0;
+	float DistanceToNextRing = PredictorRingSpacing;
+	for (int i = 1; i < Path.Num() && RingIndex < PredictorRingTransforms.Num(); i++)
 	{
-		if (Result.GetActor() != NULL && !hasPlayedSoundOnTheGroundBefore)
+		FVector SegmentStart = Path[i - 1];
+		const FVector SegmentEnd = Path[i];
+		float SegmentLength = FVector::Dist(SegmentStart, SegmentEnd);
+
+		while (SegmentLength >= DistanceToNextRing && RingIndex < PredictorRingTransforms.Num())
 		{
-			// Play the bounce sound.
-			Sound->Play();
-			Sound->SetVolumeMultiplier(0.001f * GetVelocity().Size());
-			hasPlayedSoundOnTheGroundBefore = true;
+			SegmentStart += (SegmentEnd - SegmentStart) * (DistanceToNextRing / SegmentLength);
+			SegmentLength -= DistanceToNextRing;
+			DistanceToNextRing = PredictorRingSpacing;
+			PredictorRingTransforms[RingIndex++] = FTransform(RingRotation, SegmentStart, RingScale);
 		}
+		DistanceToNextRing -= SegmentLength;
 	}
-	else
+
+	// Hide any rings past the end of the path.
+	for (int i = RingIndex; i < PredictorRingTransforms.Num(); i++)
+		PredictorRingTransforms[i].SetScale3D(FVector::ZeroVector);
+
+	// Move every ring in one update.
+	PredictorRings->BatchUpdateInstancesTransforms(0, PredictorRingTransforms, true, true, true);
+	if (!PredictorRings->IsVisible())
+		PredictorRings->SetVisibility(true);
+}
+
+void ABall::SetUncertaintyMarkers(const FVector& LaunchDirection)
+{
+	const int SampleCount = UncertaintyMarkerTransforms.Num();
+	if (SampleCount == 0)
+		return;
+	ULTRABALL_SCOPE_CYCLE_COUNTER(STAT_BallUncertaintyMarkers);
+
+	// Spread the shots evenly through a cone around the aimed direction, using a spiral so the pattern doesn't flicker.
+	// The charge is spread the same way, so every shot differs from its neighbours in both.
+	const FVector Direction = LaunchDirection.GetSafeNormal(1.0f);
+	FVector Right, Up;
+	Direction.FindBestAxisVectors(Right, Up);
+	const float MaxSpread = FMath::Tan(FMath::DegreesToRadians(UncertaintyDirectionSpread));
+	const FVector Start = GetActorLocation();
+	for (int i = 0; i < SampleCount; i++)
 	{
-		if (Result.GetActor() != NULL)
+		const float Spread = MaxSpread * FMath::Sqrt((i + 0.5f) / SampleCount);
+		const float Angle = i * 2.39996323f;
+		const FVector SampleDirection = Direction + (Right * FMath::Cos(Angle) + Up * FMath::Sin(Angle)) * Spread;
+		const float SampleCharge = Charge() * (1.0f + UncertaintyChargeSpread * (2.0f * FMath::Frac(i * 0.618034f) - 1.0f));
+		const FSimVector Velocity = FUltraBallSim::GetLaunchVelocity(UltraBallSim::ToSim(SampleDirection), SampleCharge, MaxChargePossibleAtFullChargeUp);
+		UncertaintyBatch.SetTrajectory(i, UltraBallSim::ToSim(Start), Velocity);
+	}
+
+	// Land on the ground UltraBall is sitting on, as well as the boxes in the level.
+	FSimBatchSettings Settings;
+	Settings.GravityZ = Manager->GravityZ;
+	Settings.NumSteps = FMath::CeilToInt(UncertaintyMaxTime / Settings.TimeStep);
+	Settings.BallRadius = ShotPredictor.ProjectileRadius;
+	Settings.hasGroundPlane = LocationState() == EBallLocationState::OnTheGround;
+	Settings.GroundZ = Start.Z - ShotPredictor.ProjectileRadius;
+	const std::vector<FSimBox>& UncertaintyBoxes = Manager->GetUncertaintyBoxes();
+	FSimBatchIntegrator::Integrate(UncertaintyBatch, Settings, UncertaintyBoxes.data(), (int32)UncertaintyBoxes.size());
+
+	// Place a marker where each shot landed. Shots that didn't land are hidden.
+	const FQuat MarkerRotation = SpringArm->GetComponentQuat();
+	const FVector MarkerScale(0.2f);
+	for (int i = 0; i < SampleCount; i++)
+	{
+		if (UncertaintyBatch.HasLanded(i))
+			UncertaintyMarkerTransforms[i] = FTransform(MarkerRotation, UltraBallSim::FromSim(UncertaintyBatch.GetLocation(i)), MarkerScale);
+		else
+			UncertaintyMarkerTransforms[i].SetScale3D(FVector::ZeroVector);
+	}
+
+	UncertaintyMarkers->BatchUpdateInstancesTransforms(0, UncertaintyMarkerTransforms, true, true, true);
+	if (!UncertaintyMarkers->IsVisible())
+		UncertaintyMarkers->SetVisibility(true);
+}
+
+void ABall::PlaySoundOnImpact(const FHitResult& Hit, const FVector& NormalImpulse)
+{
+	// Work out which way the surface faces. Fall back to the impulse if the contact has no normal.
+	FVector SurfaceNormal = Hit.ImpactNormal;
+	if (SurfaceNormal.IsNearlyZero())
+		SurfaceNormal = NormalImpulse.GetSafeNormal();
+
+	// Don't replay the sound if this surface was hit a moment ago. This stops rolling and rattling contacts spamming the sound.
+	const float CurrentTime = GetWorld()->GetTimeSeconds();
+	const TWeakObjectPtr<UPrimitiveComponent> Surface = Hit.GetComponent();
+	if (const float* LastTime = ImpactSoundTimes.Find(Surface))
+	{
+		if (CurrentTime - *LastTime < MinTimeBetweenImpactSounds)
+			return;
+	}
+
+	// The ground sound is only played once per landing. Walls and ceilings always play.
+	const bool isGroundLevel = SurfaceNormal.Z >= GroundContactMinNormalZ;
+	if (isGroundLevel && hasPlayedSoundOnTheGroundBefore())
+		return;
+
+	// Play the bounce sound.
+	ULTRABALL_INC_COUNTER(STAT_BallImpactSounds);
+	Sound->Play();
+	Sound->SetVolumeMultiplier(0.001f * GetVelocity().Size());
+	hasPlayedSoundOnTheGroundBefore() = true;
+
+	// Remember when this surface was last played, clearing out surfaces that have long since expired.
+	if (ImpactSoundTimes.Num() >= 16)
+	{
+		for (auto It = ImpactSoundTimes.CreateIterator(); It; ++It)
 		{
-			// Play the bounce sound.
-			Sound->Play();
-			Sound->SetVolumeMultiplier(0.001f * GetVelocity().Size());
-			hasPlayedSoundOnTheGroundBefore = true;
+			if (!It.Key().IsValid() || CurrentTime - It.Value() >= MinTimeBetweenImpactSounds)
+				It.RemoveCurrent();
 		}
 	}
-
+	ImpactSoundTimes.Add(Surface, CurrentTime);
 }
 
@@ -4,13 +4,28 @@
 #include "Components/SphereComponent.h" 
 #include "CoreMinimal.h"
 #include "GameFramework/Pawn.h"
+#include "ShotPredictor.h"
+#include "Simulation/BatchIntegrator.h"
+#include "GravityFieldSubsystem.h"
+#include "BallManager.h"
+#include "BallNetState.h"
+#include "PhysicsEngine/BodyInstance.h"
+#include "HAL/CriticalSection.h"
 #include "Ball.generated.h"
 
+/**
+ * UltraBall. Its gameplay state lives in the Ball Manager, which ticks every ball in the level together,
+ * so the ball itself doesn't tick.
+ * Online, the server simulates every ball and sends its Net State to the clients near it. Clients fire their own
+ * shots straight away and steer their ball back onto the server's path as its state arrives.
+ */
 UCLASS()
 class GOLF_API ABall : public APawn
 {
 	GENERATED_BODY()
 
+	friend class ABallManager;
+
 public:
 	// Sets default values for this pawn's properties
 	ABall();
@@ -19,9 +34,13 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	// Build the Net State from UltraBall's body before it is compared and sent.
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
 
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
@@ -34,10 +53,18 @@ public:
 	UPROPERTY(VisibleAnywhere)
 	UStaticMesh* ComplexAsset;
 
-	// Current Mesh of UltraBall.
+	// Current Mesh of UltraBall. This also carries the Dodecahedron Colider.
 	UPROPERTY(VisibleAnywhere)
 	UStaticMeshComponent* UltraBall;
 
+	// Sphere Colider welded onto UltraBall's body. Only one of the two coliders is active at a time.
+	UPROPERTY(VisibleAnywhere)
+	USphereComponent* SimpleColider;
+
+	// Dynamic Material applied to UltraBall at the start of play.
+	UPROPERTY(VisibleAnywhere, Transient)
+	class UMaterialInstanceDynamic* BallMaterial;
+
 	// Camera Controlled by the Player.
 	UPROPERTY(VisibleAnywhere)
 	class UCameraComponent* Camera;
@@ -55,28 +82,15 @@ public:
 	class UAudioComponent* Sound;
 
 	// Predictor Rings - These are used to draw where UltraBall will fire if the charge is applied.
-	UPROPERTY()
-	UStaticMeshComponent* PredictorRing01;
-
-	UPROPERTY()
-	UStaticMeshComponent* PredictorRing02;
-
-	UPROPERTY()
-	UStaticMeshComponent* PredictorRing03;
-
-	UPROPERTY()
-	UStaticMeshComponent* PredictorRing04;
-
-	UPROPERTY()
-	UStaticMeshComponent* PredictorRing05;
-
-	UPROPERTY()
-	UStaticMeshComponent* PredictorRing06;
+	// All of the rings are instances of one mesh so they can be moved in a single update.
+	UPROPERTY(VisibleAnywhere)
+	class UInstancedStaticMeshComponent* PredictorRings;
 
-	UPROPERTY()
-	TArray<UStaticMeshComponent*> PredictorArray;
+	// Uncertainty Markers - These show where UltraBall is likely to land if the shot is slightly off.
+	UPROPERTY(VisibleAnywhere)
+	class UInstancedStaticMeshComponent* UncertaintyMarkers;
 
-	// Set the Current Charge.
+	// Set the Current Charge, as a fraction of a full charge from 0 to 1. A full charge fires at MaxChargePossibleAtFullChargeUp.
 	UFUNCTION(BlueprintCallable)
 	void setCurrentCharge(float CurrentCharge);
 
@@ -127,6 +141,9 @@ public:
 	UFUNCTION(BlueprintPure)
 	int GetMaxPar() { return MaxParAllowed; }
 
+	// Replay: Return which kind of zone UltraBall is in. Gravity, Launch or none, in that order.
+	uint8 GetZoneState() const { return Manager != nullptr ? (uint8)Manager->ZoneStates[BallIndex] : (uint8)EBallZoneState::InNoZone; }
+
 	// Widget: Returns whether this is the last level.
 	UFUNCTION(BlueprintPure)
 	bool GetLastLevel() { return isLastLevel; }
@@ -141,7 +158,7 @@ public:
 
 	// Widget: Return the current Charge. This is used by Blueprints.
 	UFUNCTION(BlueprintPure)
-	float GetCharge() { return CurrentCharge; }
+	float GetCharge() { return Manager != nullptr ? Charge() : 0.0f; }
 
 	// Widget: Return if the player attempted an illegal shot. This is used by the HUD Widget.
 	UFUNCTION(BlueprintPure)
@@ -191,6 +208,71 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "1.0", ClampMax = "2000.0", UIMin = "1.0", UIMax = "2000.0"))
 	float SpeedAtWhichMeshTransitionsBackToComplex;
 
+	// Designer: How often UltraBall ticks while it is resting. Zero stops it ticking until it is woken up.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "0.0", ClampMax = "5.0", UIMin = "0.0", UIMax = "5.0"))
+	float RestTickInterval;
+
+	// Designer: How many of the Ball Manager's ticks UltraBall can go without a ground contact before a trace checks whether it's in the air.
+	// Contacts are reported by OnHit, so this counts ticks rather than physics substeps.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "1", ClampMax = "60", UIMin = "1", UIMax = "60"))
+	int GroundContactFallbackTicks;
+
+	// Designer: How long before the same surface can play the bounce sound again.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "0.0", ClampMax = "2.0", UIMin = "0.0", UIMax = "2.0"))
+	float MinTimeBetweenImpactSounds;
+
+	// Designer: How many Predictor Rings are drawn along the predicted path.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "0", ClampMax = "64", UIMin = "0", UIMax = "64"))
+	int PredictorRingCount;
+
+	// Designer: The distance between each Predictor Ring along the predicted path.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "10.0", ClampMax = "2000.0", UIMin = "10.0", UIMax = "2000.0"))
+	float PredictorRingSpacing;
+
+	// Designer: How far UltraBall can move before the predictor path is re-traced.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "0.0", ClampMax = "100.0", UIMin = "0.0", UIMax = "100.0"))
+	float PredictorLocationTolerance;
+
+	// Designer: How far the launch velocity can change before the predictor path is re-traced.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "0.0", ClampMax = "100.0", UIMin = "0.0", UIMax = "100.0"))
+	float PredictorVelocityTolerance;
+
+	// Designer: How many bounces, Bumpers and Gravity Wells the predictor follows.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "0", ClampMax = "10", UIMin = "0", UIMax = "10"))
+	int PredictorMaxBounces;
+
+	// Designer: Whether the Predictor Rings trace against the level's baked Distance Field when it has one.
+	UPROPERTY(EditAnywhere, Category = "Designer")
+	bool isPredictorUsingDistanceField;
+
+	// Designer: How many slightly different shots are simulated to show where UltraBall might land. Zero turns this off.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "0", ClampMax = "1024", UIMin = "0", UIMax = "1024"))
+	int UncertaintySampleCount;
+
+	// Designer: How far in degrees a shot can stray from the aimed direction.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "0.0", ClampMax = "30.0", UIMin = "0.0", UIMax = "30.0"))
+	float UncertaintyDirectionSpread;
+
+	// Designer: How far the charge can stray from the current charge, as a fraction of it.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "0.0", ClampMax = "1.0", UIMin = "0.0", UIMax = "1.0"))
+	float UncertaintyChargeSpread;
+
+	// Designer: How long each uncertain shot is followed before it is given up on.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "0.1", ClampMax = "10.0", UIMin = "0.1", UIMax = "10.0"))
+	float UncertaintyMaxTime;
+
+	// Designer: How close a player's camera has to be for UltraBall to be sent to them. Players always get their own ball.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "1000.0", ClampMax = "100000.0", UIMin = "1000.0", UIMax = "100000.0"))
+	float NetRelevancyDistance;
+
+	// Designer: How long a client takes to steer UltraBall back onto the server's path.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "0.02", ClampMax = "2.0", UIMin = "0.02", UIMax = "2.0"))
+	float ReconcileTime;
+
+	// Designer: How far a client can be from the server before UltraBall is moved straight to the server's location.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "1.0", ClampMax = "5000.0", UIMin = "1.0", UIMax = "5000.0"))
+	float ReconcileSnapDistance;
+
 	// Designer: The maximum amount of Par for this level.
 	UPROPERTY(EditAnywhere, Category = "Designer")
 	int MaxParAllowed;
@@ -199,54 +281,128 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Designer")
 	bool isLastLevel;
 
-	UFUNCTION(BlueprintCallable)
+	// Called by a Gravity Well or Launcher Well when UltraBall enters it.
+	void FieldEnter(EGravityFieldType FieldType);
+
+	// Called by older Gravity Well Blueprints when UltraBall enters them. Native wells don't need this.
+	UFUNCTION(BlueprintCallable, meta = (DeprecatedFunction, DeprecationMessage = "Gravity Wells handle their own overlaps. Reparent the Blueprint to GravityWell or LauncherWell and set its data instead."))
 	void ZoneEnter(int ZoneType, FVector CenterOfGravity, FVector LaunchDirection, float LaunchPower);
 
 private:
 
-	// This enumerator determines what state UltraBall is in.
-	enum FireStates { Idle, Charging };
-	enum ChargeStates { HaveCharges, HaveNoCharges };
-	enum LocationStates { OnTheGround, InTheAir };
-	enum ZoneStates { InGravityZone, InLaunchZone, InNoZone };
-
-	FireStates CurrentFireState;
-	ChargeStates CurrentChargeState;
-	LocationStates CurrentLocationState;
-	ZoneStates CurrentZoneState;
+	// The Ball Manager holding UltraBall's state, and UltraBall's slot in it.
+	UPROPERTY(Transient)
+	ABallManager* Manager;
+	int32 BallIndex;
+
+	// UltraBall's state in the Ball Manager.
+	EBallFireState& FireState() { return Manager->FireStates[BallIndex]; }
+	EBallChargeState& ChargeState() { return Manager->ChargeStates[BallIndex]; }
+	EBallLocationState& LocationState() { return Manager->LocationStates[BallIndex]; }
+	EBallZoneState& ZoneState() { return Manager->ZoneStates[BallIndex]; }
+	float& Charge() { return Manager->Charges[BallIndex]; }
+	float& BlackeningAmount() { return Manager->BlackeningAmounts[BallIndex]; }
+	bool& isMeshChangeAllowed() { return Manager->isMeshChangeAllowed[BallIndex]; }
+	bool& isUsingSimpleColider() { return Manager->isUsingSimpleColider[BallIndex]; }
+	bool& hasPlayedSoundOnTheGroundBefore() { return Manager->hasPlayedSoundOnTheGroundBefore[BallIndex]; }
+	bool& isResting() { return Manager->isResting[BallIndex]; }
 
 	// Various temporary variables used for controlling UltraBall.
 	float CurrentZoomAmount;
-	float CurrentCharge;
 	float CameraZoomAmountLock;
-	float LaunchPower;
-	float BlackeningAmount;
-	bool isMeshChangeAllowed;
 	bool isCameraLocked;
 	bool hasAttemptedShotWhileMoving;
-	bool hasPlayedSoundOnTheGroundBefore;
 	bool isFailLevelAllowed;
 	FVector CameraLocationLock;
 	FRotator CameraAngleLock;
-	FVector CenterOfGravity;
-	FVector LaunchDirection;
 
 	int CurrentPar;
 
+	// The server's state, and the handler that reconciles the client with it.
+	UPROPERTY(ReplicatedUsing = OnRep_NetState)
+	FBallNetState NetState;
+
+	UFUNCTION()
+	void OnRep_NetState();
+
+	// Fire UltraBall on the server. Sent by clients as they fire, so the server fires the same shot.
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerFire(FVector_NetQuantizeNormal LaunchDirection, float ShotCharge);
+
+	// How many shots have been fired, and when a client last fired one. The server's state is held off until it has the same count.
+	uint8 ShotCount;
+	float LastShotTime;
+
+	// Gravity and Launcher fields. These are applied during each physics step rather than each tick.
+	// The physics step can run on the physics thread, so everything it shares with the game thread is only touched under
+	// SubstepLock. The zone the step found is copied into the Ball Manager at the start of each tick.
+	TWeakObjectPtr<UGravityFieldSubsystem> GravityFieldSubsystem;
+	FCalculateCustomPhysics OnCalculateCustomPhysics;
+	FCriticalSection SubstepLock;
+	TArray<int32> ActiveFieldIds;
+	TArray<int32> ReleasedFieldIds;
+	EBallZoneState SubstepZoneState;
+	float SubstepGravityZ;
+
+	// A shot waiting to be fired by the next physics step.
+	FVector PendingLaunchVelocity;
+	bool hasPendingLaunch;
+
+	// Returns the zone the physics step last found UltraBall in.
+	EBallZoneState GetSubstepZoneState();
+
+	// Predicts and caches the path shown by the Predictor Rings.
+	FShotPredictor ShotPredictor;
+	TWeakObjectPtr<class UDistanceFieldSubsystem> DistanceFieldSubsystem;
+
+	// The last time each surface played the bounce sound.
+	TMap<TWeakObjectPtr<UPrimitiveComponent>, float> ImpactSoundTimes;
+
+	// Instance transforms for the Predictor Rings. Kept between ticks so they aren't reallocated.
+	TArray<FTransform> PredictorRingTransforms;
+
+	// The uncertain shots and the markers placed where they land.
+	FSimTrajectoryBatch UncertaintyBatch;
+	TArray<FTransform> UncertaintyMarkerTransforms;
+
+	// Returns whether UltraBall can be fired. The server and the client predicting it both ask this.
+	bool CanFire() { return ChargeState() == EBallChargeState::HaveCharges && CurrentPar < MaxParAllowed; }
+
+	// Fire UltraBall along a direction with a charge from 0 to 1. This is the same on the server and the client predicting it.
+	void FireShot(const FVector& LaunchDirection, float ShotCharge);
+
 	// Forces the components such as the arrow and spring arm to update.
 	void UpdateComponents();
 
-	// This function is called when changing to a new mesh.
-	void SetMesh(UStaticMesh* MeshToUse);
+	// Weld the Sphere Colider onto UltraBall's body.
+	void SetupSimpleColider();
+
+	// This function is called when changing between the Sphere and Dodecahedron Coliders.
+	void SetColider(bool isSimple);
+
+	// Physics step: fire any pending shot and pull UltraBall towards the Gravity and Launcher fields it is in.
+	void SubstepFields(float DeltaTime, FBodyInstance* BodyInstance);
+
+	// Record that UltraBall is touching the ground.
+	void RecordGroundContact(const FVector& SupportNormal);
+
+	// Set a parameter on the Dynamic Material, but only if it differs from the last value written to it.
+	void SetMaterialParameter(float& CachedValue, FName ParameterName, float Value);
+
+	// Return to being ticked every frame. Called by input, hits and zones.
+	void WakeFromRest();
+
+	// Aim the Predictor Rings and Uncertainty Markers while charging. Called by the Ball Manager.
+	void UpdatePredictor();
 
-	// This function is called when generating a predictor ring.
-	void SetupRing(UStaticMeshComponent *Mesh);
+	// This function places the Predictor Rings along the predicted path.
+	void SetRings(const TArray<FVector>& Path);
 
-	// This function sets the location of a predictor ring.
-	void SetRing(UStaticMeshComponent *Mesh, FVector Location);
+	// Simulate shots around the aimed shot and place the Uncertainty Markers where they land.
+	void SetUncertaintyMarkers(const FVector& LaunchDirection);
 
 	// Timer: Allow Mesh changing again.
-	FORCEINLINE void MeshChangeTimerExpired() { isMeshChangeAllowed = true; }
+	FORCEINLINE void MeshChangeTimerExpired() { isMeshChangeAllowed() = true; }
 
 	// Timer: Allow level failing again.
 	FORCEINLINE void FailLevelTimerExpired() { isFailLevelAllowed = true; }
@@ -254,7 +410,7 @@ private:
 	// Timer: Stop showing the "X" after the player attempted an illegal shot.
 	FORCEINLINE void hasAttemptedShotWhileMovingTimerExpired() { hasAttemptedShotWhileMoving = false; }
 
-	// Play a sound upon impact with the ground or a wall in front of UltraBall.
-	void PlaySoundOnImpact(FVector EndLocation, bool isGroundLevel);
+	// Play a sound upon impact with the ground or a wall, using the contact reported by OnHit.
+	void PlaySoundOnImpact(const FHitResult& Hit, const FVector& NormalImpulse);
 
 };
\ No newline at end of file
@@ -0,0 +1,352 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BallManager.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Camera/CameraComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Kismet/GameplayStatics.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "PhysicsEngine/BodyInstance.h"
+#include "Misc/ScopeLock.h"
+#include "Ball.h"
+#include "SimWorldBuilder.h"
+#include "GolfPerf.h"
+#include "GolfMemory.h"
+
+DECLARE_CYCLE_STAT(TEXT("Ball Tick"), STAT_BallTick, STATGROUP_UltraBall);
+DECLARE_CYCLE_STAT(TEXT("Ball Ground Contact"), STAT_BallGroundContact, STATGROUP_UltraBall);
+DECLARE_CYCLE_STAT(TEXT("Ball Material Update"), STAT_BallMaterialUpdate, STATGROUP_UltraBall);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ball Ground Traces"), STAT_BallGroundTraces, STATGROUP_UltraBall);
+
+// Names of the parameters on UltraBall's material.
+static const FName AlphaParameterName(TEXT("Alpha"));
+static const FName BlackeningParameterName(TEXT("Blackening"));
+
+// Material parameters start at this, so the first real value is always written.
+static const float UnsetMaterialValue = MAX_flt;
+
+ABallManager::ABallManager()
+{
+	// Tick every ball in one pass, at the point in the frame where each ball used to tick itself.
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
+	// Size every array for the most balls up front, so the physics step never sees them move.
+	Balls.Init(nullptr, MaxBalls);
+	FireStates.Init(EBallFireState::Idle, MaxBalls);
+	ChargeStates.Init(EBallChargeState::HaveCharges, MaxBalls);
+	LocationStates.Init(EBallLocationState::OnTheGround, MaxBalls);
+	ZoneStates.Init(EBallZoneState::InNoZone, MaxBalls);
+	Charges.Init(0.0f, MaxBalls);
+	BlackeningAmounts.Init(0.0f, MaxBalls);
+	isMeshChangeAllowed.Init(false, MaxBalls);
+	isUsingSimpleColider.Init(false, MaxBalls);
+	hasPlayedSoundOnTheGroundBefore.Init(false, MaxBalls);
+	LastGroundContactTimes.Init(0.0f, MaxBalls);
+	GroundSupportNormals.Init(FVector::UpVector, MaxBalls);
+	TicksSinceGroundContact.Init(0, MaxBalls);
+	GroundTraceHandles.Init(FTraceHandle(), MaxBalls);
+	isResting.Init(false, MaxBalls);
+	NextTickTimes.Init(0.0f, MaxBalls);
+	Locations.Init(FVector::ZeroVector, MaxBalls);
+	Velocities.Init(FVector::ZeroVector, MaxBalls);
+	isAwake.Init(false, MaxBalls);
+	MaterialAlphas.Init(UnsetMaterialValue, MaxBalls);
+	MaterialBlackenings.Init(UnsetMaterialValue, MaxBalls);
+	MaterialPowers.Init(UnsetMaterialValue, MaxBalls);
+	DueBalls.Reserve(MaxBalls);
+
+	NumBalls = 0;
+	GravityZ = 0.0f;
+	hasUncertaintyBoxes = false;
+}
+
+ABallManager* ABallManager::Get(UWorld* World)
+{
+	if (World == nullptr)
+		return nullptr;
+
+	for (TActorIterator<ABallManager> It(World); It; ++It)
+		return *It;
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParameters.ObjectFlags |= RF_Transient;
+	return World->SpawnActor<ABallManager>(SpawnParameters);
+}
+
+ABall* ABallManager::SpawnBall(const FTransform& Transform, int32 ControllerId, TSubclassOf<ABall> BallClass)
+{
+	if (NumBalls >= MaxBalls)
+		return nullptr;
+
+	// Use the same class as the ball placed in the level, so Blueprint events and defaults carry over.
+	if (BallClass == nullptr)
+	{
+		const int32 FirstIndex = Balls.IndexOfByPredicate([](const ABall* Ball) { return Ball != nullptr; });
+		BallClass = FirstIndex != INDEX_NONE ? Balls[FirstIndex]->GetClass() : ABall::StaticClass();
+	}
+
+	// Only the ball placed in the level possesses player one automatically.
+	ABall* Ball = GetWorld()->SpawnActorDeferred<ABall>(BallClass, Transform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn);
+	if (Ball == nullptr)
+		return nullptr;
+	Ball->AutoPossessPlayer = EAutoReceiveInput::Disabled;
+	UGameplayStatics::FinishSpawningActor(Ball, Transform);
+
+	if (ControllerId >= 0)
+	{
+		APlayerController* PlayerController = UGameplayStatics::GetPlayerController(this, ControllerId);
+		if (PlayerController == nullptr)
+			PlayerController = UGameplayStatics::CreatePlayer(this, ControllerId, false);
+		if (PlayerController != nullptr)
+			PlayerController->Possess(Ball);
+	}
+	return Ball;
+}
+
+int32 ABallManager::Register(ABall* Ball)
+{
+	const int32 Index = Balls.IndexOfByKey(nullptr);
+	if (Index == INDEX_NONE)
+		return INDEX_NONE;
+
+	// Start the slot from the state a ball begins play in.
+	Balls[Index] = Ball;
+	FireStates[Index] = EBallFireState::Idle;
+	ChargeStates[Index] = EBallChargeState::HaveCharges;
+	LocationStates[Index] = EBallLocationState::OnTheGround;
+	ZoneStates[Index] = EBallZoneState::InNoZone;
+	Charges[Index] = 0.0f;
+	BlackeningAmounts[Index] = 0.0f;
+	isMeshChangeAllowed[Index] = false;
+	isUsingSimpleColider[Index] = false;
+	hasPlayedSoundOnTheGroundBefore[Index] = false;
+	LastGroundContactTimes[Index] = 0.0f;
+	GroundSupportNormals[Index] = FVector::UpVector;
+	TicksSinceGroundContact[Index] = 0;
+	GroundTraceHandles[Index] = FTraceHandle();
+	isResting[Index] = false;
+	NextTickTimes[Index] = 0.0f;
+	MaterialAlphas[Index] = UnsetMaterialValue;
+	MaterialBlackenings[Index] = UnsetMaterialValue;
+	MaterialPowers[Index] = UnsetMaterialValue;
+	NumBalls++;
+	return Index;
+}
+
+void ABallManager::Unregister(int32 Index)
+{
+	if (!Balls.IsValidIndex(Index) || Balls[Index] == nullptr)
+		return;
+
+	Balls[Index] = nullptr;
+	GroundTraceHandles[Index] = FTraceHandle();
+	NumBalls--;
+}
+
+const std::vector<FSimBox>& ABallManager::GetUncertaintyBoxes()
+{
+	// The uncertain shots land on the boxes in the level. Anything else is left to the Predictor Rings.
+	// Only the boxes are gathered, so no triangles or collision grid are built in the running game.
+	if (!hasUncertaintyBoxes)
+	{
+		GOLF_LLM_SCOPE(Simulation);
+		FSimWorldBuilder::GatherBoxes(GetWorld(), UncertaintyBoxes);
+		hasUncertaintyBoxes = true;
+	}
+	return UncertaintyBoxes;
+}
+
+// Called every frame
+void ABallManager::Tick(float DeltaTime)
+{
+	GOLF_PERF_CYCLE_SCOPE(BallTickCycles);
+	ULTRABALL_SCOPE_CYCLE_COUNTER(STAT_BallTick);
+	Super::Tick(DeltaTime);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	ReadBodies(Now);
+	if (DueBalls.Num() == 0)
+		return;
+
+	UpdateGroundContacts();
+	UpdatePredictors();
+	UpdateColiders();
+	UpdateMaterials();
+	ApplyFieldForces();
+	UpdateRest(Now);
+}
+
+void ABallManager::ReadBodies(float Now)
+{
+	// Find the balls that are due. Resting balls are only looked at every Rest Tick Interval, or not at all if it is zero,
+	// in which case UpdateRest has pushed their next tick out forever.
+	DueBalls.Reset();
+	for (int32 i = 0; i < MaxBalls; i++)
+	{
+		ABall* Ball = Balls[i];
+		if (Ball == nullptr || (isResting[i] && Now < NextTickTimes[i]))
+			continue;
+
+		if (isResting[i])
+			NextTickTimes[i] = Now + Ball->RestTickInterval;
+
+		// Read each body once, so the passes below don't go back to the physics scene.
+		DueBalls.Add(i);
+		Locations[i] = Ball->UltraBall->GetComponentLocation();
+		Velocities[i] = Ball->UltraBall->GetPhysicsLinearVelocity();
+		isAwake[i] = Ball->UltraBall->RigidBodyIsAwake();
+
+		// Pick up the zone the physics step found, so the passes below and the Blueprints see it for the whole tick.
+		ZoneStates[i] = Ball->GetSubstepZoneState();
+	}
+}
+
+void ABallManager::UpdateGroundContacts()
+{
+	ULTRABALL_SCOPE_CYCLE_COUNTER(STAT_BallGroundContact);
+	UWorld* World = GetWorld();
+
+	// Pick up the fallback traces requested last frame.
+	for (int32 i : DueBalls)
+	{
+		if (!GroundTraceHandles[i].IsValid())
+			continue;
+
+		FTraceDatum Result;
+		if (World->QueryTraceData(GroundTraceHandles[i], Result))
+		{
+			GroundTraceHandles[i] = FTraceHandle();
+			if (Result.OutHits.Num() > 0 && Result.OutHits[0].bBlockingHit)
+				Balls[i]->RecordGroundContact(Result.OutHits[0].ImpactNormal);
+			else
+			{
+				LocationStates[i] = EBallLocationState::InTheAir;
+				hasPlayedSoundOnTheGroundBefore[i] = false;
+			}
+		}
+		else if (!World->IsTraceHandleValid(GroundTraceHandles[i], false))
+			GroundTraceHandles[i] = FTraceHandle();
+	}
+
+	// Only trace for the ground if no contact has been reported for a while.
+	// A sleeping UltraBall can't leave the ground and doesn't report contacts, so it keeps the last result.
+	// Once UltraBall is known to be in the air, the landing will be reported by OnHit.
+	// Every trace requested here goes into the same async batch, which the engine runs together before the next frame.
+	FCollisionQueryParams CollisionParameters(SCENE_QUERY_STAT(BallGroundTrace));
+	bool hasCollisionParameters = false;
+	for (int32 i : DueBalls)
+	{
+		if (!isAwake[i] || LocationStates[i] == EBallLocationState::InTheAir)
+			continue;
+
+		TicksSinceGroundContact[i]++;
+		if (TicksSinceGroundContact[i] <= Balls[i]->GroundContactFallbackTicks || GroundTraceHandles[i].IsValid())
+			continue;
+
+		// Other balls aren't ground, so every trace ignores all of them.
+		if (!hasCollisionParameters)
+		{
+			for (ABall* Ball : Balls)
+			{
+				if (Ball != nullptr)
+					CollisionParameters.AddIgnoredActor(Ball);
+			}
+			hasCollisionParameters = true;
+		}
+
+		const FVector EndLocation = Locations[i] - FVector(0.0f, 0.0f, 100.0f);
+		GroundTraceHandles[i] = World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Locations[i], EndLocation, ECC_Visibility, CollisionParameters);
+		GOLF_PERF_COUNT_QUERIES(1);
+		ULTRABALL_INC_COUNTER(STAT_BallGroundTraces);
+	}
+}
+
+void ABallManager::UpdatePredictors()
+{
+	// The predictor is only shown while charging. Each ball's path depends on its own camera.
+	for (int32 i : DueBalls)
+	{
+		ABall* Ball = Balls[i];
+		if (FireStates[i] == EBallFireState::Charging)
+			Ball->UpdatePredictor();
+		else
+		{
+			if (Ball->PredictorRings->IsVisible())
+				Ball->PredictorRings->SetVisibility(false);
+			if (Ball->UncertaintyMarkers->IsVisible())
+				Ball->UncertaintyMarkers->SetVisibility(false);
+		}
+	}
+}
+
+void ABallManager::UpdateColiders()
+{
+	// Change to a Sphere Colider if UltraBall is moving too fast and a Dodecahedron Colider if it's moving too slow.
+	for (int32 i : DueBalls)
+	{
+		if (!isMeshChangeAllowed[i])
+			continue;
+
+		const bool isSimple = Velocities[i].SizeSquared() >= FMath::Square(Balls[i]->SpeedAtWhichMeshTransitionsBackToComplex);
+		if (isSimple != isUsingSimpleColider[i])
+			Balls[i]->SetColider(isSimple);
+	}
+}
+
+void ABallManager::UpdateMaterials()
+{
+	ULTRABALL_SCOPE_CYCLE_COUNTER(STAT_BallMaterialUpdate);
+
+	// Fade UltraBall out as its camera gets close, and hide it once the camera is inside it.
+	for (int32 i : DueBalls)
+	{
+		ABall* Ball = Balls[i];
+		const float CameraDistance = FVector::Dist(Ball->Camera->GetComponentLocation(), Locations[i]);
+		const bool isVisible = CameraDistance >= 60.0f;
+		if (Ball->UltraBall->IsVisible() != isVisible)
+			Ball->UltraBall->SetVisibility(isVisible);
+
+		if (isVisible)
+		{
+			float transparency = 1.0f - ((1.0f / Ball->CurrentZoomAmount) * (CameraDistance - 100.0f));
+			if (transparency < 0.5f) { transparency = 0.0f; }
+			if (transparency >= 0.5f) { transparency = -((0.5 - transparency) * 2); }
+			if (transparency > 0.8f) { transparency = 1.0f; }
+			Ball->SetMaterialParameter(MaterialAlphas[i], AlphaParameterName, transparency);
+		}
+		Ball->SetMaterialParameter(MaterialBlackenings[i], BlackeningParameterName, BlackeningAmounts[i]);
+	}
+}
+
+void ABallManager::ApplyFieldForces()
+{
+	// Apply the Gravity and Launcher fields during each physics step so they don't depend on the frame rate.
+	GravityZ = GetWorld()->GetGravityZ();
+	for (int32 i : DueBalls)
+	{
+		ABall* Ball = Balls[i];
+		{
+			FScopeLock Lock(&Ball->SubstepLock);
+			Ball->SubstepGravityZ = GravityZ;
+		}
+		if (FBodyInstance* BodyInstance = Ball->UltraBall->GetBodyInstance())
+			BodyInstance->AddCustomPhysics(Ball->OnCalculateCustomPhysics);
+	}
+}
+
+void ABallManager::UpdateRest(float Now)
+{
+	// If a ball has come to rest and nothing is happening, stop ticking it every frame until something wakes it up.
+	for (int32 i : DueBalls)
+	{
+		if (isResting[i] || FireStates[i] != EBallFireState::Idle || ZoneStates[i] != EBallZoneState::InNoZone || isAwake[i] || GroundTraceHandles[i].IsValid())
+			continue;
+
+		isResting[i] = true;
+		NextTickTimes[i] = Balls[i]->RestTickInterval > 0.0f ? Now + Balls[i]->RestTickInterval : MAX_flt;
+	}
+}
@@ -0,0 +1,127 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "WorldCollision.h"
+#include "Simulation/BatchIntegrator.h"
+#include "BallManager.generated.h"
+
+class ABall;
+
+// What UltraBall is doing with its charge.
+enum class EBallFireState : uint8 { Idle, Charging };
+
+// Whether UltraBall can be fired again.
+enum class EBallChargeState : uint8 { HaveCharges, HaveNoCharges };
+
+// Whether UltraBall is touching the ground.
+enum class EBallLocationState : uint8 { OnTheGround, InTheAir };
+
+// Which kind of field is pulling UltraBall. Replays store this in two bits, so don't add more.
+enum class EBallZoneState : uint8 { InGravityZone, InLaunchZone, InNoZone };
+
+/**
+ * Holds the gameplay state of every UltraBall in the level, one array per value, and ticks them all in a single pass.
+ * Each ball owns a slot in the arrays for as long as it is in play. The arrays are sized for MaxBalls up front and
+ * never move. Only the game thread touches them. The physics step hands its zone state over through the ball.
+ * Spawned by the first ball to begin play. Further balls for party and race modes are added with SpawnBall.
+ */
+UCLASS(NotPlaceable, Transient)
+class GOLF_API ABallManager : public AActor
+{
+	GENERATED_BODY()
+
+	friend class ABall;
+
+public:
+	// Sets default values for this actor's properties
+	ABallManager();
+
+	// Called every frame
+	virtual void Tick(float DeltaTime) override;
+
+	// The most balls that can be in play at once.
+	static const int32 MaxBalls = 16;
+
+	// Returns the manager for a world, spawning it if there isn't one yet.
+	static ABallManager* Get(UWorld* World);
+
+	// Spawn another UltraBall and give it to a local player, creating the player if it doesn't exist yet.
+	// The ball is the same class as the first ball in play unless another class is given. Returns null if the level is full.
+	UFUNCTION(BlueprintCallable)
+	ABall* SpawnBall(const FTransform& Transform, int32 ControllerId, TSubclassOf<ABall> BallClass = nullptr);
+
+	// Returns how many balls are in play.
+	UFUNCTION(BlueprintPure)
+	int GetBallCount() const { return NumBalls; }
+
+	// Returns the ball in a slot, or null if the slot is empty.
+	ABall* GetBall(int32 Index) const { return Balls[Index]; }
+
+private:
+
+	// Give a ball a slot. Returns INDEX_NONE if every slot is taken.
+	int32 Register(ABall* Ball);
+
+	// Free a ball's slot when it leaves play.
+	void Unregister(int32 Index);
+
+	// The boxes in the level that Uncertainty Markers land on. Built the first time a ball asks for them and shared by every ball.
+	const std::vector<FSimBox>& GetUncertaintyBoxes();
+
+	// The passes run by each tick, over the balls that are due.
+	void ReadBodies(float Now);
+	void UpdateGroundContacts();
+	void UpdatePredictors();
+	void UpdateColiders();
+	void UpdateMaterials();
+	void ApplyFieldForces();
+	void UpdateRest(float Now);
+
+	// The ball in each slot.
+	UPROPERTY(Transient)
+	TArray<ABall*> Balls;
+	int32 NumBalls;
+
+	// The slots that are ticked this frame.
+	TArray<int32> DueBalls;
+
+	// Gameplay state.
+	TArray<EBallFireState> FireStates;
+	TArray<EBallChargeState> ChargeStates;
+	TArray<EBallLocationState> LocationStates;
+	TArray<EBallZoneState> ZoneStates;
+	TArray<float> Charges;
+	TArray<float> BlackeningAmounts;
+	TArray<bool> isMeshChangeAllowed;
+	TArray<bool> isUsingSimpleColider;
+	TArray<bool> hasPlayedSoundOnTheGroundBefore;
+
+	// Ground contact tracking. This is fed by OnHit, with a trace only used when no contacts have been reported.
+	TArray<float> LastGroundContactTimes;
+	TArray<FVector> GroundSupportNormals;
+	TArray<int32> TicksSinceGroundContact;
+	TArray<FTraceHandle> GroundTraceHandles;
+
+	// Resting balls are only ticked once they are due again.
+	TArray<bool> isResting;
+	TArray<float> NextTickTimes;
+
+	// Each body's state, read once at the start of the tick.
+	TArray<FVector> Locations;
+	TArray<FVector> Velocities;
+	TArray<bool> isAwake;
+
+	// The last value written to each parameter of each ball's Dynamic Material.
+	TArray<float> MaterialAlphas;
+	TArray<float> MaterialBlackenings;
+	TArray<float> MaterialPowers;
+
+	// The world's gravity, read each tick and handed to every ball's physics step.
+	float GravityZ;
+
+	std::vector<FSimBox> UncertaintyBoxes;
+	bool hasUncertaintyBoxes;
+};
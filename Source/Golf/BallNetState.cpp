@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BallNetState.h"
+
+// Locations are sent in tenths of a centimetre and velocities in whole cm/s. Each component takes as many bits as its size needs, up to these.
+static const uint32 LocationScale = 10;
+static const int32 LocationMaxBits = 24;
+static const uint32 VelocityScale = 1;
+static const int32 VelocityMaxBits = 20;
+
+FBallNetState::FBallNetState()
+	: Location(FVector::ZeroVector)
+	, LinearVelocity(FVector::ZeroVector)
+	, Rotation(FRotator::ZeroRotator)
+	, ShotCount(0)
+	, Par(0)
+	, hasCharges(true)
+	, isAsleep(false)
+{
+}
+
+void FBallNetState::Quantise()
+{
+	Location.X = FMath::RoundToFloat(Location.X * LocationScale) / LocationScale;
+	Location.Y = FMath::RoundToFloat(Location.Y * LocationScale) / LocationScale;
+	Location.Z = FMath::RoundToFloat(Location.Z * LocationScale) / LocationScale;
+
+	if (isAsleep)
+		LinearVelocity = FVector::ZeroVector;
+	LinearVelocity.X = FMath::RoundToFloat(LinearVelocity.X * VelocityScale) / VelocityScale;
+	LinearVelocity.Y = FMath::RoundToFloat(LinearVelocity.Y * VelocityScale) / VelocityScale;
+	LinearVelocity.Z = FMath::RoundToFloat(LinearVelocity.Z * VelocityScale) / VelocityScale;
+
+	Rotation.Pitch = FRotator::DecompressAxisFromShort(FRotator::CompressAxisToShort(Rotation.Pitch));
+	Rotation.Yaw = FRotator::DecompressAxisFromShort(FRotator::CompressAxisToShort(Rotation.Yaw));
+	Rotation.Roll = FRotator::DecompressAxisFromShort(FRotator::CompressAxisToShort(Rotation.Roll));
+}
+
+bool FBallNetState::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	// The flags go first, so a sleeping ball can leave out its velocity.
+	uint8 Flags = (hasCharges ? 1 : 0) | (isAsleep ? 2 : 0);
+	Ar.SerializeBits(&Flags, 2);
+	hasCharges = (Flags & 1) != 0;
+	isAsleep = (Flags & 2) != 0;
+
+	bOutSuccess = SerializePackedVector<LocationScale, LocationMaxBits>(Location, Ar);
+	if (isAsleep)
+		LinearVelocity = FVector::ZeroVector;
+	else
+		bOutSuccess &= SerializePackedVector<VelocityScale, VelocityMaxBits>(LinearVelocity, Ar);
+
+	Rotation.SerializeCompressedShort(Ar);
+	Ar << ShotCount;
+	Ar << Par;
+	return true;
+}
+
+bool FBallNetState::operator==(const FBallNetState& Other) const
+{
+	return Location == Other.Location
+		&& LinearVelocity == Other.LinearVelocity
+		&& Rotation == Other.Rotation
+		&& ShotCount == Other.ShotCount
+		&& Par == Other.Par
+		&& hasCharges == Other.hasCharges
+		&& isAsleep == Other.isAsleep;
+}
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "BallNetState.generated.h"
+
+/**
+ * The server's state of UltraBall, sent to every client it is relevant to.
+ * Each value is quantised to what the client needs to see, and the state is only sent when a quantised value has changed,
+ * so a ball at rest costs nothing. A moving ball is around twenty bytes an update.
+ */
+USTRUCT()
+struct GOLF_API FBallNetState
+{
+	GENERATED_BODY()
+
+	// Where UltraBall is, to the nearest millimetre.
+	FVector Location;
+
+	// How fast UltraBall is moving, to the nearest cm/s. Not sent while UltraBall is asleep.
+	FVector LinearVelocity;
+
+	// Which way UltraBall is facing, to about a hundredth of a degree.
+	FRotator Rotation;
+
+	// How many shots the server has fired. Wraps around, so only compare it by difference.
+	uint8 ShotCount;
+
+	// The server's Par.
+	uint8 Par;
+
+	// Whether UltraBall can be fired again.
+	bool hasCharges;
+
+	// Whether UltraBall's body is asleep.
+	bool isAsleep;
+
+	FBallNetState();
+
+	// Round every value to what NetSerialize sends, so comparing two states tells whether the client would see a change.
+	void Quantise();
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FBallNetState& Other) const;
+};
+
+template<>
+struct TStructOpsTypeTraits<FBallNetState> : public TStructOpsTypeTraitsBase2<FBallNetState>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
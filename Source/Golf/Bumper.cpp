@@ -7,10 +7,18 @@
 #include "Animation/AnimMontage.h"
 #include "Components/AudioComponent.h"
 #include "Ball.h"
+#include "UltraBallSimTypes.h"
+#include "GolfPerf.h"
+#include "GolfMemory.h"
+
+DECLARE_CYCLE_STAT(TEXT("Bumper Overlap"), STAT_BumperOverlap, STATGROUP_UltraBall);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Bumper Hits"), STAT_BumperHits, STATGROUP_UltraBall);
 
 // Sets default values
 ABumper::ABumper()
 {
+	GOLF_LLM_SCOPE(BumperAssets);
+
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = false;
 
@@ -57,6 +65,9 @@ void ABumper::BeginPlay()
 
 void ABumper::OnOverlapBegin(UPrimitiveComponent * OverlappedComp, AActor * OtherActor, UPrimitiveComponent * OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult & SweepResult)
 {
+	ULTRABALL_SCOPE_CYCLE_COUNTER(STAT_BumperOverlap);
+	ULTRABALL_INC_COUNTER(STAT_BumperHits);
+
 	// Other Actor is the actor that triggered the event. Check that is not ourself.  
 	if ((OtherActor != nullptr) && (OtherActor != this) && (OtherComp != nullptr))
 	{
@@ -65,8 +76,9 @@ void ABumper::OnOverlapBegin(UPrimitiveComponent * OverlappedComp, AActor * Othe
 		// Fire UltraBall in the direction of the Bumper.
 		if (ball != nullptr)
 		{
+			const FSimVector BumperVelocity = FUltraBallSim::GetBumperVelocity(UltraBallSim::ToSim(Bumper->GetForwardVector()), BouncePower);
 			OtherComp->SetPhysicsLinearVelocity(FVector(0.0f, 0.0f, 0.0f));
-			OtherComp->AddImpulse(Bumper->GetForwardVector() * OtherComp->GetMass() * BouncePower * 1000.0f);
+			OtherComp->AddImpulse(UltraBallSim::FromSim(BumperVelocity), NAME_None, true);
 			ball->BumperHit();
 		}
 
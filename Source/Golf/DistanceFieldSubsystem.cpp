@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DistanceFieldSubsystem.h"
+#include "Engine/World.h"
+#include "Engine/GameInstance.h"
+#include "Async/Async.h"
+#include "Misc/Paths.h"
+#include "UObject/UObjectGlobals.h"
+#include "GolfMemory.h"
+
+void UDistanceFieldSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	PostLoadMapHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this, &UDistanceFieldSubsystem::OnPostLoadMap);
+}
+
+void UDistanceFieldSubsystem::Deinitialize()
+{
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapHandle);
+	DistanceField.Reset();
+
+	Super::Deinitialize();
+}
+
+UDistanceFieldSubsystem* UDistanceFieldSubsystem::Get(const UWorld* World)
+{
+	UGameInstance* GameInstance = World != nullptr ? World->GetGameInstance() : nullptr;
+	return GameInstance != nullptr ? GameInstance->GetSubsystem<UDistanceFieldSubsystem>() : nullptr;
+}
+
+FString UDistanceFieldSubsystem::GetDistanceFieldFile(const FString& InLevelName)
+{
+	return FPaths::ConvertRelativePathToFull(FPaths::ProjectContentDir() / TEXT("DistanceFields") / InLevelName + TEXT(".ubsdf"));
+}
+
+void UDistanceFieldSubsystem::StreamIn(const FString& InLevelName)
+{
+	if (InLevelName == LevelName)
+		return;
+
+	LevelName = InLevelName;
+	DistanceField.Reset();
+
+	// Map the file on a worker thread, then hand it over on the game thread if the level hasn't changed again.
+	TWeakObjectPtr<UDistanceFieldSubsystem> WeakThis(this);
+	const FString File = GetDistanceFieldFile(InLevelName);
+	Async(EAsyncExecution::ThreadPool, [WeakThis, File, InLevelName]()
+	{
+		GOLF_LLM_SCOPE(Simulation);
+		TSharedPtr<FSimDistanceField, ESPMode::ThreadSafe> Loaded = MakeShared<FSimDistanceField, ESPMode::ThreadSafe>();
+		if (!Loaded->Open(TCHAR_TO_UTF8(*File)))
+			return;
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Loaded, InLevelName]()
+		{
+			UDistanceFieldSubsystem* Subsystem = WeakThis.Get();
+			if (Subsystem != nullptr && Subsystem->LevelName == InLevelName)
+				Subsystem->DistanceField = Loaded;
+		});
+	});
+}
+
+void UDistanceFieldSubsystem::OnPostLoadMap(UWorld* World)
+{
+	if (World != nullptr && World->GetGameInstance() == GetGameInstance())
+		StreamIn(UWorld::RemovePIEPrefix(World->GetMapName()));
+}
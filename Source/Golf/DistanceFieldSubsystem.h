@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Simulation/DistanceField.h"
+#include "DistanceFieldSubsystem.generated.h"
+
+/**
+ * Streams in the baked Distance Field for the current level.
+ * Fields are baked by the BakeDistanceField commandlet into Content/DistanceFields and mapped on a worker thread
+ * whenever a level loads. Levels without a baked field simply have none.
+ */
+UCLASS()
+class GOLF_API UDistanceFieldSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// Returns the subsystem for this world, or null if there isn't one.
+	static UDistanceFieldSubsystem* Get(const UWorld* World);
+
+	// Returns the file a level's Distance Field is baked into.
+	static FString GetDistanceFieldFile(const FString& LevelName);
+
+	// Start mapping the Distance Field for a level, dropping the one for the previous level.
+	void StreamIn(const FString& LevelName);
+
+	// Returns the Distance Field for the current level, or null if it hasn't streamed in or wasn't baked.
+	TSharedPtr<const FSimDistanceField, ESPMode::ThreadSafe> GetDistanceField() const { return DistanceField; }
+
+private:
+
+	void OnPostLoadMap(UWorld* World);
+
+	FString LevelName;
+	TSharedPtr<const FSimDistanceField, ESPMode::ThreadSafe> DistanceField;
+	FDelegateHandle PostLoadMapHandle;
+};
@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ExportLevelSnapshotCommandlet.h"
+#include "Misc/Paths.h"
+#include "HAL/FileManager.h"
+#include "Simulation/LevelSnapshot.h"
+#include "SimWorldBuilder.h"
+#include "UltraBallSimTypes.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogLevelSnapshot, Log, All);
+
+UExportLevelSnapshotCommandlet::UExportLevelSnapshotCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UExportLevelSnapshotCommandlet::Main(const FString& Params)
+{
+	FString LevelFilter;
+	FParse::Value(*Params, TEXT("Level="), LevelFilter);
+
+	FString OutputDir = FPaths::ProjectSavedDir() / TEXT("LevelSnapshots");
+	FParse::Value(*Params, TEXT("Output="), OutputDir);
+	IFileManager::Get().MakeDirectory(*OutputDir, true);
+
+	TArray<FString> LevelFiles;
+	FSimWorldBuilder::FindLevelFiles(LevelFiles);
+
+	int32 NumFailed = 0;
+	for (const FString& LevelFile : LevelFiles)
+	{
+		const FString LevelName = FPaths::GetBaseFilename(LevelFile);
+		if (!LevelFilter.IsEmpty() && LevelName != LevelFilter)
+			continue;
+
+		FSimSettings SimSettings;
+		FSimWorld SimWorld;
+		FSimLevelInfo LevelInfo;
+		if (!FSimWorldBuilder::BuildLevel(LevelFile, SimSettings, SimWorld, LevelInfo))
+		{
+			NumFailed++;
+			UE_LOG(LogLevelSnapshot, Warning, TEXT("%s: Could not load the level."), *LevelName);
+			continue;
+		}
+
+		if (LevelInfo.hasUnsupportedActors)
+		{
+			NumFailed++;
+			UE_LOG(LogLevelSnapshot, Error, TEXT("%s: Skipped, the level has actors the simulation can't model."), *LevelName);
+			continue;
+		}
+
+		FLevelSnapshotInfo SnapshotInfo;
+		SnapshotInfo.BallLocation = UltraBallSim::ToSim(LevelInfo.BallLocation);
+		SnapshotInfo.MaxParAllowed = LevelInfo.MaxParAllowed;
+		SnapshotInfo.MaxChargePossibleAtFullChargeUp = LevelInfo.MaxChargePossibleAtFullChargeUp;
+		SnapshotInfo.GravityZ = LevelInfo.GravityZ;
+
+		const FString SnapshotFile = FPaths::ConvertRelativePathToFull(OutputDir / LevelName + TEXT(".ubsnap"));
+		if (!FLevelSnapshot::Write(TCHAR_TO_UTF8(*SnapshotFile), SimWorld, SnapshotInfo))
+		{
+			NumFailed++;
+			UE_LOG(LogLevelSnapshot, Warning, TEXT("%s: Could not write %s."), *LevelName, *SnapshotFile);
+			continue;
+		}
+
+		UE_LOG(LogLevelSnapshot, Display, TEXT("%s: %d boxes, %d triangles, %d bumpers, %d fields and %d finishes written to %s."),
+			*LevelName, (int32)SimWorld.Boxes.size(), (int32)SimWorld.Triangles.size(), (int32)SimWorld.Bumpers.size(),
+			(int32)SimWorld.Fields.size(), (int32)SimWorld.Finishes.size(), *SnapshotFile);
+	}
+
+	return NumFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ExportLevelSnapshotCommandlet.generated.h"
+
+/**
+ * Writes a Level Snapshot of every level under Content/Levels, for tools that simulate UltraBall without the engine.
+ * Snapshots are written to Saved/LevelSnapshots unless another directory is given.
+ *
+ * Usage: UE4Editor-Cmd.exe Golf.uproject -run=ExportLevelSnapshot [-Level=Name] [-Output=Directory]
+ */
+UCLASS()
+class UExportLevelSnapshotCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UExportLevelSnapshotCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -4,11 +4,20 @@
 #include "UObject/ConstructorHelpers.h" 
 #include "Components/StaticMeshComponent.h"
 #include "Materials/MaterialInstanceDynamic.h" 
+#include "Kismet/GameplayStatics.h"
 #include "Ball.h"
+#include "ReplaySubsystem.h"
+#include "LevelTransitionSubsystem.h"
+#include "GolfPerf.h"
+#include "GolfMemory.h"
+
+DECLARE_CYCLE_STAT(TEXT("Finish Target Tick"), STAT_FinishTargetTick, STATGROUP_UltraBall);
 
 // Sets default values
 AFinishTarget::AFinishTarget()
 {
+	GOLF_LLM_SCOPE(FinishTargetAssets);
+
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
@@ -45,6 +54,8 @@ AFinishTarget::AFinishTarget()
 	}
 
 	NextLevel = FName("None");
+	isPreloadingOnStart = true;
+	PreloadDistance = 3000.0f;
 
 }
 
@@ -53,11 +64,16 @@ void AFinishTarget::BeginPlay()
 {
 	Super::BeginPlay();
 	HasFinishedLevel = false;
+	hasStartedPreload = false;
+
+	if (isPreloadingOnStart)
+		PreloadNextLevel();
 }
 
 // Called every frame
 void AFinishTarget::Tick(float DeltaTime)
 {
+	ULTRABALL_SCOPE_CYCLE_COUNTER(STAT_FinishTargetTick);
 	Super::Tick(DeltaTime);
 
 	// Cause the Inner Ring to Constantly Rotate.
@@ -68,6 +84,14 @@ void AFinishTarget::Tick(float DeltaTime)
 
 	// Update the Inner Ring's position to match the Outer Rings position.
 	UltraBallInner->SetWorldLocation(UltraBallOuter->GetComponentLocation());
+
+	// Start loading the Next Level once the player's UltraBall is close.
+	if (!hasStartedPreload)
+	{
+		const APawn* Pawn = UGameplayStatics::GetPlayerPawn(this, 0);
+		if (Pawn != nullptr && FVector::DistSquared(Pawn->GetActorLocation(), UltraBallOuter->GetComponentLocation()) < FMath::Square(PreloadDistance))
+			PreloadNextLevel();
+	}
 }
 
 void AFinishTarget::OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
@@ -79,7 +103,13 @@ void AFinishTarget::OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPri
 
 		if (ball != nullptr)
 		{
+			// Record the finish in the replay the first time UltraBall gets here.
+			UReplaySubsystem* ReplaySubsystem = UReplaySubsystem::Get(GetWorld());
+			if (!HasFinishedLevel && ReplaySubsystem != nullptr)
+				ReplaySubsystem->RecordFinish(ball, ball->GetCurrentPar());
+
 			HasFinishedLevel = true;
+			PreloadNextLevel();
 		}
 	}
 }
@@ -94,3 +124,21 @@ FName AFinishTarget::GetNextLevel()
 	return NextLevel;
 }
 
+void AFinishTarget::OpenNextLevel()
+{
+	if (ULevelTransitionSubsystem* LevelTransition = ULevelTransitionSubsystem::Get(GetWorld()))
+		LevelTransition->OpenLevel(GetWorld(), NextLevel);
+	else
+		UGameplayStatics::OpenLevel(this, NextLevel);
+}
+
+void AFinishTarget::PreloadNextLevel()
+{
+	if (hasStartedPreload)
+		return;
+	hasStartedPreload = true;
+
+	if (ULevelTransitionSubsystem* LevelTransition = ULevelTransitionSubsystem::Get(GetWorld()))
+		LevelTransition->Preload(GetWorld(), NextLevel);
+}
+
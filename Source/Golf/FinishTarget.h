@@ -45,8 +45,25 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Designer")
 	FName NextLevel;
 
+	// Open the Next Level. It is loaded in the background while this level is played, so this doesn't stop for a load.
+	// Call this rather than Open Level.
+	UFUNCTION(BlueprintCallable)
+	void OpenNextLevel();
+
+	// Designer: Whether the Next Level starts loading in the background as soon as this level starts.
+	UPROPERTY(EditAnywhere, Category = "Designer")
+	bool isPreloadingOnStart;
+
+	// Designer: How close the player's UltraBall has to get for the Next Level to start loading, when it isn't loaded from the start.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "0.0", ClampMax = "100000.0", UIMin = "0.0", UIMax = "100000.0"))
+	float PreloadDistance;
+
 private:
 
 	bool HasFinishedLevel;
 
+	// Start loading the Next Level in the background, if it hasn't been started already.
+	void PreloadNextLevel();
+	bool hasStartedPreload;
+
 };
@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GhostBalls.h"
+#include "UObject/ConstructorHelpers.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Materials/MaterialInstance.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "Simulation/Replay.h"
+#include "ReplaySubsystem.h"
+#include "UltraBallSimTypes.h"
+#include "GolfPerf.h"
+#include "GolfMemory.h"
+
+DECLARE_CYCLE_STAT(TEXT("Ghost Balls Tick"), STAT_GhostBallsTick, STATGROUP_UltraBall);
+
+AGhostBalls::AGhostBalls()
+{
+	GOLF_LLM_SCOPE(BallAssets);
+
+	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
+	PrimaryActorTick.bCanEverTick = true;
+
+	// Setup the Ghosts. They are only drawn, so they have no physics, collision or shadows.
+	Ghosts = CreateDefaultSubobject<UInstancedStaticMeshComponent>("Ghosts");
+	ConstructorHelpers::FObjectFinder<UStaticMesh> UltraBallComplex(TEXT("StaticMesh'/Game/Models/UltraBallC.UltraBallC'"));
+	if (UltraBallComplex.Succeeded())
+		Ghosts->SetStaticMesh(UltraBallComplex.Object);
+	ConstructorHelpers::FObjectFinder<UMaterialInstance> Material(TEXT("MaterialInstanceConstant'/Game/Textures/MaterialInstance/UltraBall_MI.UltraBall_MI'"));
+	if (Material.Succeeded())
+		Ghosts->SetMaterial(0, Material.Object);
+	Ghosts->SetSimulatePhysics(false);
+	Ghosts->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Ghosts->SetGenerateOverlapEvents(false);
+	Ghosts->SetCanEverAffectNavigation(false);
+	Ghosts->SetCastShadow(false);
+	Ghosts->SetAbsolute(true, true, true);
+	RootComponent = Ghosts;
+
+	MaxGhosts = 100;
+}
+
+// Called when the game starts or when spawned
+void AGhostBalls::BeginPlay()
+{
+	Super::BeginPlay();
+	LoadGhosts();
+}
+
+void AGhostBalls::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Replays.Reset();
+	Super::EndPlay(EndPlayReason);
+}
+
+void AGhostBalls::LoadGhosts()
+{
+	GOLF_LLM_SCOPE(Golf);
+	Replays.Reset();
+
+	// Replays are named after the level and the time they were recorded, so sorting the names backwards puts the newest first.
+	const FString LevelName = UWorld::RemovePIEPrefix(GetWorld()->GetMapName());
+	TArray<FString> Files;
+	IFileManager::Get().FindFiles(Files, *(UReplaySubsystem::GetReplayDir() / LevelName + TEXT("-*.ubreplay")), true, false);
+	Files.Sort([](const FString& A, const FString& B) { return A > B; });
+
+	// The run being recorded now has no whole chunks yet, so it is skipped along with any empty replays.
+	RaceLength = 0.0f;
+	for (const FString& File : Files)
+	{
+		if (Replays.Num() >= MaxGhosts)
+			break;
+
+		TSharedPtr<FReplayReader> Replay = UReplaySubsystem::OpenReplay(UReplaySubsystem::GetReplayDir() / File);
+		if (!Replay.IsValid() || Replay->GetNumSamples() == 0 || LevelName != UTF8_TO_TCHAR(Replay->GetHeader().LevelName))
+			continue;
+
+		RaceLength = FMath::Max(RaceLength, Replay->GetNumSamples() / Replay->GetHeader().SampleRate);
+		Replays.Add(Replay);
+	}
+
+	// Create one instance for every ghost. They are moved into place by the first tick.
+	Ghosts->ClearInstances();
+	GhostTransforms.Init(FTransform::Identity, Replays.Num());
+	for (const FTransform& GhostTransform : GhostTransforms)
+		Ghosts->AddInstance(GhostTransform);
+
+	RestartRace();
+}
+
+void AGhostBalls::RestartRace()
+{
+	RaceStartTime = GetWorld()->GetTimeSeconds();
+	SetActorTickEnabled(Replays.Num() > 0);
+}
+
+// Called every frame
+void AGhostBalls::Tick(float DeltaTime)
+{
+	ULTRABALL_SCOPE_CYCLE_COUNTER(STAT_GhostBallsTick);
+	Super::Tick(DeltaTime);
+
+	// Each ghost decodes one chunk of its replay at a time, as the race reaches it.
+	const float RaceTime = GetWorld()->GetTimeSeconds() - RaceStartTime;
+	for (int32 i = 0; i < Replays.Num(); i++)
+	{
+		FReplaySample Sample;
+		if (!Replays[i]->GetSampleAtTime(RaceTime, Sample))
+			continue;
+
+		GhostTransforms[i].SetLocation(UltraBallSim::FromSim(Sample.Location));
+		GhostTransforms[i].SetRotation(FQuat(Sample.Rotation.X, Sample.Rotation.Y, Sample.Rotation.Z, Sample.Rotation.W));
+	}
+	Ghosts->BatchUpdateInstancesTransforms(0, GhostTransforms, true, true, true);
+
+	// Every ghost rests where its run ended, so there is nothing left to move once the longest run is over.
+	if (RaceTime > RaceLength)
+		SetActorTickEnabled(false);
+}
@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "GhostBalls.generated.h"
+
+class FReplayReader;
+
+/**
+ * Races recorded runs of the current level as ghosts of UltraBall.
+ * Every ghost is an instance of one mesh with no collision, and all of them are moved by a single update each frame,
+ * so a hundred ghosts cost about the same to draw as one. Their transforms are blended between replay samples.
+ */
+UCLASS()
+class GOLF_API AGhostBalls : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this actor's properties
+	AGhostBalls();
+
+protected:
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	// Called every frame
+	virtual void Tick(float DeltaTime) override;
+
+	// Ghosts - One instance of UltraBall for every ghost.
+	UPROPERTY(VisibleAnywhere)
+	class UInstancedStaticMeshComponent* Ghosts;
+
+	// Designer: The most ghosts to race at once. The newest runs of the level are raced first.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "0", ClampMax = "100", UIMin = "0", UIMax = "100"))
+	int MaxGhosts;
+
+	// Load the recorded runs of the current level, replacing any ghosts already racing.
+	UFUNCTION(BlueprintCallable)
+	void LoadGhosts();
+
+	// Start every ghost from the beginning of its run.
+	UFUNCTION(BlueprintCallable)
+	void RestartRace();
+
+	// Returns how many ghosts are racing.
+	UFUNCTION(BlueprintPure)
+	int GetGhostCount() const { return Replays.Num(); }
+
+private:
+
+	// The replay behind each ghost.
+	TArray<TSharedPtr<FReplayReader>> Replays;
+
+	// Instance transforms for the ghosts. Kept between ticks so they aren't reallocated.
+	TArray<FTransform> GhostTransforms;
+
+	// When the race started, and how long the longest run lasts.
+	float RaceStartTime;
+	float RaceLength;
+};
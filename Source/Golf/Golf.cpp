@@ -2,5 +2,23 @@
 
 #include "Golf.h"
 #include "Modules/ModuleManager.h"
+#include "GolfHitchDetector.h"
+#include "GolfMemory.h"
+#include "GolfDeterminism.h"
+#include "Misc/CommandLine.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, Golf, "Golf" );
+void FGolfModule::StartupModule()
+{
+	RegisterGolfLLMTags();
+	FGolfHitchDetector::Start();
+
+	if (FParse::Param(FCommandLine::Get(), TEXT("UltraBallDeterministic")))
+		FGolfDeterminism::SetEnabled(true);
+}
+
+void FGolfModule::ShutdownModule()
+{
+	FGolfHitchDetector::Stop();
+}
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FGolfModule, Golf, "Golf" );
@@ -3,4 +3,13 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Modules/ModuleManager.h"
 
+// The Golf game module. Starts the services that watch the whole game, such as the hitch detector and the memory tracker tags.
+class FGolfModule : public FDefaultGameModuleImpl
+{
+public:
+
+	virtual void StartupModule() override;
+	virtual void ShutdownModule() override;
+};
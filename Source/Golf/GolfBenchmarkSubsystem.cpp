@@ -0,0 +1,515 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GolfBenchmarkSubsystem.h"
+#include "Engine/World.h"
+#include "Engine/GameInstance.h"
+#include "EngineUtils.h"
+#include "HAL/FileManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/CommandLine.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "PhysicsPublic.h"
+#include "Ball.h"
+#include "GolfPerf.h"
+#include "GolfDeterminism.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogGolfBenchmark, Log, All);
+
+// How long the charge is held for each shot, in frames.
+static const int32 ChargeFrames = 30;
+
+// How long UltraBall has to be in flight before it can count as resting.
+static const float MinShotTime = 0.5f;
+
+// Regressions smaller than this are treated as noise, however large they are relative to the baseline.
+static const float MinRegressionMs = 0.05f;
+
+bool UGolfBenchmarkSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return FParse::Param(FCommandLine::Get(), TEXT("UltraBallBenchmark"));
+}
+
+void UGolfBenchmarkSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// Every level that can be finished, in the order they are played.
+	Levels = { TEXT("Level_1"), TEXT("Level2"), TEXT("Level3"), TEXT("Level4"),
+		TEXT("xLevel1"), TEXT("xLevel2"), TEXT("xLevel3"), TEXT("xLevel4"), TEXT("xLevel5"), TEXT("xLevel6"), TEXT("xLevel7"), TEXT("xLevel8"),
+		TEXT("SecretLevel") };
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	FString LevelList;
+	if (FParse::Value(CommandLine, TEXT("BenchmarkLevels="), LevelList, false))
+		LevelList.ParseIntoArray(Levels, TEXT("+"));
+
+	NumShots = 4;
+	WarmUpFrames = 60;
+	MaxShotTime = 8.0f;
+	Tolerance = 0.15f;
+	OutputDir = FPaths::ProjectSavedDir() / TEXT("Benchmarks");
+	FParse::Value(CommandLine, TEXT("BenchmarkShots="), NumShots);
+	FParse::Value(CommandLine, TEXT("BenchmarkWarmUp="), WarmUpFrames);
+	FParse::Value(CommandLine, TEXT("BenchmarkShotTime="), MaxShotTime);
+	FParse::Value(CommandLine, TEXT("BenchmarkTolerance="), Tolerance);
+	FParse::Value(CommandLine, TEXT("BenchmarkOutput="), OutputDir);
+	FParse::Value(CommandLine, TEXT("BenchmarkBaseline="), BaselineDir);
+	NumShots = FMath::Max(NumShots, 1);
+	IFileManager::Get().MakeDirectory(*OutputDir, true);
+
+	// Golden trajectories only mean anything if every run plays out the same way.
+	FString Golden;
+	FParse::Value(CommandLine, TEXT("BenchmarkGolden="), Golden);
+	GoldenMode = Golden == TEXT("Record") ? EGoldenMode::Record : Golden == TEXT("Verify") ? EGoldenMode::Verify : EGoldenMode::None;
+	GoldenDir = FPaths::ProjectDir() / TEXT("GoldenTrajectories");
+	GoldenTolerance = 1.0f;
+	FParse::Value(CommandLine, TEXT("GoldenDir="), GoldenDir);
+	FParse::Value(CommandLine, TEXT("GoldenTolerance="), GoldenTolerance);
+	if (GoldenMode != EGoldenMode::None)
+		FGolfDeterminism::SetEnabled(true);
+	if (GoldenMode == EGoldenMode::Record)
+		IFileManager::Get().MakeDirectory(*GoldenDir, true);
+
+	isRunning = true;
+	isRecording = false;
+	isOpeningLevel = false;
+	Stage = EBenchmarkStage::Loading;
+	StageFrames = 0;
+	StageStartTime = 0.0f;
+	LevelIndex = 0;
+	ShotIndex = 0;
+	FrameStartCycles = 0;
+	Regressions.Reset();
+
+	TimedPhysScene = nullptr;
+	PhysicsStepStartCycles = 0;
+
+	PostLoadMapHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this, &UGolfBenchmarkSubsystem::OnPostLoadMap);
+	WorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddUObject(this, &UGolfBenchmarkSubsystem::OnWorldCleanup);
+	BeginFrameHandle = FCoreDelegates::OnBeginFrame.AddUObject(this, &UGolfBenchmarkSubsystem::OnBeginFrame);
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddUObject(this, &UGolfBenchmarkSubsystem::OnEndFrame);
+
+	UE_LOG(LogGolfBenchmark, Display, TEXT("Benchmarking %d levels with %d shots each. Results are written to %s."),
+		Levels.Num(), NumShots, *FPaths::ConvertRelativePathToFull(OutputDir));
+}
+
+void UGolfBenchmarkSubsystem::Deinitialize()
+{
+	UnregisterPhysicsTimers();
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapHandle);
+	FWorldDelegates::OnWorldCleanup.Remove(WorldCleanupHandle);
+	FCoreDelegates::OnBeginFrame.Remove(BeginFrameHandle);
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+	isRunning = false;
+
+	// Give the engine its own frame rate and physics settings back.
+	if (GoldenMode != EGoldenMode::None)
+	{
+		FGolfDeterminism::SetEnabled(false);
+		FGolfDeterminism::Apply();
+	}
+
+	Super::Deinitialize();
+}
+
+TStatId UGolfBenchmarkSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UGolfBenchmarkSubsystem, STATGROUP_Tickables);
+}
+
+void UGolfBenchmarkSubsystem::Tick(float DeltaTime)
+{
+	UWorld* World = BenchmarkWorld.Get();
+	if (Stage == EBenchmarkStage::Loading || World == nullptr)
+	{
+		if (!isOpeningLevel)
+			OpenCurrentLevel();
+		return;
+	}
+
+	ABall* CurrentBall = Ball.Get();
+	if (CurrentBall == nullptr)
+	{
+		UE_LOG(LogGolfBenchmark, Warning, TEXT("%s: Skipped, the level has no UltraBall."), *Levels[LevelIndex]);
+		LevelIndex++;
+		OpenCurrentLevel();
+		return;
+	}
+
+	StageFrames++;
+	const float StageTime = World->GetTimeSeconds() - StageStartTime;
+
+	// Follow UltraBall through every shot.
+	if (Stage == EBenchmarkStage::Charging || Stage == EBenchmarkStage::InFlight)
+		ShotPaths[ShotIndex].Add(CurrentBall->GetActorLocation());
+
+	switch (Stage)
+	{
+	case EBenchmarkStage::WarmingUp:
+		if (StageFrames < WarmUpFrames)
+			break;
+
+		// Start recording with the first shot.
+		isRecording = true;
+		Stage = EBenchmarkStage::Charging;
+		StageFrames = 0;
+		StageStartTime = World->GetTimeSeconds();
+		break;
+
+	case EBenchmarkStage::Charging:
+	{
+		// Spread the shots evenly around UltraBall, with the charge rising from a tap to a full charge.
+		const float ShotFraction = NumShots > 1 ? (float)ShotIndex / (NumShots - 1) : 1.0f;
+		if (StageFrames == 1)
+		{
+			CurrentBall->LookLeft(360.0f / NumShots);
+			CurrentBall->Fire();
+		}
+
+		// Hold the charge steady, since Blueprints may also be setting it while charging.
+		CurrentBall->setCurrentCharge(FMath::Lerp(0.2f, 1.0f, ShotFraction));
+		if (StageFrames < ChargeFrames)
+			break;
+
+		CurrentBall->EndFire();
+		Stage = EBenchmarkStage::InFlight;
+		StageFrames = 0;
+		StageStartTime = World->GetTimeSeconds();
+		break;
+	}
+
+	case EBenchmarkStage::InFlight:
+	{
+		// Wait until UltraBall has come to rest, or give up on it.
+		const bool isAtRest = StageTime >= MinShotTime && !CurrentBall->UltraBall->RigidBodyIsAwake();
+		if (!isAtRest && StageTime < MaxShotTime)
+			break;
+
+		ShotIndex++;
+		if (ShotIndex >= NumShots)
+		{
+			FinishLevel();
+			break;
+		}
+
+		Stage = EBenchmarkStage::Charging;
+		StageFrames = 0;
+		StageStartTime = World->GetTimeSeconds();
+		break;
+	}
+
+	default:
+		break;
+	}
+}
+
+void UGolfBenchmarkSubsystem::OpenCurrentLevel()
+{
+	isRecording = false;
+	Stage = EBenchmarkStage::Loading;
+	BenchmarkWorld.Reset();
+	Ball.Reset();
+
+	if (LevelIndex >= Levels.Num())
+	{
+		// Every level has been run. Leave a file behind listing any regressions, so a script can gate on it.
+		if (!BaselineDir.IsEmpty() || GoldenMode == EGoldenMode::Verify)
+			FFileHelper::SaveStringArrayToFile(Regressions, *(OutputDir / TEXT("Regressions.txt")));
+
+		UE_LOG(LogGolfBenchmark, Display, TEXT("Benchmark finished with %d regressions."), Regressions.Num());
+		isRunning = false;
+		FPlatformMisc::RequestExit(false);
+		return;
+	}
+
+	UWorld* World = GetGameInstance()->GetWorld();
+	if (World == nullptr)
+		return;
+
+	UE_LOG(LogGolfBenchmark, Display, TEXT("Loading %s."), *Levels[LevelIndex]);
+	isOpeningLevel = true;
+	UGameplayStatics::OpenLevel(World, FName(*Levels[LevelIndex]));
+}
+
+void UGolfBenchmarkSubsystem::FinishLevel()
+{
+	const FString& LevelName = Levels[LevelIndex];
+	WriteResults(LevelName);
+	if (!BaselineDir.IsEmpty())
+		CompareWithBaseline(LevelName);
+	if (GoldenMode == EGoldenMode::Record)
+		WriteGoldenPaths(LevelName);
+	else if (GoldenMode == EGoldenMode::Verify)
+		CompareWithGoldenPaths(LevelName);
+
+	LevelIndex++;
+	OpenCurrentLevel();
+}
+
+// Returns the average, median, 95th percentile and maximum of a set of values.
+static TSharedRef<FJsonObject> MakeSummary(TArray<float> Values)
+{
+	TSharedRef<FJsonObject> Summary = MakeShared<FJsonObject>();
+	if (Values.Num() == 0)
+		return Summary;
+
+	Values.Sort();
+	float Total = 0.0f;
+	for (float Value : Values)
+		Total += Value;
+
+	Summary->SetNumberField(TEXT("Average"), Total / Values.Num());
+	Summary->SetNumberField(TEXT("Median"), Values[Values.Num() / 2]);
+	Summary->SetNumberField(TEXT("P95"), Values[FMath::Min(FMath::FloorToInt(Values.Num() * 0.95f), Values.Num() - 1)]);
+	Summary->SetNumberField(TEXT("Max"), Values.Last());
+	Summary->SetNumberField(TEXT("Total"), Total);
+	return Summary;
+}
+
+void UGolfBenchmarkSubsystem::WriteResults(const FString& LevelName) const
+{
+	TArray<float> GameThreadMs, BallTickMs, PhysicsStepMs, SceneQueries;
+	FString Csv = TEXT("Frame,GameThreadMs,BallTickMs,PhysicsStepMs,SceneQueries\n");
+	for (int32 i = 0; i < Frames.Num(); i++)
+	{
+		const FGolfBenchmarkFrame& Frame = Frames[i];
+		GameThreadMs.Add(Frame.GameThreadMs);
+		BallTickMs.Add(Frame.BallTickMs);
+		PhysicsStepMs.Add(Frame.PhysicsStepMs);
+		SceneQueries.Add((float)Frame.SceneQueries);
+		Csv += FString::Printf(TEXT("%d,%.4f,%.4f,%.4f,%d\n"), i, Frame.GameThreadMs, Frame.BallTickMs, Frame.PhysicsStepMs, Frame.SceneQueries);
+	}
+
+	TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+	Json->SetStringField(TEXT("Level"), LevelName);
+	Json->SetNumberField(TEXT("Frames"), Frames.Num());
+	Json->SetNumberField(TEXT("Shots"), NumShots);
+	Json->SetObjectField(TEXT("GameThreadMs"), MakeSummary(GameThreadMs));
+	Json->SetObjectField(TEXT("BallTickMs"), MakeSummary(BallTickMs));
+	Json->SetObjectField(TEXT("PhysicsStepMs"), MakeSummary(PhysicsStepMs));
+	Json->SetObjectField(TEXT("SceneQueries"), MakeSummary(SceneQueries));
+
+	FString JsonText;
+	TSharedRef<TJsonWriter<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&JsonText);
+	FJsonSerializer::Serialize(Json, Writer);
+
+	FFileHelper::SaveStringToFile(JsonText, *(OutputDir / LevelName + TEXT(".json")));
+	FFileHelper::SaveStringToFile(Csv, *(OutputDir / LevelName + TEXT(".csv")));
+
+	UE_LOG(LogGolfBenchmark, Display, TEXT("%s: %d frames. Game thread %.2fms, Ball tick %.3fms, Physics %.2fms, %.1f scene queries per frame."),
+		*LevelName, Frames.Num(),
+		Json->GetObjectField(TEXT("GameThreadMs"))->GetNumberField(TEXT("Average")),
+		Json->GetObjectField(TEXT("BallTickMs"))->GetNumberField(TEXT("Average")),
+		Json->GetObjectField(TEXT("PhysicsStepMs"))->GetNumberField(TEXT("Average")),
+		Json->GetObjectField(TEXT("SceneQueries"))->GetNumberField(TEXT("Average")));
+}
+
+void UGolfBenchmarkSubsystem::CompareWithBaseline(const FString& LevelName)
+{
+	FString BaselineText, CurrentText;
+	TSharedPtr<FJsonObject> Baseline, Current;
+	if (!FFileHelper::LoadFileToString(BaselineText, *(BaselineDir / LevelName + TEXT(".json")))
+		|| !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(BaselineText), Baseline) || !Baseline.IsValid())
+	{
+		UE_LOG(LogGolfBenchmark, Warning, TEXT("%s: No baseline to compare with."), *LevelName);
+		return;
+	}
+	if (!FFileHelper::LoadFileToString(CurrentText, *(OutputDir / LevelName + TEXT(".json")))
+		|| !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(CurrentText), Current) || !Current.IsValid())
+		return;
+
+	// The averages are compared for the timings, since single frames are noisy. Scene queries don't vary from run to run.
+	static const TCHAR* Metrics[] = { TEXT("GameThreadMs"), TEXT("BallTickMs"), TEXT("PhysicsStepMs"), TEXT("SceneQueries") };
+	for (const TCHAR* Metric : Metrics)
+	{
+		const TSharedPtr<FJsonObject>* BaselineMetric;
+		const TSharedPtr<FJsonObject>* CurrentMetric;
+		if (!Baseline->TryGetObjectField(Metric, BaselineMetric) || !Current->TryGetObjectField(Metric, CurrentMetric))
+			continue;
+
+		double BaselineValue = 0.0, CurrentValue = 0.0;
+		if (!(*BaselineMetric)->TryGetNumberField(TEXT("Average"), BaselineValue) || !(*CurrentMetric)->TryGetNumberField(TEXT("Average"), CurrentValue))
+			continue;
+
+		if (CurrentValue > BaselineValue * (1.0 + Tolerance) && CurrentValue - BaselineValue > MinRegressionMs)
+		{
+			const FString Regression = FString::Printf(TEXT("%s: %s rose from %.3f to %.3f."), *LevelName, Metric, BaselineValue, CurrentValue);
+			UE_LOG(LogGolfBenchmark, Error, TEXT("%s"), *Regression);
+			Regressions.Add(Regression);
+		}
+	}
+}
+
+void UGolfBenchmarkSubsystem::WriteGoldenPaths(const FString& LevelName) const
+{
+	FString Csv = TEXT("Shot,Frame,X,Y,Z\n");
+	for (int32 Shot = 0; Shot < ShotPaths.Num(); Shot++)
+	{
+		for (int32 Frame = 0; Frame < ShotPaths[Shot].Num(); Frame++)
+		{
+			const FVector& Location = ShotPaths[Shot][Frame];
+			Csv += FString::Printf(TEXT("%d,%d,%.3f,%.3f,%.3f\n"), Shot, Frame, Location.X, Location.Y, Location.Z);
+		}
+	}
+
+	const FString File = GoldenDir / LevelName + TEXT(".csv");
+	FFileHelper::SaveStringToFile(Csv, *File);
+	UE_LOG(LogGolfBenchmark, Display, TEXT("%s: Golden trajectories for %d shots written to %s."), *LevelName, ShotPaths.Num(), *File);
+}
+
+void UGolfBenchmarkSubsystem::CompareWithGoldenPaths(const FString& LevelName)
+{
+	TArray<FString> Lines;
+	if (!FFileHelper::LoadFileToStringArray(Lines, *(GoldenDir / LevelName + TEXT(".csv"))))
+	{
+		const FString Regression = FString::Printf(TEXT("%s: No golden trajectories to compare with."), *LevelName);
+		UE_LOG(LogGolfBenchmark, Error, TEXT("%s"), *Regression);
+		Regressions.Add(Regression);
+		return;
+	}
+
+	// Read the golden paths, skipping the header.
+	TArray<TArray<FVector>> GoldenPaths;
+	GoldenPaths.SetNum(ShotPaths.Num());
+	TArray<FString> Values;
+	for (int32 i = 1; i < Lines.Num(); i++)
+	{
+		Lines[i].ParseIntoArray(Values, TEXT(","));
+		if (Values.Num() != 5)
+			continue;
+
+		const int32 Shot = FCString::Atoi(*Values[0]);
+		if (GoldenPaths.IsValidIndex(Shot))
+			GoldenPaths[Shot].Add(FVector(FCString::Atof(*Values[2]), FCString::Atof(*Values[3]), FCString::Atof(*Values[4])));
+	}
+
+	// Report the first frame each shot strays from its golden path, if it does.
+	for (int32 Shot = 0; Shot < ShotPaths.Num(); Shot++)
+	{
+		const TArray<FVector>& Path = ShotPaths[Shot];
+		const TArray<FVector>& GoldenPath = GoldenPaths[Shot];
+		FString Regression;
+		for (int32 Frame = 0; Frame < FMath::Min(Path.Num(), GoldenPath.Num()); Frame++)
+		{
+			const float Distance = FVector::Dist(Path[Frame], GoldenPath[Frame]);
+			if (Distance > GoldenTolerance)
+			{
+				Regression = FString::Printf(TEXT("%s: Shot %d strayed %.2f from its golden trajectory on frame %d."), *LevelName, Shot, Distance, Frame);
+				break;
+			}
+		}
+		if (Regression.IsEmpty() && Path.Num() != GoldenPath.Num())
+			Regression = FString::Printf(TEXT("%s: Shot %d lasted %d frames, but its golden trajectory lasted %d."), *LevelName, Shot, Path.Num(), GoldenPath.Num());
+
+		if (!Regression.IsEmpty())
+		{
+			UE_LOG(LogGolfBenchmark, Error, TEXT("%s"), *Regression);
+			Regressions.Add(Regression);
+		}
+	}
+}
+
+void UGolfBenchmarkSubsystem::OnPostLoadMap(UWorld* World)
+{
+	if (World == nullptr || World->GetGameInstance() != GetGameInstance() || !Levels.IsValidIndex(LevelIndex))
+		return;
+
+	// A Blueprint may have opened a level of its own, such as the next level once the Finish Target is hit.
+	isOpeningLevel = false;
+	if (UWorld::RemovePIEPrefix(World->GetMapName()) != Levels[LevelIndex])
+	{
+		OpenCurrentLevel();
+		return;
+	}
+
+	BenchmarkWorld = World;
+	for (TActorIterator<ABall> It(World); It; ++It)
+	{
+		Ball = *It;
+		break;
+	}
+	RegisterPhysicsTimers(World);
+
+	Frames.Reset();
+	ShotPaths.Reset();
+	ShotPaths.SetNum(NumShots);
+	ShotIndex = 0;
+	Stage = EBenchmarkStage::WarmingUp;
+	StageFrames = 0;
+	StageStartTime = World->GetTimeSeconds();
+}
+
+void UGolfBenchmarkSubsystem::OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources)
+{
+	if (World != BenchmarkWorld.Get())
+		return;
+
+	UnregisterPhysicsTimers();
+	isRecording = false;
+	BenchmarkWorld.Reset();
+}
+
+void UGolfBenchmarkSubsystem::OnBeginFrame()
+{
+	FrameStartCycles = FPlatformTime::Cycles64();
+}
+
+void UGolfBenchmarkSubsystem::OnEndFrame()
+{
+	// Take the counters for this frame, whether or not they are recorded.
+	FGolfPerfCounters& Counters = FGolfPerfCounters::Get();
+	const uint64 BallTickCycles = Counters.BallTickCycles.Exchange(0);
+	const uint64 PhysicsStepCycles = Counters.PhysicsStepCycles.Exchange(0);
+	const int32 SceneQueries = Counters.SceneQueries.Exchange(0);
+	if (!isRecording || FrameStartCycles == 0)
+		return;
+
+	FGolfBenchmarkFrame& Frame = Frames.AddDefaulted_GetRef();
+	Frame.GameThreadMs = (float)FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - FrameStartCycles);
+	Frame.BallTickMs = (float)FPlatformTime::ToMilliseconds64(BallTickCycles);
+	Frame.PhysicsStepMs = (float)FPlatformTime::ToMilliseconds64(PhysicsStepCycles);
+	Frame.SceneQueries = SceneQueries;
+}
+
+void UGolfBenchmarkSubsystem::RegisterPhysicsTimers(UWorld* World)
+{
+	UnregisterPhysicsTimers();
+
+	// Time the physics scene itself, from the start of its step to its results coming back. Ticks either side of the
+	// step would also count every PrePhysics and DuringPhysics tick, including the Ball Manager's, which has its own timer.
+	TimedPhysScene = World->GetPhysicsScene();
+	if (TimedPhysScene == nullptr)
+		return;
+
+	PhysScenePreTickHandle = TimedPhysScene->OnPhysScenePreTick.AddUObject(this, &UGolfBenchmarkSubsystem::OnPhysScenePreTick);
+	PhysScenePostTickHandle = TimedPhysScene->OnPhysScenePostTick.AddUObject(this, &UGolfBenchmarkSubsystem::OnPhysScenePostTick);
+}
+
+void UGolfBenchmarkSubsystem::UnregisterPhysicsTimers()
+{
+	if (TimedPhysScene != nullptr)
+	{
+		TimedPhysScene->OnPhysScenePreTick.Remove(PhysScenePreTickHandle);
+		TimedPhysScene->OnPhysScenePostTick.Remove(PhysScenePostTickHandle);
+		TimedPhysScene = nullptr;
+	}
+	PhysicsStepStartCycles = 0;
+}
+
+void UGolfBenchmarkSubsystem::OnPhysScenePreTick(FPhysScene_PhysX* PhysScene, float DeltaTime)
+{
+	PhysicsStepStartCycles = FPlatformTime::Cycles64();
+}
+
+void UGolfBenchmarkSubsystem::OnPhysScenePostTick(FPhysScene_PhysX* PhysScene)
+{
+	const uint64 StartCycles = PhysicsStepStartCycles.Exchange(0);
+	if (StartCycles != 0)
+		FGolfPerfCounters::Get().PhysicsStepCycles += FPlatformTime::Cycles64() - StartCycles;
+}
@@ -0,0 +1,152 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Tickable.h"
+#include "GolfBenchmarkSubsystem.generated.h"
+
+class ABall;
+class FPhysScene_PhysX;
+
+// The cost of a single frame of the benchmark.
+struct FGolfBenchmarkFrame
+{
+	float GameThreadMs = 0.0f;
+	float BallTickMs = 0.0f;
+	float PhysicsStepMs = 0.0f;
+	int32 SceneQueries = 0;
+};
+
+/**
+ * Plays scripted shots through every benchmark level and records what the game code costs.
+ * Only created when the game is started with -UltraBallBenchmark. It runs under -nullrhi, so it doesn't need a GPU.
+ * Each level writes <Level>.json with a summary and <Level>.csv with every frame to Saved/Benchmarks.
+ * If -BenchmarkBaseline is given, any level that is slower than the baseline is written to Regressions.txt.
+ *
+ * -BenchmarkGolden=Record plays the shots in deterministic mode and saves the path of every shot as a golden trajectory.
+ * -BenchmarkGolden=Verify plays them again and writes any shot that strays further than the tolerance to Regressions.txt.
+ *
+ * Usage: UE4Editor Golf.uproject -game -nullrhi -nosound -unattended -benchmark -fps=60 -UltraBallBenchmark
+ *        [-BenchmarkLevels=Level_1+Level2] [-BenchmarkShots=4] [-BenchmarkWarmUp=60] [-BenchmarkShotTime=8]
+ *        [-BenchmarkOutput=Dir] [-BenchmarkBaseline=Dir] [-BenchmarkTolerance=0.15]
+ *        [-BenchmarkGolden=Record|Verify] [-GoldenDir=Dir] [-GoldenTolerance=1.0]
+ */
+UCLASS()
+class GOLF_API UGolfBenchmarkSubsystem : public UGameInstanceSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return isRunning; }
+	virtual bool IsTickableWhenPaused() const override { return true; }
+	virtual TStatId GetStatId() const override;
+
+private:
+
+	// What the benchmark is doing in the current level.
+	enum class EBenchmarkStage : uint8
+	{
+		// Waiting for the level to load.
+		Loading,
+
+		// Letting the level settle before anything is recorded.
+		WarmingUp,
+
+		// Holding the charge so the predictor runs.
+		Charging,
+
+		// Waiting for UltraBall to come to rest.
+		InFlight
+	};
+
+	// Whether golden trajectories are being recorded or checked.
+	enum class EGoldenMode : uint8
+	{
+		None,
+		Record,
+		Verify
+	};
+
+	// Open the level the benchmark is up to, or exit once every level has been run.
+	void OpenCurrentLevel();
+
+	// Write the results for the current level and move on to the next one.
+	void FinishLevel();
+
+	// Write the summary and per frame results for a level.
+	void WriteResults(const FString& LevelName) const;
+
+	// Compare a level's summary with the baseline and record anything that has got slower.
+	void CompareWithBaseline(const FString& LevelName);
+
+	// Save the path of every shot in a level as its golden trajectories.
+	void WriteGoldenPaths(const FString& LevelName) const;
+
+	// Compare the path of every shot in a level with its golden trajectories and record any that have strayed.
+	void CompareWithGoldenPaths(const FString& LevelName);
+
+	void OnPostLoadMap(UWorld* World);
+	void OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources);
+	void OnBeginFrame();
+	void OnEndFrame();
+
+	// Time the physics scene of a world as it steps, or stop timing it again.
+	void RegisterPhysicsTimers(UWorld* World);
+	void UnregisterPhysicsTimers();
+	void OnPhysScenePreTick(FPhysScene_PhysX* PhysScene, float DeltaTime);
+	void OnPhysScenePostTick(FPhysScene_PhysX* PhysScene);
+
+	bool isRunning;
+	bool isRecording;
+	bool isOpeningLevel;
+	EBenchmarkStage Stage;
+	int32 StageFrames;
+	float StageStartTime;
+
+	// Settings from the command line.
+	TArray<FString> Levels;
+	int32 NumShots;
+	int32 WarmUpFrames;
+	float MaxShotTime;
+	float Tolerance;
+	FString OutputDir;
+	FString BaselineDir;
+	EGoldenMode GoldenMode;
+	FString GoldenDir;
+	float GoldenTolerance;
+
+	// Progress through the levels and shots.
+	int32 LevelIndex;
+	int32 ShotIndex;
+	TWeakObjectPtr<UWorld> BenchmarkWorld;
+	TWeakObjectPtr<ABall> Ball;
+
+	// Frames recorded in the current level.
+	TArray<FGolfBenchmarkFrame> Frames;
+	uint64 FrameStartCycles;
+
+	// Where UltraBall was on every frame of each shot in the current level.
+	TArray<TArray<FVector>> ShotPaths;
+
+	// Levels that have got slower than the baseline, and shots that have strayed from their golden trajectories.
+	TArray<FString> Regressions;
+
+	// The physics scene being timed, and when its current step started. The step can finish on another thread.
+	FPhysScene_PhysX* TimedPhysScene;
+	TAtomic<uint64> PhysicsStepStartCycles;
+	FDelegateHandle PhysScenePreTickHandle;
+	FDelegateHandle PhysScenePostTickHandle;
+
+	FDelegateHandle PostLoadMapHandle;
+	FDelegateHandle WorldCleanupHandle;
+	FDelegateHandle BeginFrameHandle;
+	FDelegateHandle EndFrameHandle;
+};
@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GolfDeterminism.h"
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+#include "PhysicsEngine/PhysicsSettings.h"
+
+static TAutoConsoleVariable<int32> CVarDeterministic(
+	TEXT("UltraBall.Deterministic"),
+	0,
+	TEXT("When on, every frame advances by UltraBall.Deterministic.FixedStep so shots play out the same way on every machine. Takes effect when UltraBall next starts playing."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarFixedStep(
+	TEXT("UltraBall.Deterministic.FixedStep"),
+	1.0f / 60.0f,
+	TEXT("How many seconds every frame advances by in deterministic mode."),
+	ECVF_Default);
+
+// The engine and physics settings deterministic mode replaces, saved when it is applied so they can be put back when it is turned off.
+struct FSavedEngineSettings
+{
+	bool bUseFixedFrameRate;
+	float FixedFrameRate;
+	bool bSubstepping;
+	bool bSubsteppingAsync;
+	float MaxSubstepDeltaTime;
+	int32 MaxSubsteps;
+	float MaxPhysicsDeltaTime;
+};
+
+static FSavedEngineSettings SavedSettings;
+static bool isApplied = false;
+
+bool FGolfDeterminism::IsEnabled()
+{
+	return CVarDeterministic.GetValueOnGameThread() != 0;
+}
+
+void FGolfDeterminism::SetEnabled(bool isEnabled)
+{
+	CVarDeterministic->Set(isEnabled ? 1 : 0, ECVF_SetByCode);
+}
+
+float FGolfDeterminism::GetFixedStep()
+{
+	return FMath::Max(CVarFixedStep.GetValueOnGameThread(), 1.0f / 240.0f);
+}
+
+void FGolfDeterminism::Apply()
+{
+	if (GEngine == nullptr)
+		return;
+
+	UPhysicsSettings* PhysicsSettings = UPhysicsSettings::Get();
+	if (!IsEnabled())
+	{
+		// Only put back what deterministic mode changed. If it was never on, the engine's own settings are left alone.
+		if (!isApplied)
+			return;
+
+		GEngine->bUseFixedFrameRate = SavedSettings.bUseFixedFrameRate;
+		GEngine->FixedFrameRate = SavedSettings.FixedFrameRate;
+		PhysicsSettings->bSubstepping = SavedSettings.bSubstepping;
+		PhysicsSettings->bSubsteppingAsync = SavedSettings.bSubsteppingAsync;
+		PhysicsSettings->MaxSubstepDeltaTime = SavedSettings.MaxSubstepDeltaTime;
+		PhysicsSettings->MaxSubsteps = SavedSettings.MaxSubsteps;
+		PhysicsSettings->MaxPhysicsDeltaTime = SavedSettings.MaxPhysicsDeltaTime;
+		isApplied = false;
+		return;
+	}
+
+	if (!isApplied)
+	{
+		SavedSettings.bUseFixedFrameRate = GEngine->bUseFixedFrameRate;
+		SavedSettings.FixedFrameRate = GEngine->FixedFrameRate;
+		SavedSettings.bSubstepping = PhysicsSettings->bSubstepping;
+		SavedSettings.bSubsteppingAsync = PhysicsSettings->bSubsteppingAsync;
+		SavedSettings.MaxSubstepDeltaTime = PhysicsSettings->MaxSubstepDeltaTime;
+		SavedSettings.MaxSubsteps = PhysicsSettings->MaxSubsteps;
+		SavedSettings.MaxPhysicsDeltaTime = PhysicsSettings->MaxPhysicsDeltaTime;
+		isApplied = true;
+	}
+
+	// A fixed frame rate gives every frame the same delta time while still waiting for real time to catch up.
+	const float FixedStep = GetFixedStep();
+	GEngine->bUseFixedFrameRate = true;
+	GEngine->FixedFrameRate = 1.0f / FixedStep;
+
+	// Split each frame into equal substeps no longer than the saved settings allow. Working from the saved settings means
+	// applying again after the step has changed doesn't build on the substeps worked out last time.
+	PhysicsSettings->bSubstepping = true;
+	PhysicsSettings->bSubsteppingAsync = false;
+	const int32 NumSubsteps = FMath::Max(FMath::CeilToInt(FixedStep / SavedSettings.MaxSubstepDeltaTime - KINDA_SMALL_NUMBER), 1);
+	PhysicsSettings->MaxSubstepDeltaTime = FixedStep / NumSubsteps;
+	PhysicsSettings->MaxSubsteps = FMath::Max(SavedSettings.MaxSubsteps, NumSubsteps);
+	PhysicsSettings->MaxPhysicsDeltaTime = FMath::Max(SavedSettings.MaxPhysicsDeltaTime, FixedStep);
+}
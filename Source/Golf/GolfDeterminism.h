@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Deterministic gameplay mode, turned on with UltraBall.Deterministic or -UltraBallDeterministic.
+ * Every frame advances the game by the same fixed step, and physics substeps are capped at that step, so the
+ * same shot plays out the same way on every machine. The benchmark uses it to record and check golden trajectories.
+ */
+class GOLF_API FGolfDeterminism
+{
+public:
+
+	// Returns whether deterministic mode is on.
+	static bool IsEnabled();
+
+	// Turn deterministic mode on or off.
+	static void SetEnabled(bool isEnabled);
+
+	// The time every frame advances by in deterministic mode.
+	static float GetFixedStep();
+
+	// Apply the fixed step to the engine if deterministic mode is on, or put back the settings it replaced if it has been turned off.
+	// Called when UltraBall starts playing.
+	static void Apply();
+};
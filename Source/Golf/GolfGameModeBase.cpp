@@ -1,7 +1,39 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "GolfGameModeBase.h"
+#include "EngineUtils.h"
+#include "Ball.h"
+#include "BallManager.h"
 
+AGolfGameModeBase::AGolfGameModeBase()
+{
+	DefaultPawnClass = ABall::StaticClass();
+	BallSpacing = 150.0f;
+}
 
+APawn* AGolfGameModeBase::SpawnDefaultPawnFor_Implementation(AController* NewPlayer, AActor* StartSpot)
+{
+	// Hand out the placed ball if nobody has it yet. Players can join before it begins play, so look in the level rather than the Ball Manager.
+	ABall* PlacedBall = nullptr;
+	int NumBalls = 0;
+	for (TActorIterator<ABall> It(GetWorld()); It; ++It)
+	{
+		if (It->IsPendingKill())
+			continue;
+		if (It->GetController() == nullptr)
+			return *It;
+		if (PlacedBall == nullptr)
+			PlacedBall = *It;
+		NumBalls++;
+	}
 
+	// Levels without a ball start players at a Player Start.
+	ABallManager* Manager = ABallManager::Get(GetWorld());
+	if (PlacedBall == nullptr || Manager == nullptr)
+		return Super::SpawnDefaultPawnFor_Implementation(NewPlayer, StartSpot);
 
+	// Line the other balls up beside the placed ball. The player is given the ball once it returns.
+	FTransform Transform = PlacedBall->GetActorTransform();
+	Transform.AddToTranslation(PlacedBall->GetActorRightVector() * BallSpacing * NumBalls);
+	return Manager->SpawnBall(Transform, INDEX_NONE, PlacedBall->GetClass());
+}
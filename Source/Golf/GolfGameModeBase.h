@@ -7,14 +7,20 @@
 #include "GolfGameModeBase.generated.h"
 
 /**
- * 
+ * Game Mode for online play. Start the server with ?game=/Script/Golf.GolfGameModeBase to use it.
+ * The first player to join takes the UltraBall placed in the level. Everyone after gets a ball of their own next to it.
  */
 UCLASS()
 class GOLF_API AGolfGameModeBase : public AGameModeBase
 {
 	GENERATED_BODY()
-	
-	
-	
-	
+
+public:
+	AGolfGameModeBase();
+
+	virtual APawn* SpawnDefaultPawnFor_Implementation(AController* NewPlayer, AActor* StartSpot) override;
+
+	// Designer: How far apart the balls of players who join later are placed.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "0.0", ClampMax = "1000.0", UIMin = "0.0", UIMax = "1000.0"))
+	float BallSpacing;
 };
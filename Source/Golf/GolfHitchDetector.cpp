@@ -0,0 +1,163 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GolfHitchDetector.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTLS.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogGolfHitch, Log, All);
+
+static TAutoConsoleVariable<float> CVarHitchThresholdMs(
+	TEXT("UltraBall.Hitch.ThresholdMs"),
+	100.0f,
+	TEXT("Frames that take longer than this many milliseconds dump the recent UltraBall scope timings to Saved/Hitches. Zero turns the hitch detector off."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarHitchFrames(
+	TEXT("UltraBall.Hitch.Frames"),
+	8,
+	TEXT("How many frames of UltraBall scope timings are dumped when a hitch is caught."),
+	ECVF_Default);
+
+// The ring buffer. It has to hold every scope for the frames being dumped, so it is sized well above what a frame records.
+static const uint64 NumTimings = 8192;
+static FGolfScopeTiming Timings[NumTimings];
+static TAtomic<uint64> NextTiming(0);
+
+// How many frame times are remembered, which also limits UltraBall.Hitch.Frames.
+static const int32 MaxFrames = 120;
+static float FrameTimes[MaxFrames];
+
+// Frames are counted here rather than with GFrameCounter so every scope agrees on which frame it belongs to.
+static TAtomic<uint64> CurrentFrame(0);
+static uint64 LastEndFrameCycles = 0;
+
+// Hitches often come in runs, so only the first in any second is dumped.
+static const double DumpCooldownSeconds = 1.0;
+static uint64 NextDumpCycles = 0;
+static TFuture<void> PendingDump;
+static FDelegateHandle EndFrameHandle;
+
+TAtomic<bool> FGolfHitchDetector::isRecording(false);
+
+// A timing copied out of the ring buffer.
+struct FGolfCopiedTiming
+{
+	const TCHAR* Name;
+	uint64 StartCycles;
+	uint64 EndCycles;
+	uint64 Frame;
+	uint32 ThreadId;
+};
+
+void FGolfHitchDetector::Start()
+{
+	if (EndFrameHandle.IsValid())
+		return;
+
+	LastEndFrameCycles = 0;
+	NextDumpCycles = 0;
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddStatic(&FGolfHitchDetector::OnEndFrame);
+}
+
+void FGolfHitchDetector::Stop()
+{
+	isRecording = false;
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+	EndFrameHandle.Reset();
+
+	if (PendingDump.IsValid())
+	{
+		PendingDump.Wait();
+		PendingDump = TFuture<void>();
+	}
+}
+
+void FGolfHitchDetector::Record(const TCHAR* Name, uint64 StartCycles, uint64 EndCycles)
+{
+	const uint64 Index = NextTiming.IncrementExchange();
+	FGolfScopeTiming& Timing = Timings[Index % NumTimings];
+
+	// Clear the sequence first, so a dump that reads the slot part way through the write throws it away.
+	Timing.Sequence = 0;
+	Timing.Name = Name;
+	Timing.StartCycles = StartCycles;
+	Timing.EndCycles = EndCycles;
+	Timing.Frame = CurrentFrame;
+	Timing.ThreadId = FPlatformTLS::GetCurrentThreadId();
+	Timing.Sequence = Index + 1;
+}
+
+void FGolfHitchDetector::OnEndFrame()
+{
+	const float ThresholdMs = CVarHitchThresholdMs.GetValueOnGameThread();
+	const uint64 NowCycles = FPlatformTime::Cycles64();
+	const uint64 Frame = CurrentFrame++;
+	isRecording = ThresholdMs > 0.0f;
+
+	const uint64 LastCycles = LastEndFrameCycles;
+	LastEndFrameCycles = NowCycles;
+	if (!isRecording || LastCycles == 0)
+		return;
+
+	const float FrameMs = (float)FPlatformTime::ToMilliseconds64(NowCycles - LastCycles);
+	FrameTimes[Frame % MaxFrames] = FrameMs;
+	if (FrameMs <= ThresholdMs || NowCycles < NextDumpCycles)
+		return;
+
+	// Don't start another dump while the last one is still being written.
+	if (PendingDump.IsValid() && !PendingDump.IsReady())
+		return;
+
+	NextDumpCycles = NowCycles + FPlatformTime::SecondsToCycles64(DumpCooldownSeconds);
+	Dump(Frame, FrameMs, ThresholdMs, FMath::Clamp(CVarHitchFrames.GetValueOnGameThread(), 1, MaxFrames));
+}
+
+void FGolfHitchDetector::Dump(uint64 HitchFrame, float HitchMs, float ThresholdMs, int32 NumFrames)
+{
+	// Copy out the timings for the frames being dumped. Anything still being written is skipped.
+	const uint64 FirstFrame = HitchFrame >= (uint64)NumFrames ? HitchFrame - NumFrames + 1 : 0;
+	TArray<FGolfCopiedTiming> Copied;
+	for (const FGolfScopeTiming& Timing : Timings)
+	{
+		const uint64 Sequence = Timing.Sequence;
+		if (Sequence == 0)
+			continue;
+
+		const FGolfCopiedTiming Copy = { Timing.Name, Timing.StartCycles, Timing.EndCycles, Timing.Frame, Timing.ThreadId };
+		if (Timing.Sequence == Sequence && Copy.Frame >= FirstFrame && Copy.Frame <= HitchFrame)
+			Copied.Add(Copy);
+	}
+
+	TArray<float> RecentFrameTimes;
+	for (uint64 Frame = FirstFrame; Frame <= HitchFrame; Frame++)
+		RecentFrameTimes.Add(FrameTimes[Frame % MaxFrames]);
+
+	// Format and write the file away from the game thread.
+	const FString File = FPaths::ProjectSavedDir() / TEXT("Hitches") / FString::Printf(TEXT("Hitch-%s-%llu.csv"), *FDateTime::Now().ToString(), HitchFrame);
+	PendingDump = Async(EAsyncExecution::ThreadPool, [Copied = MoveTemp(Copied), RecentFrameTimes = MoveTemp(RecentFrameTimes), File, FirstFrame, HitchFrame, HitchMs, ThresholdMs]() mutable
+	{
+		Copied.Sort([](const FGolfCopiedTiming& A, const FGolfCopiedTiming& B) { return A.StartCycles < B.StartCycles; });
+		const uint64 BaseCycles = Copied.Num() > 0 ? Copied[0].StartCycles : 0;
+
+		FString Text = FString::Printf(TEXT("# Frame %llu took %.2fms, over the %.2fms threshold.\n"), HitchFrame, HitchMs, ThresholdMs);
+		for (int32 i = 0; i < RecentFrameTimes.Num(); i++)
+			Text += FString::Printf(TEXT("# Frame %llu: %.2fms\n"), FirstFrame + i, RecentFrameTimes[i]);
+
+		Text += TEXT("Frame,Thread,Scope,StartMs,DurationMs\n");
+		for (const FGolfCopiedTiming& Timing : Copied)
+		{
+			Text += FString::Printf(TEXT("%llu,%u,%s,%.3f,%.3f\n"), Timing.Frame, Timing.ThreadId, Timing.Name,
+				FPlatformTime::ToMilliseconds64(Timing.StartCycles - BaseCycles), FPlatformTime::ToMilliseconds64(Timing.EndCycles - Timing.StartCycles));
+		}
+
+		IFileManager::Get().MakeDirectory(*FPaths::GetPath(File), true);
+		FFileHelper::SaveStringToFile(Text, *File);
+		UE_LOG(LogGolfHitch, Warning, TEXT("Frame %llu took %.2fms. Scope timings written to %s."), HitchFrame, HitchMs, *File);
+	});
+}
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformTime.h"
+#include "Templates/Atomic.h"
+
+// One timed scope, as stored in the hitch detector's ring buffer.
+struct FGolfScopeTiming
+{
+	const TCHAR* Name = nullptr;
+	uint64 StartCycles = 0;
+	uint64 EndCycles = 0;
+	uint64 Frame = 0;
+	uint32 ThreadId = 0;
+
+	// The write that filled this slot, plus one. Zero means the slot has never been written.
+	TAtomic<uint64> Sequence;
+};
+
+/**
+ * Catches hitches in the field.
+ * Every UltraBall scope writes its timing into a fixed size ring buffer without taking a lock.
+ * When a frame takes longer than UltraBall.Hitch.ThresholdMs, the last UltraBall.Hitch.Frames frames of timings
+ * are copied out and written to Saved/Hitches on a background thread. Nothing else happens while frames are on time.
+ */
+class GOLF_API FGolfHitchDetector
+{
+public:
+
+	// Start watching frames. Called when the Golf module starts up.
+	static void Start();
+
+	// Stop watching frames and wait for any dump that is still being written.
+	static void Stop();
+
+	// Returns whether scopes should be recorded.
+	static bool IsRecording() { return isRecording; }
+
+	// Add a scope to the ring buffer. Safe to call from any thread.
+	static void Record(const TCHAR* Name, uint64 StartCycles, uint64 EndCycles);
+
+private:
+
+	static void OnEndFrame();
+
+	// Copy out the timings for the last few frames and write them to a file on a background thread.
+	static void Dump(uint64 HitchFrame, float HitchMs, float ThresholdMs, int32 NumFrames);
+
+	static TAtomic<bool> isRecording;
+};
+
+// Times a scope into the hitch detector's ring buffer.
+class FGolfHitchScope
+{
+public:
+
+	explicit FGolfHitchScope(const TCHAR* InName) : Name(InName), StartCycles(FGolfHitchDetector::IsRecording() ? FPlatformTime::Cycles64() : 0) {}
+
+	~FGolfHitchScope()
+	{
+		if (StartCycles != 0)
+			FGolfHitchDetector::Record(Name, StartCycles, FPlatformTime::Cycles64());
+	}
+
+private:
+
+	const TCHAR* Name;
+	uint64 StartCycles;
+};
@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GolfMemory.h"
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+
+DECLARE_LLM_MEMORY_STAT(TEXT("Golf"), STAT_GolfLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("Golf Simulation"), STAT_GolfSimulationLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("Golf Predictor"), STAT_GolfPredictorLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("Golf Ball Assets"), STAT_GolfBallAssetsLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("Golf Bumper Assets"), STAT_GolfBumperAssetsLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("Golf Finish Target Assets"), STAT_GolfFinishTargetAssetsLLM, STATGROUP_LLMFULL);
+
+// Every Golf tag is also added up into one line of the "stat LLM" summary.
+DECLARE_LLM_MEMORY_STAT(TEXT("Golf"), STAT_GolfSummaryLLM, STATGROUP_LLM);
+
+#endif
+
+void RegisterGolfLLMTags()
+{
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+	FLowLevelMemTracker& Tracker = FLowLevelMemTracker::Get();
+	const FName SummaryStat = GET_STATFNAME(STAT_GolfSummaryLLM);
+	Tracker.RegisterProjectTag((int32)EGolfLLMTag::Golf, TEXT("Golf"), GET_STATFNAME(STAT_GolfLLM), SummaryStat);
+	Tracker.RegisterProjectTag((int32)EGolfLLMTag::Simulation, TEXT("GolfSimulation"), GET_STATFNAME(STAT_GolfSimulationLLM), SummaryStat);
+	Tracker.RegisterProjectTag((int32)EGolfLLMTag::Predictor, TEXT("GolfPredictor"), GET_STATFNAME(STAT_GolfPredictorLLM), SummaryStat);
+	Tracker.RegisterProjectTag((int32)EGolfLLMTag::BallAssets, TEXT("GolfBallAssets"), GET_STATFNAME(STAT_GolfBallAssetsLLM), SummaryStat);
+	Tracker.RegisterProjectTag((int32)EGolfLLMTag::BumperAssets, TEXT("GolfBumperAssets"), GET_STATFNAME(STAT_GolfBumperAssetsLLM), SummaryStat);
+	Tracker.RegisterProjectTag((int32)EGolfLLMTag::FinishTargetAssets, TEXT("GolfFinishTargetAssets"), GET_STATFNAME(STAT_GolfFinishTargetAssetsLLM), SummaryStat);
+#endif
+}
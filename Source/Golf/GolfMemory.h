@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/LowLevelMemTracker.h"
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+
+// Low Level Memory Tracker tags for the Golf module. Shown with "stat LLM" and "stat LLMFULL" when the game is run with -llm.
+enum class EGolfLLMTag : LLM_TAG_TYPE
+{
+	// Anything else the Golf module allocates.
+	Golf = (LLM_TAG_TYPE)ELLMTag::ProjectTagStart,
+
+	// The engine-free simulation: collision worlds, trajectory batches and Distance Fields.
+	Simulation,
+
+	// The Shot Predictor's sweeps and paths.
+	Predictor,
+
+	// What UltraBall, the Bumpers and the Finish Target load and create when they are constructed.
+	BallAssets,
+	BumperAssets,
+	FinishTargetAssets,
+
+	Count
+};
+
+// Attribute the allocations in a scope to one of the Golf tags.
+#define GOLF_LLM_SCOPE(Tag) LLM_SCOPE((ELLMTag)EGolfLLMTag::Tag)
+
+#else
+
+#define GOLF_LLM_SCOPE(Tag)
+
+#endif
+
+// Give the Golf tags their names and stats. Called when the Golf module starts up.
+void RegisterGolfLLMTags();
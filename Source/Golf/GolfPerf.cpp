@@ -0,0 +1,18 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GolfPerf.h"
+
+CSV_DEFINE_CATEGORY_MODULE(GOLF_API, UltraBall, true);
+
+void FGolfPerfCounters::Reset()
+{
+	BallTickCycles = 0;
+	PhysicsStepCycles = 0;
+	SceneQueries = 0;
+}
+
+FGolfPerfCounters& FGolfPerfCounters::Get()
+{
+	static FGolfPerfCounters Counters;
+	return Counters;
+}
@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformTime.h"
+#include "Templates/Atomic.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "GolfHitchDetector.h"
+
+// The hot paths of the Golf module. Shown with "stat UltraBall".
+DECLARE_STATS_GROUP(TEXT("UltraBall"), STATGROUP_UltraBall, STATCAT_Advanced);
+
+// The hot paths of the Golf module in -csvprofile captures.
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(GOLF_API, UltraBall);
+
+// Time a scope for "stat UltraBall", the CSV profiler, Unreal Insights and the hitch detector.
+// The stat is declared with DECLARE_CYCLE_STAT where it is used.
+#define ULTRABALL_SCOPE_CYCLE_COUNTER(Stat) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	CSV_SCOPED_TIMING_STAT(UltraBall, Stat); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(Stat); \
+	FGolfHitchScope ANONYMOUS_VARIABLE(GolfHitchScope_)(TEXT(#Stat))
+
+// Count an event for "stat UltraBall" and the CSV profiler. The stat is declared with DECLARE_DWORD_COUNTER_STAT where it is used.
+#define ULTRABALL_INC_COUNTER(Stat) \
+	INC_DWORD_STAT(Stat); \
+	CSV_CUSTOM_STAT(UltraBall, Stat, 1, ECsvCustomStatOp::Accumulate)
+
+/**
+ * Counters for the cost of the game code, read by the benchmark.
+ * They are only ever added to, so they are cheap enough to leave on in every build.
+ */
+struct GOLF_API FGolfPerfCounters
+{
+	// Cycles spent in the Ball Manager ticking every UltraBall.
+	TAtomic<uint64> BallTickCycles;
+
+	// Cycles spent stepping the physics scene, from its pre-tick to its post-tick. Game ticks around the step are not included.
+	TAtomic<uint64> PhysicsStepCycles;
+
+	// Scene queries issued by the game code, such as the predictor's sweeps and the ground trace.
+	TAtomic<int32> SceneQueries;
+
+	FGolfPerfCounters() : BallTickCycles(0), PhysicsStepCycles(0), SceneQueries(0) {}
+
+	// Set every counter back to zero.
+	void Reset();
+
+	static FGolfPerfCounters& Get();
+};
+
+// Adds the cycles spent in a scope to a counter.
+class FGolfPerfCycleScope
+{
+public:
+
+	explicit FGolfPerfCycleScope(TAtomic<uint64>& InCounter) : Counter(InCounter), StartCycles(FPlatformTime::Cycles64()) {}
+	~FGolfPerfCycleScope() { Counter += FPlatformTime::Cycles64() - StartCycles; }
+
+private:
+
+	TAtomic<uint64>& Counter;
+	uint64 StartCycles;
+};
+
+// Time the rest of the scope into one of the counters.
+#define GOLF_PERF_CYCLE_SCOPE(CounterName) FGolfPerfCycleScope ANONYMOUS_VARIABLE(GolfPerfCycleScope_)(FGolfPerfCounters::Get().CounterName)
+
+// Count scene queries issued by the game code.
+#define GOLF_PERF_COUNT_QUERIES(Count) FGolfPerfCounters::Get().SceneQueries += (Count)
@@ -0,0 +1,132 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "GravityFieldSubsystem.h"
+#include "Engine/World.h"
+#include "Engine/GameInstance.h"
+#include "GolfMemory.h"
+
+// Field Ids hold the slot in their low bits and the slot's generation above it, kept positive so an Id is never INDEX_NONE.
+static const int32 FieldSlotBits = 16;
+static const int32 MaxFieldSlots = 1 << FieldSlotBits;
+static const uint16 FieldGenerationMask = 0x7FFF;
+
+UGravityFieldSubsystem::UGravityFieldSubsystem()
+{
+	CellSize = 2000.0f;
+}
+
+void UGravityFieldSubsystem::Deinitialize()
+{
+	FRWScopeLock Lock(FieldsLock, SLT_Write);
+	Fields.Empty();
+	SlotGenerations.Empty();
+	Cells.Empty();
+
+	Super::Deinitialize();
+}
+
+UGravityFieldSubsystem* UGravityFieldSubsystem::Get(const UWorld* World)
+{
+	UGameInstance* GameInstance = World != nullptr ? World->GetGameInstance() : nullptr;
+	return GameInstance != nullptr ? GameInstance->GetSubsystem<UGravityFieldSubsystem>() : nullptr;
+}
+
+int32 UGravityFieldSubsystem::RegisterField(const FGravityField& Field)
+{
+	GOLF_LLM_SCOPE(Golf);
+	FRWScopeLock Lock(FieldsLock, SLT_Write);
+
+	const int32 Slot = Fields.Add(Field);
+	if (!ensureMsgf(Slot < MaxFieldSlots, TEXT("Only %d Gravity Fields can be registered at once."), MaxFieldSlots))
+	{
+		Fields.RemoveAt(Slot);
+		return INDEX_NONE;
+	}
+
+	// Each use of a slot gets the next generation, so the Id differs from every field the slot held before.
+	if (Slot >= SlotGenerations.Num())
+		SlotGenerations.SetNumZeroed(Slot + 1);
+	SlotGenerations[Slot] = (SlotGenerations[Slot] + 1) & FieldGenerationMask;
+	const int32 FieldId = MakeFieldId(Slot, SlotGenerations[Slot]);
+	Fields[Slot].Id = FieldId;
+
+	// Add the field to every cell it overlaps.
+	FIntVector Min, Max;
+	GetCellRange(Field, Min, Max);
+	for (int32 X = Min.X; X <= Max.X; X++)
+		for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+			for (int32 Z = Min.Z; Z <= Max.Z; Z++)
+				Cells.FindOrAdd(FIntVector(X, Y, Z)).Add(Slot);
+
+	return FieldId;
+}
+
+void UGravityFieldSubsystem::UnregisterField(int32 FieldId)
+{
+	FRWScopeLock Lock(FieldsLock, SLT_Write);
+
+	// The slot could have been reused since, in which case the field it holds has a different Id.
+	const int32 Slot = GetFieldSlot(FieldId);
+	if (FieldId == INDEX_NONE || !Fields.IsValidIndex(Slot) || Fields[Slot].Id != FieldId)
+		return;
+
+	// Remove the field from every cell it overlaps, dropping any cells that are now empty.
+	FIntVector Min, Max;
+	GetCellRange(Fields[Slot], Min, Max);
+	for (int32 X = Min.X; X <= Max.X; X++)
+		for (int32 Y = Min.Y; Y <= Max.Y; Y++)
+			for (int32 Z = Min.Z; Z <= Max.Z; Z++)
+			{
+				const FIntVector Cell(X, Y, Z);
+				if (TArray<int32>* CellFields = Cells.Find(Cell))
+				{
+					CellFields->Remove(Slot);
+					if (CellFields->Num() == 0)
+						Cells.Remove(Cell);
+				}
+			}
+
+	Fields.RemoveAt(Slot);
+}
+
+void UGravityFieldSubsystem::FindFieldsAt(const FVector& Location, TArray<FGravityField, TInlineAllocator<4>>& OutFields) const
+{
+	OutFields.Reset();
+
+	FRWScopeLock Lock(FieldsLock, SLT_ReadOnly);
+
+	const TArray<int32>* CellFields = Cells.Find(GetCell(Location));
+	if (CellFields == nullptr)
+		return;
+
+	for (int32 Slot : *CellFields)
+	{
+		const FGravityField& Field = Fields[Slot];
+		if (FVector::DistSquared(Location, Field.Center) <= FMath::Square(Field.Radius))
+			OutFields.Add(Field);
+	}
+}
+
+void UGravityFieldSubsystem::GetCellRange(const FGravityField& Field, FIntVector& OutMin, FIntVector& OutMax) const
+{
+	OutMin = GetCell(Field.Center - FVector(Field.Radius));
+	OutMax = GetCell(Field.Center + FVector(Field.Radius));
+}
+
+FIntVector UGravityFieldSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntVector(
+		FMath::FloorToInt(Location.X / CellSize),
+		FMath::FloorToInt(Location.Y / CellSize),
+		FMath::FloorToInt(Location.Z / CellSize));
+}
+
+int32 UGravityFieldSubsystem::MakeFieldId(int32 Slot, uint16 Generation)
+{
+	return ((int32)(Generation & FieldGenerationMask) << FieldSlotBits) | Slot;
+}
+
+int32 UGravityFieldSubsystem::GetFieldSlot(int32 FieldId)
+{
+	return FieldId & (MaxFieldSlots - 1);
+}
@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/SparseArray.h"
+#include "Misc/ScopeRWLock.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "GravityFieldSubsystem.generated.h"
+
+// The kinds of field UltraBall can be pulled into.
+UENUM(BlueprintType)
+enum class EGravityFieldType : uint8
+{
+	// Pulls UltraBall to the center and holds it there until it is fired.
+	Gravity,
+
+	// Pulls UltraBall to the center and then launches it.
+	Launcher
+};
+
+// A Gravity or Launcher field registered with the Gravity Field Subsystem.
+struct FGravityField
+{
+	// Set by the subsystem when the field is registered. The Id holds the field's slot and how many times the slot has been
+	// used, so an Id kept after its field was removed never matches a new field in the same slot.
+	int32 Id = INDEX_NONE;
+
+	EGravityFieldType Type = EGravityFieldType::Gravity;
+	FVector Center = FVector::ZeroVector;
+	float Radius = 0.0f;
+
+	// How fast UltraBall is pulled towards the center.
+	float PullSpeed = 800.0f;
+
+	// How close to the center UltraBall has to be before it is captured.
+	float CaptureRadius = 10.0f;
+
+	// Launcher fields only: the direction and power UltraBall is launched with once captured.
+	FVector LaunchDirection = FVector::ZeroVector;
+	float LaunchPower = 0.0f;
+};
+
+/**
+ * Keeps track of every Gravity and Launcher field in play.
+ * Fields are stored in a uniform grid so UltraBall only has to check the fields near it.
+ * Queries are safe to run from the physics substep while the game thread registers fields.
+ */
+UCLASS()
+class GOLF_API UGravityFieldSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	UGravityFieldSubsystem();
+
+	virtual void Deinitialize() override;
+
+	// Returns the subsystem for this world, or null if there isn't one.
+	static UGravityFieldSubsystem* Get(const UWorld* World);
+
+	// Add a field and return its Id.
+	int32 RegisterField(const FGravityField& Field);
+
+	// Remove a field that was previously registered. Ids of fields that have already been removed are ignored.
+	void UnregisterField(int32 FieldId);
+
+	// Find every field that contains this location.
+	void FindFieldsAt(const FVector& Location, TArray<FGravityField, TInlineAllocator<4>>& OutFields) const;
+
+	// Size of each cell in the grid. Fields larger than this are stored in more than one cell.
+	float CellSize;
+
+private:
+
+	// Returns the range of cells a field overlaps.
+	void GetCellRange(const FGravityField& Field, FIntVector& OutMin, FIntVector& OutMax) const;
+
+	// Returns the cell that contains this location.
+	FIntVector GetCell(const FVector& Location) const;
+
+	// The Id of the field in a slot, and the slot an Id is for.
+	static int32 MakeFieldId(int32 Slot, uint16 Generation);
+	static int32 GetFieldSlot(int32 FieldId);
+
+	// The fields, by slot, and how many times each slot has been used. The cells hold slots.
+	TSparseArray<FGravityField> Fields;
+	TArray<uint16> SlotGenerations;
+	TMap<FIntVector, TArray<int32>> Cells;
+	mutable FRWLock FieldsLock;
+
+};
@@ -2,6 +2,10 @@
 
 #include "GravityWell.h"
 #include "Components/SphereComponent.h"
+#include "Components/AudioComponent.h"
+#include "Components/ArrowComponent.h"
+#include "LauncherWell.h"
+#include "Ball.h"
 
 // Sets default values
 AGravityWell::AGravityWell()
@@ -11,14 +15,146 @@ AGravityWell::AGravityWell()
 
 	Colider = CreateDefaultSubobject<USphereComponent>("Colider");
 	Colider->SetWorldScale3D(FVector(4.0f));
+	Colider->OnComponentBeginOverlap.AddDynamic(this, &AGravityWell::OnOverlapBegin);
 	RootComponent = Colider;
 
+	// Setup Sound Component
+	Sound = CreateDefaultSubobject<UAudioComponent>("Sound");
+	Sound->SetAutoActivate(false);
+	Sound->SetupAttachment(RootComponent);
+
+	PullSpeed = 800.0f;
+	CaptureRadius = 10.0f;
+	FieldType = EGravityFieldType::Gravity;
+	FieldId = INDEX_NONE;
+	hasLegacyZoneData = false;
+	hasLegacyZoneEntered = false;
+
 }
 
 // Called when the game starts or when spawned
 void AGravityWell::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	// Blueprint launchers are read up front, so they launch UltraBall from the first visit rather than pulling it in like a Gravity Well.
+	FGravityField BlueprintField;
+	if (IsBlueprintLauncher() && GetBlueprintLauncherField(BlueprintField))
+	{
+		FieldType = EGravityFieldType::Launcher;
+		LegacyField = BlueprintField;
+		hasLegacyZoneData = true;
+	}
+
+	// The field pulls UltraBall in during each physics step from now on.
+	RegisterField(GetField());
+}
+
+void AGravityWell::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Remove the field so UltraBall stops being pulled by it.
+	UnregisterField();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AGravityWell::OnOverlapBegin(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+{
+	// Other Actor is the actor that triggered the event. Check that is not ourself.  
+	if ((OtherActor != nullptr) && (OtherActor != this) && (OtherComp != nullptr))
+	{
+		ABall* ball = Cast<ABall>(OtherActor);
+
+		// Let UltraBall know it has entered the zone. The pull itself is applied by UltraBall's physics step.
+		if (ball != nullptr)
+		{
+			ball->FieldEnter(FieldType);
+
+			// Play the zone sound.
+			if (Sound != nullptr)
+			{
+				if (!Sound->IsPlaying())
+					Sound->Play(0.0f);
+			}
+		}
+	}
+}
+
+FGravityField AGravityWell::GetField() const
+{
+	if (hasLegacyZoneData)
+		return LegacyField;
+
+	// The field covers the same area as the Colider.
+	FGravityField Field;
+	Field.Type = FieldType;
+	Field.Center = GetActorLocation();
+	Field.Radius = Colider->GetScaledSphereRadius();
+	Field.PullSpeed = PullSpeed;
+	Field.CaptureRadius = CaptureRadius;
+	return Field;
+}
+
+void AGravityWell::SetLegacyZoneData(EGravityFieldType Type, const FVector& Center, const FVector& LaunchDirection, float LaunchPower)
+{
+	// Older Blueprints call this every time UltraBall enters, so only apply the data once.
+	// Both kinds of zone pull UltraBall to the Center of Gravity the Blueprint passes in, which can be away from the well.
+	if (hasLegacyZoneEntered)
+		return;
+
+	FieldType = Type;
+	LegacyField = GetField();
+	LegacyField.Type = Type;
+	LegacyField.Radius += FVector::Dist(Center, LegacyField.Center);
+	LegacyField.Center = Center;
+	LegacyField.LaunchDirection = LaunchDirection;
+	LegacyField.LaunchPower = LaunchPower;
+	hasLegacyZoneData = true;
+	hasLegacyZoneEntered = true;
+
+	UnregisterField();
+	RegisterField(LegacyField);
+}
+
+bool AGravityWell::IsBlueprintLauncher() const
+{
+	// Native launchers are set up in the editor. Blueprint Gravity Wells that aren't launchers already match their native data.
+	const UClass* Class = GetClass();
+	if (IsA<ALauncherWell>() || Class->HasAnyClassFlags(CLASS_Native))
+		return false;
+
+	return Class->GetName().Contains(TEXT("Launcher")) || FindField<UProperty>(Class, TEXT("LaunchPower")) != nullptr;
+}
+
+bool AGravityWell::GetBlueprintLauncherField(FGravityField& OutField) const
+{
+	// The Blueprint launches UltraBall along its Arrow with its Launch Power, from the well's own location.
+	const UFloatProperty* LaunchPower = FindField<UFloatProperty>(GetClass(), TEXT("LaunchPower"));
+	const UArrowComponent* Arrow = FindComponentByClass<UArrowComponent>();
+	if (LaunchPower == nullptr || Arrow == nullptr)
+		return false;
+
+	OutField = GetField();
+	OutField.Type = EGravityFieldType::Launcher;
+	OutField.LaunchDirection = Arrow->GetForwardVector();
+	OutField.LaunchPower = LaunchPower->GetPropertyValue_InContainer(this);
+	return true;
+}
+
+void AGravityWell::RegisterField(const FGravityField& Field)
+{
+	UGravityFieldSubsystem* GravityFields = UGravityFieldSubsystem::Get(GetWorld());
+	if (GravityFields != nullptr && FieldId == INDEX_NONE)
+		FieldId = GravityFields->RegisterField(Field);
+}
+
+void AGravityWell::UnregisterField()
+{
+	if (FieldId == INDEX_NONE)
+		return;
+
+	if (UGravityFieldSubsystem* GravityFields = UGravityFieldSubsystem::Get(GetWorld()))
+		GravityFields->UnregisterField(FieldId);
+	FieldId = INDEX_NONE;
 }
 
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "GravityFieldSubsystem.h"
 #include "GravityWell.generated.h"
 
 UCLASS()
@@ -19,9 +20,68 @@ protected:
 	// Called when the game starts or when spawned.
 	virtual void BeginPlay() override;
 
+	// Called when the well is removed from play.
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:	
 
 	// Colider that represents the collision zone.
+	UPROPERTY(VisibleAnywhere)
 	class USphereComponent* Colider;
-	
+
+	// Sound to play when UltraBall enters the zone.
+	UPROPERTY(EditAnywhere, Category = "Designer")
+	class UAudioComponent* Sound;
+
+	// Designer: How fast UltraBall is pulled towards the center of the zone.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "1.0", ClampMax = "5000.0", UIMin = "1.0", UIMax = "5000.0"))
+	float PullSpeed;
+
+	// Designer: How close to the center UltraBall has to be before it is captured.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "1.0", ClampMax = "200.0", UIMin = "1.0", UIMax = "200.0"))
+	float CaptureRadius;
+
+	UFUNCTION()
+	void OnOverlapBegin(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+
+	// Returns what kind of zone this is.
+	FORCEINLINE EGravityFieldType GetFieldType() const { return FieldType; }
+
+	// Returns the field this well registers with the Gravity Field Subsystem.
+	virtual FGravityField GetField() const;
+
+	// Override the zone with data from an older Blueprint that still calls ABall::ZoneEnter.
+	void SetLegacyZoneData(EGravityFieldType Type, const FVector& Center, const FVector& LaunchDirection, float LaunchPower);
+
+	// Older Blueprint launchers are Gravity Wells that only hand their launch data to UltraBall when it enters.
+	// Returns whether this well is one of them.
+	bool IsBlueprintLauncher() const;
+
+	// Read a Blueprint launcher's field from its Launch Power variable and its Arrow, the same data it hands to UltraBall.
+	// Returns false if the Blueprint doesn't have them.
+	bool GetBlueprintLauncherField(FGravityField& OutField) const;
+
+protected:
+
+	// What kind of zone this is. Set by the constructor of each zone class.
+	EGravityFieldType FieldType;
+
+private:
+
+	// Register this well with the Gravity Field Subsystem.
+	void RegisterField(const FGravityField& Field);
+
+	// Remove this well from the Gravity Field Subsystem.
+	void UnregisterField();
+
+	// The Id of this well's field in the Gravity Field Subsystem.
+	int32 FieldId;
+
+	// Whether an older Blueprint has overridden the zone data, and the field it set up.
+	bool hasLegacyZoneData;
+	FGravityField LegacyField;
+
+	// Whether the Blueprint has already called ABall::ZoneEnter. Its data is only applied the first time.
+	bool hasLegacyZoneEntered;
+
 };
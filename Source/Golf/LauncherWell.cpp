@@ -0,0 +1,20 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LauncherWell.h"
+
+// Sets default values
+ALauncherWell::ALauncherWell()
+{
+	FieldType = EGravityFieldType::Launcher;
+	LaunchDirection = FVector::UpVector;
+	LaunchPower = 2.0f;
+}
+
+FGravityField ALauncherWell::GetField() const
+{
+	FGravityField Field = Super::GetField();
+	Field.LaunchDirection = LaunchDirection;
+	Field.LaunchPower = LaunchPower;
+	return Field;
+}
+
@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GravityWell.h"
+#include "LauncherWell.generated.h"
+
+/**
+ * A Gravity Well that pulls UltraBall to its center and then launches it.
+ */
+UCLASS()
+class GOLF_API ALauncherWell : public AGravityWell
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this actor's properties.
+	ALauncherWell();
+
+	// Designer: The direction UltraBall is launched in once it reaches the center.
+	UPROPERTY(EditAnywhere, Category = "Designer")
+	FVector LaunchDirection;
+
+	// Designer: How hard UltraBall is launched. This is scaled by UltraBall's mass like a charge.
+	UPROPERTY(EditAnywhere, Category = "Designer", meta = (ClampMin = "0.0", ClampMax = "100.0", UIMin = "0.0", UIMax = "100.0"))
+	float LaunchPower;
+
+	// Returns the field this launcher registers with the Gravity Field Subsystem.
+	virtual FGravityField GetField() const override;
+
+};
@@ -0,0 +1,153 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LevelTransitionSubsystem.h"
+#include "Engine/World.h"
+#include "Engine/GameInstance.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/PackageName.h"
+#include "HAL/PlatformTime.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogLevelTransition, Log, All);
+
+void ULevelTransitionSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	PreloadedPackage = nullptr;
+	PreloadedWorld = nullptr;
+	isOpenPending = false;
+	OpenStartTime = 0.0;
+	PreloadStartTime = 0.0;
+	PostLoadMapHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this, &ULevelTransitionSubsystem::OnPostLoadMap);
+}
+
+void ULevelTransitionSubsystem::Deinitialize()
+{
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapHandle);
+	PreloadPackageName.Empty();
+	PreloadedPackage = nullptr;
+	PreloadedWorld = nullptr;
+	isOpenPending = false;
+
+	Super::Deinitialize();
+}
+
+ULevelTransitionSubsystem* ULevelTransitionSubsystem::Get(const UWorld* World)
+{
+	UGameInstance* GameInstance = World != nullptr ? World->GetGameInstance() : nullptr;
+	return GameInstance != nullptr ? GameInstance->GetSubsystem<ULevelTransitionSubsystem>() : nullptr;
+}
+
+FString ULevelTransitionSubsystem::GetLevelPackageName(const UWorld* World, FName Level)
+{
+	const FString LevelName = Level.ToString();
+	if (FPackageName::IsValidLongPackageName(LevelName))
+		return LevelName;
+
+	const FString WorldPackageName = UWorld::RemovePIEPrefix(World->GetOutermost()->GetName());
+	return FPackageName::GetLongPackagePath(WorldPackageName) / LevelName;
+}
+
+void ULevelTransitionSubsystem::Preload(const UWorld* World, FName Level)
+{
+	if (World == nullptr || Level.IsNone())
+		return;
+
+	const FString PackageName = GetLevelPackageName(World, Level);
+	if (PackageName == PreloadPackageName)
+		return;
+	if (!FPackageName::DoesPackageExist(PackageName))
+	{
+		UE_LOG(LogLevelTransition, Warning, TEXT("Can't preload %s because there is no level there."), *PackageName);
+		return;
+	}
+
+	// Drop the level loaded before, if any. A load that is still going finishes, but is let go when it arrives.
+	PreloadPackageName = PackageName;
+	PreloadedPackage = nullptr;
+	PreloadedWorld = nullptr;
+	PreloadStartTime = FPlatformTime::Seconds();
+	LoadPackageAsync(PackageName, FLoadPackageAsyncDelegate::CreateUObject(this, &ULevelTransitionSubsystem::OnPreloaded));
+}
+
+bool ULevelTransitionSubsystem::IsPreloaded(const UWorld* World, FName Level) const
+{
+	return World != nullptr && PreloadedPackage != nullptr && GetLevelPackageName(World, Level) == PreloadPackageName;
+}
+
+void ULevelTransitionSubsystem::OpenLevel(const UWorld* World, FName Level)
+{
+	// Online, clients are taken to the next level by the server. Preloading still means they find it in memory when they get there.
+	if (World == nullptr || Level.IsNone() || World->GetNetMode() == NM_Client)
+		return;
+
+	OpenStartTime = FPlatformTime::Seconds();
+	Preload(World, Level);
+	if (GetLevelPackageName(World, Level) != PreloadPackageName)
+		return;
+
+	OpeningWorld = const_cast<UWorld*>(World);
+	isOpenPending = true;
+	if (PreloadedPackage != nullptr)
+		OpenLoadedLevel();
+	else
+		UE_LOG(LogLevelTransition, Log, TEXT("%s is still loading. It will be opened once it has loaded."), *PreloadPackageName);
+}
+
+void ULevelTransitionSubsystem::OnPreloaded(const FName& PackageName, UPackage* Package, EAsyncLoadingResult::Type Result)
+{
+	// Ignore levels that were loading when another was asked for.
+	if (PackageName.ToString() != PreloadPackageName)
+		return;
+
+	if (Result == EAsyncLoadingResult::Succeeded && Package != nullptr)
+	{
+		PreloadedPackage = Package;
+		PreloadedWorld = UWorld::FindWorldInPackage(Package);
+		UE_LOG(LogLevelTransition, Log, TEXT("Preloaded %s in %.0f ms."), *PreloadPackageName, (FPlatformTime::Seconds() - PreloadStartTime) * 1000.0);
+	}
+	else
+	{
+		UE_LOG(LogLevelTransition, Warning, TEXT("Could not preload %s. It will be loaded when it is opened instead."), *PreloadPackageName);
+	}
+
+	// If the level has already been asked for, open it now. A level that failed to preload is loaded the usual way.
+	if (isOpenPending)
+		OpenLoadedLevel();
+}
+
+void ULevelTransitionSubsystem::OpenLoadedLevel()
+{
+	isOpenPending = false;
+	UWorld* World = OpeningWorld.Get();
+	OpeningWorld.Reset();
+	if (World == nullptr)
+		return;
+
+	// The engine finds the package already in memory, so all that is left is starting the level up.
+	if (World->GetNetMode() == NM_Standalone)
+		UGameplayStatics::OpenLevel(World, FName(*PreloadPackageName));
+	else
+		World->ServerTravel(PreloadPackageName);
+}
+
+void ULevelTransitionSubsystem::OnPostLoadMap(UWorld* World)
+{
+	if (World == nullptr || World->GetGameInstance() != GetGameInstance())
+		return;
+
+	// This is broadcast after the new level has begun play, so a preload it has just started for the level after it is left alone.
+	// Only once the preloaded level itself has been opened is it the engine's, and no longer held here.
+	const FString PackageName = UWorld::RemovePIEPrefix(World->GetOutermost()->GetName());
+	if (PackageName != PreloadPackageName)
+		return;
+
+	if (OpenStartTime > 0.0)
+		UE_LOG(LogLevelTransition, Log, TEXT("Opened %s in %.0f ms."), *PackageName, (FPlatformTime::Seconds() - OpenStartTime) * 1000.0);
+
+	PreloadPackageName.Empty();
+	PreloadedPackage = nullptr;
+	PreloadedWorld = nullptr;
+	OpenStartTime = 0.0;
+	isOpenPending = false;
+	OpeningWorld.Reset();
+}
@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "UObject/UObjectGlobals.h"
+#include "LevelTransitionSubsystem.generated.h"
+
+/**
+ * Loads the next level in the background while the current one is played, so moving on to it doesn't stop for a load.
+ * The next level's package is loaded asynchronously and held in memory until the level is opened, at which point the
+ * engine finds it already loaded and only has to start it up.
+ * Only one level is preloaded at a time. Asking for another drops the one before.
+ */
+UCLASS()
+class GOLF_API ULevelTransitionSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// Returns the subsystem for this world, or null if there isn't one.
+	static ULevelTransitionSubsystem* Get(const UWorld* World);
+
+	// Returns the package a level is in. Level names without a path are looked for next to the world's own level.
+	static FString GetLevelPackageName(const UWorld* World, FName Level);
+
+	// Start loading a level in the background. Does nothing if it is already loading or loaded.
+	void Preload(const UWorld* World, FName Level);
+
+	// Returns whether a level has finished loading in the background.
+	bool IsPreloaded(const UWorld* World, FName Level) const;
+
+	// Open a level. If it is still loading in the background, it is opened as soon as it has loaded rather than loaded again.
+	void OpenLevel(const UWorld* World, FName Level);
+
+private:
+
+	void OnPreloaded(const FName& PackageName, UPackage* Package, EAsyncLoadingResult::Type Result);
+
+	void OnPostLoadMap(UWorld* World);
+
+	// Switch over to a level that has been loaded.
+	void OpenLoadedLevel();
+
+	// The level being loaded in the background, and its package and world once it has loaded. Both are held until the level
+	// is opened, as holding the package alone doesn't stop the world inside it being collected.
+	FString PreloadPackageName;
+	UPROPERTY(Transient)
+	UPackage* PreloadedPackage;
+	UPROPERTY(Transient)
+	UWorld* PreloadedWorld;
+
+	// The world to open the preloaded level from once it has loaded, if it was asked for before then.
+	TWeakObjectPtr<UWorld> OpeningWorld;
+	bool isOpenPending;
+
+	// When the level was asked for and when its load started, to report how long the switch took.
+	double OpenStartTime;
+	double PreloadStartTime;
+
+	FDelegateHandle PostLoadMapHandle;
+};
@@ -0,0 +1,281 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MemoryBudgetCommandlet.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformProcess.h"
+#include "Async/Async.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectIterator.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "SimWorldBuilder.h"
+#include "GolfMemory.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMemoryBudget, Log, All);
+
+// How many of the largest assets are listed in each report.
+static const int32 NumLargestAssets = 20;
+
+static double ToMB(int64 Bytes)
+{
+	return Bytes / (1024.0 * 1024.0);
+}
+
+// The editor keeps editor-only data and its own tools in memory, so its numbers are only a guide to what a level costs.
+static const TCHAR* EditorMeasurementNote = TEXT("Measured in the editor, which holds more than a cooked game. Check budgets on a cooked build before relying on them.");
+
+/**
+ * Samples the memory the process is using on its own thread until it is stopped, so the peak covers everything in between
+ * rather than only the moments it was asked for. The platform's own high water mark is used as well, when the load raised it.
+ */
+class FPeakMemorySampler
+{
+public:
+
+	FPeakMemorySampler()
+		: isRunning(true)
+	{
+		const FPlatformMemoryStats Stats = FPlatformMemory::GetStats();
+		PeakUsed = (int64)Stats.UsedPhysical;
+		StartPlatformPeak = (int64)Stats.PeakUsedPhysical;
+		Task = Async(EAsyncExecution::Thread, [this]()
+		{
+			while (isRunning)
+			{
+				PeakUsed = FMath::Max(PeakUsed, (int64)FPlatformMemory::GetStats().UsedPhysical);
+				FPlatformProcess::Sleep(0.001f);
+			}
+		});
+	}
+
+	~FPeakMemorySampler()
+	{
+		Stop();
+	}
+
+	// Stop sampling and return the highest the process went.
+	int64 Stop()
+	{
+		isRunning = false;
+		if (Task.IsValid())
+		{
+			Task.Wait();
+			Task = TFuture<void>();
+		}
+
+		const FPlatformMemoryStats Stats = FPlatformMemory::GetStats();
+		PeakUsed = FMath::Max(PeakUsed, (int64)Stats.UsedPhysical);
+		if ((int64)Stats.PeakUsedPhysical > StartPlatformPeak)
+			PeakUsed = FMath::Max(PeakUsed, (int64)Stats.PeakUsedPhysical);
+		return PeakUsed;
+	}
+
+private:
+
+	// Only the sampling thread writes the peak until it has been stopped.
+	int64 PeakUsed;
+	int64 StartPlatformPeak;
+	TAtomic<bool> isRunning;
+	TFuture<void> Task;
+};
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+
+// The engine tags that cover what levels load, and the Golf tags.
+struct FReportedTag
+{
+	ELLMTag Tag;
+	const TCHAR* Name;
+};
+
+static const FReportedTag ReportedTags[] =
+{
+	{ ELLMTag::UObject, TEXT("UObject") },
+	{ ELLMTag::Meshes, TEXT("Meshes") },
+	{ ELLMTag::StaticMesh, TEXT("StaticMesh") },
+	{ ELLMTag::SkeletalMesh, TEXT("SkeletalMesh") },
+	{ ELLMTag::Animation, TEXT("Animation") },
+	{ ELLMTag::Materials, TEXT("Materials") },
+	{ ELLMTag::Textures, TEXT("Textures") },
+	{ ELLMTag::Audio, TEXT("Audio") },
+	{ ELLMTag::PhysX, TEXT("PhysX") },
+	{ (ELLMTag)EGolfLLMTag::Golf, TEXT("Golf") },
+	{ (ELLMTag)EGolfLLMTag::Simulation, TEXT("GolfSimulation") },
+	{ (ELLMTag)EGolfLLMTag::Predictor, TEXT("GolfPredictor") },
+	{ (ELLMTag)EGolfLLMTag::BallAssets, TEXT("GolfBallAssets") },
+	{ (ELLMTag)EGolfLLMTag::BumperAssets, TEXT("GolfBumperAssets") },
+	{ (ELLMTag)EGolfLLMTag::FinishTargetAssets, TEXT("GolfFinishTargetAssets") },
+};
+
+// Returns the memory currently under each reported tag.
+static TArray<int64> GetTagAmounts()
+{
+	TArray<int64> Amounts;
+	if (!FLowLevelMemTracker::IsEnabled())
+		return Amounts;
+
+	FLowLevelMemTracker::Get().UpdateStatsPerFrame();
+	for (const FReportedTag& ReportedTag : ReportedTags)
+		Amounts.Add(FLowLevelMemTracker::Get().GetTagAmountForTracker(ELLMTracker::Default, ReportedTag.Tag));
+	return Amounts;
+}
+
+#endif
+
+UMemoryBudgetCommandlet::UMemoryBudgetCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UMemoryBudgetCommandlet::Main(const FString& Params)
+{
+	FString LevelFilter;
+	FParse::Value(*Params, TEXT("Level="), LevelFilter);
+
+	float BudgetMB = 0.0f;
+	FParse::Value(*Params, TEXT("BudgetMB="), BudgetMB);
+
+	FString OutputDir = FPaths::ProjectSavedDir() / TEXT("MemoryBudgets");
+	FParse::Value(*Params, TEXT("Output="), OutputDir);
+	IFileManager::Get().MakeDirectory(*OutputDir, true);
+
+	TArray<FString> LevelFiles;
+	FSimWorldBuilder::FindLevelFiles(LevelFiles);
+	UE_LOG(LogMemoryBudget, Display, TEXT("%s"), EditorMeasurementNote);
+
+	FString Summary = TEXT("Level,UsedMB,PeakMB,AssetMB,Assets\n");
+	int32 NumFailed = 0;
+	for (const FString& LevelFile : LevelFiles)
+	{
+		const FString LevelName = FPaths::GetBaseFilename(LevelFile);
+		if (!LevelFilter.IsEmpty() && LevelName != LevelFilter)
+			continue;
+
+		FString PackageName;
+		if (!FPackageName::TryConvertFilenameToLongPackageName(LevelFile, PackageName))
+			continue;
+
+		// Start each level from a clean slate, so it is only charged for what it loads itself.
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+		TSet<const UObject*> ExistingObjects;
+		for (TObjectIterator<UObject> It; It; ++It)
+			ExistingObjects.Add(*It);
+
+		const int64 BaseUsed = (int64)FPlatformMemory::GetStats().UsedPhysical;
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+		const TArray<int64> BaseTagAmounts = GetTagAmounts();
+#endif
+
+		// Load the level the same way the other commandlets do, with its components registered as they would be in play.
+		// Memory is sampled throughout, as the peak is usually hit part way through loading rather than at the end.
+		FPeakMemorySampler PeakSampler;
+		UPackage* Package = LoadPackage(nullptr, *PackageName, LOAD_None);
+		UWorld* World = Package != nullptr ? UWorld::FindWorldInPackage(Package) : nullptr;
+		if (World == nullptr)
+		{
+			NumFailed++;
+			UE_LOG(LogMemoryBudget, Warning, TEXT("%s: Could not load the level."), *LevelName);
+			continue;
+		}
+
+		World->AddToRoot();
+		World->WorldType = EWorldType::Editor;
+		World->InitWorld(UWorld::InitializationValues().AllowAudioPlayback(false).CreatePhysicsScene(true).RequiresHitProxies(false).CreateNavigation(false).CreateAISystem(false).ShouldSimulatePhysics(false));
+		World->UpdateWorldComponents(true, false);
+
+		const int64 Peak = PeakSampler.Stop() - BaseUsed;
+		const int64 Used = (int64)FPlatformMemory::GetStats().UsedPhysical - BaseUsed;
+
+		// Add up every asset the level brought in, by class.
+		TMap<FString, int64> ClassBytes;
+		TMap<FString, int32> ClassCounts;
+		TArray<TPair<int64, FString>> Assets;
+		int64 AssetBytes = 0;
+		for (TObjectIterator<UObject> It; It; ++It)
+		{
+			UObject* Object = *It;
+			if (ExistingObjects.Contains(Object) || !Object->IsAsset())
+				continue;
+
+			const int64 Bytes = Object->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+			const FString ClassName = Object->GetClass()->GetName();
+			ClassBytes.FindOrAdd(ClassName) += Bytes;
+			ClassCounts.FindOrAdd(ClassName)++;
+			Assets.Emplace(Bytes, Object->GetPathName());
+			AssetBytes += Bytes;
+		}
+		ClassBytes.ValueSort([](int64 A, int64 B) { return A > B; });
+		Assets.Sort([](const TPair<int64, FString>& A, const TPair<int64, FString>& B) { return A.Key > B.Key; });
+
+		TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+		Json->SetStringField(TEXT("Level"), LevelName);
+		Json->SetNumberField(TEXT("UsedMB"), ToMB(Used));
+		Json->SetNumberField(TEXT("PeakMB"), ToMB(Peak));
+		Json->SetNumberField(TEXT("AssetMB"), ToMB(AssetBytes));
+		Json->SetNumberField(TEXT("BudgetMB"), BudgetMB);
+		Json->SetStringField(TEXT("Note"), EditorMeasurementNote);
+
+		TSharedRef<FJsonObject> ByClass = MakeShared<FJsonObject>();
+		for (const TPair<FString, int64>& Class : ClassBytes)
+		{
+			TSharedRef<FJsonObject> ClassJson = MakeShared<FJsonObject>();
+			ClassJson->SetNumberField(TEXT("MB"), ToMB(Class.Value));
+			ClassJson->SetNumberField(TEXT("Count"), ClassCounts[Class.Key]);
+			ByClass->SetObjectField(Class.Key, ClassJson);
+		}
+		Json->SetObjectField(TEXT("ByAssetClass"), ByClass);
+
+		TArray<TSharedPtr<FJsonValue>> Largest;
+		for (int32 i = 0; i < FMath::Min(Assets.Num(), NumLargestAssets); i++)
+		{
+			TSharedRef<FJsonObject> AssetJson = MakeShared<FJsonObject>();
+			AssetJson->SetStringField(TEXT("Asset"), Assets[i].Value);
+			AssetJson->SetNumberField(TEXT("MB"), ToMB(Assets[i].Key));
+			Largest.Add(MakeShared<FJsonValueObject>(AssetJson));
+		}
+		Json->SetArrayField(TEXT("LargestAssets"), Largest);
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+		const TArray<int64> TagAmounts = GetTagAmounts();
+		if (TagAmounts.Num() == BaseTagAmounts.Num() && TagAmounts.Num() > 0)
+		{
+			TSharedRef<FJsonObject> ByTag = MakeShared<FJsonObject>();
+			for (int32 i = 0; i < TagAmounts.Num(); i++)
+				ByTag->SetNumberField(ReportedTags[i].Name, ToMB(TagAmounts[i] - BaseTagAmounts[i]));
+			Json->SetObjectField(TEXT("ByTag"), ByTag);
+		}
+#endif
+
+		World->DestroyWorld(false);
+		World->RemoveFromRoot();
+
+		FString JsonText;
+		TSharedRef<TJsonWriter<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&JsonText);
+		FJsonSerializer::Serialize(Json, Writer);
+		FFileHelper::SaveStringToFile(JsonText, *(OutputDir / LevelName + TEXT(".json")));
+		Summary += FString::Printf(TEXT("%s,%.2f,%.2f,%.2f,%d\n"), *LevelName, ToMB(Used), ToMB(Peak), ToMB(AssetBytes), Assets.Num());
+
+		if (BudgetMB > 0.0f && ToMB(Peak) > BudgetMB)
+		{
+			NumFailed++;
+			UE_LOG(LogMemoryBudget, Error, TEXT("%s: Peaked at %.1fMB in the editor, over the %.1fMB budget. Confirm on a cooked build."), *LevelName, ToMB(Peak), BudgetMB);
+			continue;
+		}
+
+		UE_LOG(LogMemoryBudget, Display, TEXT("%s: %.1fMB used, %.1fMB peak, %.1fMB in %d assets."), *LevelName, ToMB(Used), ToMB(Peak), ToMB(AssetBytes), Assets.Num());
+	}
+
+	FFileHelper::SaveStringToFile(Summary, *(OutputDir / TEXT("Summary.csv")));
+
+	// Fail if any level couldn't be loaded or is over budget.
+	return NumFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "MemoryBudgetCommandlet.generated.h"
+
+/**
+ * Loads every level under Content/Levels on its own and reports how much memory it costs.
+ * Each level gets a report in Saved/MemoryBudgets with the memory it used, the peak, the memory of each asset class,
+ * and, when run with -llm, the memory under each Low Level Memory Tracker tag. Summary.csv lists every level.
+ * The peak is sampled throughout each level's load. If a budget is given, the commandlet fails when any level peaks above it.
+ * These are editor numbers, which include editor-only data, so budgets must still be checked on a cooked build.
+ *
+ * Usage: UE4Editor-Cmd.exe Golf.uproject -run=MemoryBudget [-Level=Name] [-BudgetMB=0] [-Output=Directory] [-llm]
+ */
+UCLASS()
+class UMemoryBudgetCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UMemoryBudgetCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ParSolverCommandlet.h"
+#include "Misc/Paths.h"
+#include "HAL/PlatformTime.h"
+#include "Simulation/ParSolver.h"
+#include "SimWorldBuilder.h"
+#include "UltraBallSimTypes.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogParSolver, Log, All);
+
+UParSolverCommandlet::UParSolverCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UParSolverCommandlet::Main(const FString& Params)
+{
+	FString LevelFilter;
+	FParse::Value(*Params, TEXT("Level="), LevelFilter);
+
+	FParSolverSettings Settings;
+	FParse::Value(*Params, TEXT("Yaw="), Settings.NumYawSteps);
+	FParse::Value(*Params, TEXT("Pitch="), Settings.NumPitchSteps);
+	FParse::Value(*Params, TEXT("Charge="), Settings.NumChargeSteps);
+
+	// Each level is searched up to its own MaxParAllowed unless a limit is given.
+	int32 MaxPar = 0;
+	FParse::Value(*Params, TEXT("MaxPar="), MaxPar);
+
+	int32 NumThreads = 0;
+	FParse::Value(*Params, TEXT("Threads="), NumThreads);
+	FSimThreadPool ThreadPool(NumThreads);
+
+	TArray<FString> LevelFiles;
+	FSimWorldBuilder::FindLevelFiles(LevelFiles);
+
+	int32 NumUnsolved = 0;
+	for (const FString& LevelFile : LevelFiles)
+	{
+		const FString LevelName = FPaths::GetBaseFilename(LevelFile);
+		if (!LevelFilter.IsEmpty() && LevelName != LevelFilter)
+			continue;
+
+		FSimSettings SimSettings;
+		FSimWorld SimWorld;
+		FSimLevelInfo LevelInfo;
+		if (!FSimWorldBuilder::BuildLevel(LevelFile, SimSettings, SimWorld, LevelInfo))
+		{
+			UE_LOG(LogParSolver, Warning, TEXT("%s: Could not load the level."), *LevelName);
+			continue;
+		}
+		SimSettings.GravityZ = LevelInfo.GravityZ;
+
+		if (!LevelInfo.hasBall || SimWorld.Finishes.empty())
+		{
+			UE_LOG(LogParSolver, Display, TEXT("%s: Skipped, the level has no UltraBall or no Finish Target."), *LevelName);
+			continue;
+		}
+
+		if (LevelInfo.hasUnsupportedActors)
+		{
+			NumUnsolved++;
+			UE_LOG(LogParSolver, Error, TEXT("%s: Skipped, the level has actors the simulation can't model."), *LevelName);
+			continue;
+		}
+
+		Settings.MaxPar = MaxPar > 0 ? MaxPar : (LevelInfo.MaxParAllowed > 0 ? LevelInfo.MaxParAllowed : FParSolverSettings().MaxPar);
+		Settings.MaxChargePossibleAtFullChargeUp = LevelInfo.MaxChargePossibleAtFullChargeUp;
+		const double StartTime = FPlatformTime::Seconds();
+		FParSolver Solver(SimWorld, SimSettings, Settings, ThreadPool);
+		const FParSolution Solution = Solver.Solve(UltraBallSim::ToSim(LevelInfo.BallLocation));
+		const double SolveTime = FPlatformTime::Seconds() - StartTime;
+
+		if (!Solution.isSolved)
+		{
+			NumUnsolved++;
+			UE_LOG(LogParSolver, Warning, TEXT("%s: No solution within %d shots (MaxParAllowed %d). %lld shots simulated in %.1fs."),
+				*LevelName, Settings.MaxPar, LevelInfo.MaxParAllowed, Solution.SimulatedShots, SolveTime);
+			continue;
+		}
+
+		if (Solution.Par > LevelInfo.MaxParAllowed)
+			NumUnsolved++;
+
+		UE_LOG(LogParSolver, Display, TEXT("%s: Minimum par %d (MaxParAllowed %d). %lld shots simulated in %.1fs."),
+			*LevelName, Solution.Par, LevelInfo.MaxParAllowed, Solution.SimulatedShots, SolveTime);
+		for (int32 i = 0; i < (int32)Solution.Shots.size(); i++)
+		{
+			const FParShot& Shot = Solution.Shots[i];
+			UE_LOG(LogParSolver, Display, TEXT("    Shot %d: Direction %s, Charge %.2f, lands at %s"),
+				i + 1, *UltraBallSim::FromSim(Shot.Direction).ToString(), Shot.Charge, *UltraBallSim::FromSim(Shot.Landing).ToString());
+		}
+	}
+
+	// Fail if any level can't be finished within its MaxParAllowed.
+	return NumUnsolved > 0 ? 1 : 0;
+}
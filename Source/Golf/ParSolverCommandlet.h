@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ParSolverCommandlet.generated.h"
+
+/**
+ * Works out the fewest shots needed to finish every level under Content/Levels and compares it to MaxParAllowed.
+ *
+ * Usage: UE4Editor-Cmd.exe Golf.uproject -run=ParSolver [-Level=Name] [-Yaw=32] [-Pitch=4] [-Charge=8] [-MaxPar=N] [-Threads=0]
+ * Each level is searched up to its own MaxParAllowed, or up to MaxPar if it is given.
+ */
+UCLASS()
+class UParSolverCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UParSolverCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,248 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ReplaySubsystem.h"
+#include "Engine/World.h"
+#include "Engine/GameInstance.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+#include "Ball.h"
+#include "UltraBallSimTypes.h"
+#include "GolfPerf.h"
+#include "GolfMemory.h"
+
+DECLARE_CYCLE_STAT(TEXT("Replay Record"), STAT_ReplayRecord, STATGROUP_UltraBall);
+DECLARE_CYCLE_STAT(TEXT("Replay Write"), STAT_ReplayWrite, STATGROUP_UltraBall);
+
+DEFINE_LOG_CATEGORY_STATIC(LogReplay, Log, All);
+
+static TAutoConsoleVariable<int32> CVarReplayEnabled(
+	TEXT("UltraBall.Replay.Enabled"),
+	1,
+	TEXT("Whether each run is recorded into Saved/Replays. Takes effect from the next level."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarReplaySampleRate(
+	TEXT("UltraBall.Replay.SampleRate"),
+	30.0f,
+	TEXT("How many times a second UltraBall is sampled while recording. Takes effect from the next level."),
+	ECVF_Default);
+
+// Replays store locations to the nearest millimetre.
+static const float ReplayPositionQuantum = 0.1f;
+
+// How many finished chunks can wait for the writer before the game waits for it to catch up. A chunk is a few kilobytes at most.
+static const int32 MaxPendingChunks = 64;
+
+void UReplaySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	NumPendingChunks = 0;
+	isWriting = false;
+	WorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddUObject(this, &UReplaySubsystem::OnWorldCleanup);
+}
+
+void UReplaySubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldCleanup.Remove(WorldCleanupHandle);
+	StopRecording();
+
+	Super::Deinitialize();
+}
+
+TStatId UReplaySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UReplaySubsystem, STATGROUP_Tickables);
+}
+
+UReplaySubsystem* UReplaySubsystem::Get(const UWorld* World)
+{
+	UGameInstance* GameInstance = World != nullptr ? World->GetGameInstance() : nullptr;
+	return GameInstance != nullptr ? GameInstance->GetSubsystem<UReplaySubsystem>() : nullptr;
+}
+
+FString UReplaySubsystem::GetReplayDir()
+{
+	return FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir() / TEXT("Replays"));
+}
+
+TSharedPtr<FReplayReader> UReplaySubsystem::OpenReplay(const FString& File)
+{
+	TSharedPtr<FReplayReader> Reader = MakeShared<FReplayReader>();
+	if (!Reader->Open(TCHAR_TO_UTF8(*File)))
+		return nullptr;
+	return Reader;
+}
+
+void UReplaySubsystem::StartRecording(ABall* InBall, const FString& LevelName)
+{
+	StopRecording();
+
+	const float SampleRate = FMath::Clamp(CVarReplaySampleRate.GetValueOnGameThread(), 1.0f, 240.0f);
+	if (InBall == nullptr || CVarReplayEnabled.GetValueOnGameThread() == 0)
+		return;
+
+	GOLF_LLM_SCOPE(Golf);
+	FileName = GetReplayDir() / FString::Printf(TEXT("%s-%s.ubreplay"), *LevelName, *FDateTime::Now().ToString());
+	IFileManager::Get().MakeDirectory(*GetReplayDir(), true);
+	FileWriter = MakeShareable(IFileManager::Get().CreateFileWriter(*FileName));
+	if (!FileWriter.IsValid())
+	{
+		UE_LOG(LogReplay, Warning, TEXT("Could not create %s. This run won't be recorded."), *FileName);
+		return;
+	}
+
+	Encoder = MakeUnique<FReplayEncoder>(SampleRate, ReplayPositionQuantum, TCHAR_TO_UTF8(*LevelName), FDateTime::UtcNow().ToUnixTimestamp());
+	FileWriter->Serialize(const_cast<FReplayHeader*>(&Encoder->GetHeader()), sizeof(FReplayHeader));
+
+	Ball = InBall;
+	RecordedWorld = InBall->GetWorld();
+	SampleInterval = 1.0f / SampleRate;
+	NextSampleTime = RecordedWorld->GetTimeSeconds();
+}
+
+void UReplaySubsystem::StopRecording()
+{
+	if (Encoder.IsValid())
+	{
+		if (!Encoder->IsChunkEmpty())
+			QueueChunk();
+		Encoder.Reset();
+	}
+
+	// Let the writer finish with every chunk before the file is closed.
+	if (WriterTask.IsValid())
+	{
+		WriterTask.Wait();
+		WriterTask = TFuture<void>();
+	}
+
+	if (FileWriter.IsValid())
+	{
+		FileWriter->Close();
+		FileWriter.Reset();
+		UE_LOG(LogReplay, Log, TEXT("Replay written to %s."), *FileName);
+	}
+
+	Ball.Reset();
+	RecordedWorld.Reset();
+}
+
+void UReplaySubsystem::RecordShot(const ABall* InBall, const FVector& LaunchVelocity, float Charge, int32 Par)
+{
+	if (!Encoder.IsValid() || InBall != Ball.Get())
+		return;
+
+	FReplayEvent Event;
+	Event.Type = EReplayEventType::Shot;
+	Event.Par = (int16_t)Par;
+	Event.Charge = Charge;
+	Event.Velocity = UltraBallSim::ToSim(LaunchVelocity);
+	Encoder->AddEvent(Event);
+}
+
+void UReplaySubsystem::RecordFinish(const ABall* InBall, int32 Par)
+{
+	if (!Encoder.IsValid() || InBall != Ball.Get())
+		return;
+
+	FReplayEvent Event;
+	Event.Type = EReplayEventType::Finish;
+	Event.Par = (int16_t)Par;
+	Encoder->AddEvent(Event);
+}
+
+void UReplaySubsystem::Tick(float DeltaTime)
+{
+	ULTRABALL_SCOPE_CYCLE_COUNTER(STAT_ReplayRecord);
+	UWorld* World = RecordedWorld.Get();
+	if (World == nullptr || !Ball.IsValid())
+		return;
+
+	// Sample on a fixed clock in game time. A long frame is filled with copies of the same sample, which cost a byte each.
+	// If the game falls far behind, skip ahead rather than catching up.
+	const float Now = World->GetTimeSeconds();
+	if (Now - NextSampleTime > 1.0f)
+		NextSampleTime = Now;
+	while (NextSampleTime <= Now)
+	{
+		AddSample();
+		NextSampleTime += SampleInterval;
+	}
+}
+
+void UReplaySubsystem::AddSample()
+{
+	const UStaticMeshComponent* UltraBall = Ball->UltraBall;
+	const FVector Location = UltraBall->GetComponentLocation();
+	const FQuat Rotation = UltraBall->GetComponentQuat();
+
+	FReplaySample Sample;
+	Sample.Location = UltraBallSim::ToSim(Location);
+	Sample.Rotation.X = Rotation.X;
+	Sample.Rotation.Y = Rotation.Y;
+	Sample.Rotation.Z = Rotation.Z;
+	Sample.Rotation.W = Rotation.W;
+	Sample.ZoneState = Ball->GetZoneState();
+	Encoder->AddSample(Sample);
+
+	if (Encoder->IsChunkFull())
+		QueueChunk();
+}
+
+void UReplaySubsystem::QueueChunk()
+{
+	std::vector<uint8_t> Chunk;
+	{
+		GOLF_LLM_SCOPE(Golf);
+		Encoder->TakeChunk(Chunk);
+	}
+
+	// If the writer can't keep up, wait for it to write out what it has rather than hold more memory. Chunks are never dropped,
+	// as playback needs every one of them. The writer is always running while chunks are waiting, so this is the task to wait for.
+	if (NumPendingChunks >= MaxPendingChunks && WriterTask.IsValid())
+	{
+		UE_LOG(LogReplay, Warning, TEXT("The replay writer has fallen behind. Waiting for it to catch up with %s."), *FileName);
+		WriterTask.Wait();
+	}
+
+	NumPendingChunks++;
+	PendingChunks.Enqueue(MoveTemp(Chunk));
+	KickWriter();
+}
+
+void UReplaySubsystem::KickWriter()
+{
+	// Only one writer runs at a time, so it is the only thing taking from the queue.
+	if (isWriting.Exchange(true))
+		return;
+
+	TSharedPtr<FArchive, ESPMode::ThreadSafe> Writer = FileWriter;
+	WriterTask = Async(EAsyncExecution::ThreadPool, [this, Writer]()
+	{
+		ULTRABALL_SCOPE_CYCLE_COUNTER(STAT_ReplayWrite);
+		while (true)
+		{
+			std::vector<uint8_t> Chunk;
+			while (PendingChunks.Dequeue(Chunk))
+			{
+				Writer->Serialize(Chunk.data(), Chunk.size());
+				NumPendingChunks--;
+			}
+			Writer->Flush();
+			isWriting = false;
+
+			// A chunk could have been queued after the queue was found empty but before the flag was cleared.
+			if (PendingChunks.IsEmpty() || isWriting.Exchange(true))
+				return;
+		}
+	});
+}
+
+void UReplaySubsystem::OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources)
+{
+	if (World != nullptr && World == RecordedWorld.Get())
+		StopRecording();
+}
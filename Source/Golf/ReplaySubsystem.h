@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Tickable.h"
+#include "Containers/Queue.h"
+#include "Async/Future.h"
+#include "Simulation/Replay.h"
+#include "ReplaySubsystem.generated.h"
+
+class ABall;
+
+/**
+ * Records every run into Saved/Replays so it can be played back for support tickets and leaderboard checks.
+ * UltraBall's transform and zone state are sampled at a fixed rate, with every shot and finish in between.
+ * Finished chunks are written by a worker thread. Only a handful are held waiting to be written. If the disk falls behind,
+ * the game waits for the writer to catch up, so a long session can't build up memory and no samples are lost.
+ */
+UCLASS()
+class GOLF_API UReplaySubsystem : public UGameInstanceSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return Encoder.IsValid(); }
+	virtual TStatId GetStatId() const override;
+
+	// Returns the subsystem for this world, or null if there isn't one.
+	static UReplaySubsystem* Get(const UWorld* World);
+
+	// Returns the folder replays are written to.
+	static FString GetReplayDir();
+
+	// Map a replay for playback. Returns null if it can't be opened.
+	static TSharedPtr<FReplayReader> OpenReplay(const FString& File);
+
+	// Start recording UltraBall in a level, finishing any recording already under way.
+	void StartRecording(ABall* InBall, const FString& LevelName);
+
+	// Write out the rest of the recording and close the file.
+	void StopRecording();
+
+	// Record a shot. Called by UltraBall when it is fired. Shots by balls other than the one being recorded are ignored.
+	void RecordShot(const ABall* InBall, const FVector& LaunchVelocity, float Charge, int32 Par);
+
+	// Record UltraBall reaching the Finish Target.
+	void RecordFinish(const ABall* InBall, int32 Par);
+
+private:
+
+	// Add a sample of where UltraBall is now.
+	void AddSample();
+
+	// Queue the chunk being filled for the writer.
+	void QueueChunk();
+
+	// Write any queued chunks on a worker thread.
+	void KickWriter();
+
+	void OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources);
+
+	TWeakObjectPtr<ABall> Ball;
+	TWeakObjectPtr<UWorld> RecordedWorld;
+	TUniquePtr<FReplayEncoder> Encoder;
+	float SampleInterval;
+	float NextSampleTime;
+
+	// Chunks waiting to be written. Only the game thread adds to the queue and only the writer takes from it.
+	TQueue<std::vector<uint8_t>, EQueueMode::Spsc> PendingChunks;
+	TAtomic<int32> NumPendingChunks;
+	TAtomic<bool> isWriting;
+	TFuture<void> WriterTask;
+	TSharedPtr<FArchive, ESPMode::ThreadSafe> FileWriter;
+	FString FileName;
+
+	FDelegateHandle WorldCleanupHandle;
+};
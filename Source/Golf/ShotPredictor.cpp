@@ -0,0 +1,386 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ShotPredictor.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Actor.h"
+#include "Components/BoxComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Bumper.h"
+#include "GravityWell.h"
+#include "UltraBallSimTypes.h"
+#include "GolfPerf.h"
+#include "GolfMemory.h"
+
+DECLARE_CYCLE_STAT(TEXT("Predictor Request Sweeps"), STAT_PredictorRequestSweeps, STATGROUP_UltraBall);
+DECLARE_CYCLE_STAT(TEXT("Predictor Process Sweeps"), STAT_PredictorProcessSweeps, STATGROUP_UltraBall);
+DECLARE_CYCLE_STAT(TEXT("Predictor Distance Field"), STAT_PredictorDistanceField, STATGROUP_UltraBall);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Predictor Sweeps"), STAT_PredictorSweeps, STATGROUP_UltraBall);
+
+FShotPredictor::FShotPredictor()
+	: QueryParams(SCENE_QUERY_STAT(ShotPredictor), true)
+{
+	// Set up the initial values. These can be overridden by the owner.
+	LocationTolerance = 1.0f;
+	VelocityTolerance = 1.0f;
+	SimFrequency = 12.0f;
+	MaxSimTime = 2.0f;
+	ProjectileRadius = 30.0f;
+	Restitution = 0.5f;
+	MaxBounces = 3;
+
+	CachedStartLocation = FVector::ZeroVector;
+	CachedLaunchVelocity = FVector::ZeroVector;
+	isCachedCameraLocked = false;
+	isCacheValid = false;
+	TimeRemaining = 0.0f;
+	BouncesRemaining = 0;
+	hasDistanceFieldBumpers = false;
+}
+
+void FShotPredictor::SetIgnoredActor(AActor* Actor)
+{
+	QueryParams.ClearIgnoredActors();
+	if (Actor != nullptr)
+		QueryParams.AddIgnoredActor(Actor);
+	isCacheValid = false;
+}
+
+void FShotPredictor::SetDistanceField(const TSharedPtr<const FSimDistanceField, ESPMode::ThreadSafe>& InDistanceField)
+{
+	if (InDistanceField == DistanceField)
+		return;
+
+	DistanceField = InDistanceField;
+	DistanceFieldBumpers.Reset();
+	hasDistanceFieldBumpers = false;
+	Batch.Reset();
+	isCacheValid = false;
+}
+
+void FShotPredictor::GatherDistanceFieldBumpers(UWorld* World)
+{
+	// Bumpers don't move, so their triggers are gathered once for each Distance Field rather than on every trace.
+	DistanceFieldBumpers.Reset();
+	for (TActorIterator<ABumper> It(World); It; ++It)
+	{
+		const FTransform& Transform = It->Colider->GetComponentTransform();
+		FSimBumper Bumper;
+		Bumper.Trigger.Center = UltraBallSim::ToSim(Transform.GetLocation());
+		Bumper.Trigger.HalfExtents = UltraBallSim::ToSim(It->Colider->GetScaledBoxExtent());
+		Bumper.Trigger.AxisX = UltraBallSim::ToSim(Transform.GetUnitAxis(EAxis::X));
+		Bumper.Trigger.AxisY = UltraBallSim::ToSim(Transform.GetUnitAxis(EAxis::Y));
+		Bumper.Trigger.AxisZ = UltraBallSim::ToSim(Transform.GetUnitAxis(EAxis::Z));
+		Bumper.Forward = UltraBallSim::ToSim(It->Bumper->GetForwardVector());
+		Bumper.BouncePower = It->BouncePower;
+		DistanceFieldBumpers.Add(Bumper);
+	}
+	hasDistanceFieldBumpers = true;
+}
+
+const TArray<FVector>& FShotPredictor::GetPath(UWorld* World, const FVector& StartLocation, const FVector& LaunchVelocity, bool isCameraLocked)
+{
+	GOLF_LLM_SCOPE(Predictor);
+
+	// Pick up the sweeps requested last frame. This can extend the path or request the next batch.
+	ProcessBatch(World);
+
+	// If the shot has changed, trace the new one. A path still being traced is finished first, so the rings always show a
+	// whole path rather than only its first arc while the charge changes every frame. The newest shot is traced after it.
+	if (!IsCacheValidFor(StartLocation, LaunchVelocity, isCameraLocked) && Batch.Num() == 0)
+	{
+		// A path from somewhere else isn't worth showing while the new one is traced.
+		if (!StartLocation.Equals(CachedStartLocation, LocationTolerance))
+			PathPoints.Reset();
+
+		CachedStartLocation = StartLocation;
+		CachedLaunchVelocity = LaunchVelocity;
+		isCachedCameraLocked = isCameraLocked;
+		isCacheValid = true;
+		if (DistanceField.IsValid())
+			TraceDistanceField(World);
+		else
+			StartPrediction(World);
+	}
+
+	return PathPoints;
+}
+
+bool FShotPredictor::IsCacheValidFor(const FVector& StartLocation, const FVector& LaunchVelocity, bool isCameraLocked) const
+{
+	if (!isCacheValid || isCameraLocked != isCachedCameraLocked)
+		return false;
+
+	if (!StartLocation.Equals(CachedStartLocation, LocationTolerance))
+		return false;
+
+	return LaunchVelocity.Equals(CachedLaunchVelocity, VelocityTolerance);
+}
+
+void FShotPredictor::StartPrediction(UWorld* World)
+{
+	Batch.Reset();
+	EnteredZones.Reset();
+	TracingPath.Reset();
+	TracingPath.Add(CachedStartLocation);
+	TimeRemaining = MaxSimTime;
+	BouncesRemaining = MaxBounces;
+	SweepShape = FCollisionShape::MakeSphere(ProjectileRadius);
+
+	RequestBatch(World, CachedStartLocation, CachedLaunchVelocity);
+	if (Batch.Num() == 0)
+		PathPoints = TracingPath;
+}
+
+void FShotPredictor::RequestBatch(UWorld* World, const FVector& Location, const FVector& Velocity)
+{
+	if (World == nullptr || SimFrequency <= 0.0f)
+		return;
+	ULTRABALL_SCOPE_CYCLE_COUNTER(STAT_PredictorRequestSweeps);
+
+	const float StepTime = 1.0f / SimFrequency;
+	const FVector Gravity(0.0f, 0.0f, World->GetGravityZ());
+	const int NumSteps = FMath::CeilToInt(TimeRemaining * SimFrequency);
+
+	// Step along the arc and request one multi sweep per step. Multi sweeps also report the overlap zones.
+	FVector StepLocation = Location;
+	FVector StepVelocity = Velocity;
+	for (int i = 0; i < NumSteps; i++)
+	{
+		FSweepSegment& Segment = Batch.AddDefaulted_GetRef();
+		Segment.Start = StepLocation;
+		Segment.StartVelocity = StepVelocity;
+		Segment.End = StepLocation + (StepVelocity * StepTime) + (0.5f * Gravity * StepTime * StepTime);
+		Segment.Handle = World->AsyncSweepByChannel(EAsyncTraceType::Multi, Segment.Start, Segment.End, FQuat::Identity, ECC_Visibility, SweepShape, QueryParams);
+
+		StepLocation = Segment.End;
+		StepVelocity += Gravity * StepTime;
+	}
+	GOLF_PERF_COUNT_QUERIES(NumSteps);
+	INC_DWORD_STAT_BY(STAT_PredictorSweeps, NumSteps);
+	CSV_CUSTOM_STAT(UltraBall, STAT_PredictorSweeps, NumSteps, ECsvCustomStatOp::Accumulate);
+}
+
+void FShotPredictor::ProcessBatch(UWorld* World)
+{
+	if (Batch.Num() == 0 || World == nullptr)
+		return;
+	ULTRABALL_SCOPE_CYCLE_COUNTER(STAT_PredictorProcessSweeps);
+
+	// Collect the results. If any of the sweeps have expired, give up on this batch and re-trace next frame.
+	FTraceDatum Datum;
+	for (FSweepSegment& Segment : Batch)
+	{
+		if (!World->QueryTraceData(Segment.Handle, Datum))
+		{
+			if (!World->IsTraceHandleValid(Segment.Handle, false))
+			{
+				Batch.Reset();
+				isCacheValid = false;
+			}
+			return;
+		}
+		Segment.Hits = MoveTemp(Datum.OutHits);
+	}
+
+	const float StepTime = 1.0f / SimFrequency;
+	const FVector Gravity(0.0f, 0.0f, World->GetGravityZ());
+
+	// Walk the segments in order until something changes the path.
+	bool hasContinued = false;
+	bool hasStopped = false;
+	FVector NextLocation = FVector::ZeroVector;
+	FVector NextVelocity = FVector::ZeroVector;
+	for (const FSweepSegment& Segment : Batch)
+	{
+		// Find the first hit in this segment that affects the path. Hits are returned in order along the sweep.
+		const FHitResult* EventHit = nullptr;
+		for (const FHitResult& Hit : Segment.Hits)
+		{
+			// Ignore anything UltraBall is already touching or has already passed through.
+			if (Hit.bStartPenetrating || EnteredZones.Contains(Hit.GetComponent()))
+				continue;
+
+			if (Hit.bBlockingHit || Cast<ABumper>(Hit.GetActor()) != nullptr || Cast<AGravityWell>(Hit.GetActor()) != nullptr)
+			{
+				EventHit = &Hit;
+				break;
+			}
+		}
+
+		if (EventHit == nullptr)
+		{
+			TracingPath.Add(Segment.End);
+			TimeRemaining -= StepTime;
+			continue;
+		}
+
+		// Follow the path through the hit.
+		const float HitTime = StepTime * EventHit->Time;
+		const FVector IncomingVelocity = Segment.StartVelocity + (Gravity * HitTime);
+		TracingPath.Add(EventHit->Location);
+		TimeRemaining -= HitTime;
+
+		if (BouncesRemaining > 0 && TimeRemaining > 0.0f && ResolveHit(*EventHit, IncomingVelocity, NextLocation, NextVelocity))
+		{
+			BouncesRemaining--;
+			hasContinued = true;
+		}
+		else
+			hasStopped = true;
+		break;
+	}
+	Batch.Reset();
+
+	// Carry on from the hit next frame. Only once the path has ended is it shown, replacing the last whole path.
+	if (hasContinued && !hasStopped)
+		RequestBatch(World, NextLocation, NextVelocity);
+	if (Batch.Num() == 0)
+		PathPoints = TracingPath;
+}
+
+void FShotPredictor::TraceDistanceField(UWorld* World)
+{
+	ULTRABALL_SCOPE_CYCLE_COUNTER(STAT_PredictorDistanceField);
+	TracingPath.Reset();
+	TracingPath.Add(CachedStartLocation);
+	PathPoints = TracingPath;
+	if (World == nullptr || SimFrequency <= 0.0f)
+		return;
+
+	// Bumper triggers aren't part of the Distance Field, so check them directly.
+	if (!hasDistanceFieldBumpers)
+		GatherDistanceFieldBumpers(World);
+	UGravityFieldSubsystem* GravityFields = UGravityFieldSubsystem::Get(World);
+	TArray<FGravityField, TInlineAllocator<4>> Fields;
+	TArray<int32, TInlineAllocator<8>> EnteredFields;
+	TArray<int32, TInlineAllocator<8>> EnteredBumpers;
+
+	const float StepTime = 1.0f / SimFrequency;
+	const FVector Gravity(0.0f, 0.0f, World->GetGravityZ());
+	const float MinMove = DistanceField->GetVoxelSize() * 0.5f;
+	const float MinBounceSpeedSquared = FMath::Square(ProjectileRadius * SimFrequency * 0.5f);
+	FVector Location = CachedStartLocation;
+	FVector Velocity = CachedLaunchVelocity;
+	int Bounces = MaxBounces;
+	FSimVector Normal;
+	float Distance = DistanceField->GetDistance(UltraBallSim::ToSim(Location));
+
+	const int NumSteps = FMath::CeilToInt(MaxSimTime * SimFrequency);
+	for (int Step = 0; Step < NumSteps; Step++)
+	{
+		// Move in small enough pieces that UltraBall can't pass through anything. Each piece is no longer than the free space around it.
+		float TimeLeft = StepTime;
+		for (int Move = 0; Move < 64 && TimeLeft > 0.0f; Move++)
+		{
+			const float FreeSpace = FMath::Max(Distance - ProjectileRadius, MinMove);
+			const float MoveTime = FMath::Min(TimeLeft, FreeSpace / FMath::Max(Velocity.Size(), 1.0f));
+			Location += (Velocity * MoveTime) + (0.5f * Gravity * MoveTime * MoveTime);
+			Velocity += Gravity * MoveTime;
+			TimeLeft -= MoveTime;
+
+			// Bounce off walls, losing some speed. Stop once the bounce is too small to matter.
+			Distance = DistanceField->GetDistanceAndNormal(UltraBallSim::ToSim(Location), Normal);
+			const FVector SurfaceNormal = UltraBallSim::FromSim(Normal);
+			if (Distance < ProjectileRadius && FVector::DotProduct(Velocity, SurfaceNormal) < 0.0f)
+			{
+				TracingPath.Add(Location);
+				if (Bounces-- <= 0)
+				{
+					PathPoints = TracingPath;
+					return;
+				}
+				Velocity -= (1.0f + Restitution) * FVector::DotProduct(Velocity, SurfaceNormal) * SurfaceNormal;
+				Location += SurfaceNormal * (ProjectileRadius - Distance);
+				Distance = ProjectileRadius;
+				if (Velocity.SizeSquared() <= MinBounceSpeedSquared)
+				{
+					PathPoints = TracingPath;
+					return;
+				}
+			}
+
+			// Bumpers fire UltraBall in the direction they face, matching ABumper::OnOverlapBegin.
+			for (int32 BumperIndex = 0; BumperIndex < DistanceFieldBumpers.Num(); BumperIndex++)
+			{
+				const FSimBumper& Bumper = DistanceFieldBumpers[BumperIndex];
+				float Depth;
+				if (!EnteredBumpers.Contains(BumperIndex) && FUltraBallSim::CollideSphereBox(UltraBallSim::ToSim(Location), ProjectileRadius, Bumper.Trigger, Normal, Depth))
+				{
+					EnteredBumpers.Add(BumperIndex);
+					TracingPath.Add(Location);
+					Velocity = UltraBallSim::FromSim(FUltraBallSim::GetBumperVelocity(Bumper.Forward, Bumper.BouncePower));
+				}
+			}
+
+			// Gravity Wells pull UltraBall to their center and hold it there. Launcher Wells then fire it out again.
+			if (GravityFields != nullptr)
+			{
+				GravityFields->FindFieldsAt(Location, Fields);
+				for (const FGravityField& Field : Fields)
+				{
+					if (EnteredFields.Contains(Field.Id))
+						continue;
+
+					EnteredFields.Add(Field.Id);
+					TracingPath.Add(Location);
+					TracingPath.Add(Field.Center);
+					if (Field.Type != EGravityFieldType::Launcher || Bounces-- <= 0)
+					{
+						PathPoints = TracingPath;
+						return;
+					}
+					Location = Field.Center;
+					Velocity = UltraBallSim::FromSim(FUltraBallSim::GetLauncherVelocity(UltraBallSim::ToSim(Field.LaunchDirection), Field.LaunchPower));
+					Distance = DistanceField->GetDistance(UltraBallSim::ToSim(Location));
+					break;
+				}
+			}
+		}
+		TracingPath.Add(Location);
+	}
+
+	PathPoints = TracingPath;
+}
+
+bool FShotPredictor::ResolveHit(const FHitResult& Hit, const FVector& IncomingVelocity, FVector& OutLocation, FVector& OutVelocity)
+{
+	// Bumpers fire UltraBall in the direction they face, matching ABumper::OnOverlapBegin.
+	if (ABumper* Bumper = Cast<ABumper>(Hit.GetActor()))
+	{
+		if (!Hit.bBlockingHit && Hit.GetComponent() == Bumper->Colider)
+		{
+			EnteredZones.Add(Hit.GetComponent());
+			OutLocation = Hit.Location;
+			OutVelocity = UltraBallSim::FromSim(FUltraBallSim::GetBumperVelocity(UltraBallSim::ToSim(Bumper->Bumper->GetForwardVector()), Bumper->BouncePower));
+			return true;
+		}
+	}
+
+	// Gravity Wells pull UltraBall to their center and hold it there. Launcher Wells then fire it out again.
+	if (AGravityWell* Well = Cast<AGravityWell>(Hit.GetActor()))
+	{
+		if (!Hit.bBlockingHit)
+		{
+			const FGravityField Field = Well->GetField();
+			EnteredZones.Add(Hit.GetComponent());
+			if (Field.Type != EGravityFieldType::Launcher)
+			{
+				TracingPath.Add(Field.Center);
+				return false;
+			}
+			OutLocation = Field.Center;
+			OutVelocity = UltraBallSim::FromSim(FUltraBallSim::GetLauncherVelocity(UltraBallSim::ToSim(Field.LaunchDirection), Field.LaunchPower));
+			return true;
+		}
+	}
+
+	if (!Hit.bBlockingHit)
+		return false;
+
+	// Reflect off the surface, losing some speed. Stop once the bounce is too small to matter.
+	const FVector Normal = Hit.ImpactNormal;
+	OutVelocity = IncomingVelocity - ((1.0f + Restitution) * FVector::DotProduct(IncomingVelocity, Normal) * Normal);
+	OutLocation = Hit.Location + Normal;
+	return OutVelocity.SizeSquared() > FMath::Square(ProjectileRadius * SimFrequency * 0.5f);
+}
@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WorldCollision.h"
+#include "Simulation/DistanceField.h"
+
+class AActor;
+class UWorld;
+class UPrimitiveComponent;
+
+/**
+ * Predicts the path UltraBall will take when fired.
+ * The path is traced with batches of async sweeps, so results arrive on the frame after they are requested.
+ * Each batch follows the arc until something is hit, then the path continues off walls, Bumpers and Gravity Wells
+ * in the next batch. The last whole path is shown until the next one has been traced to its end, and is only re-traced
+ * when the shot changes past the tolerances.
+ * If the level has a baked Distance Field, the path is traced against it straight away instead of with sweeps.
+ */
+class GOLF_API FShotPredictor
+{
+public:
+	FShotPredictor();
+
+	// Set the actor that the predictor traces should ignore (normally UltraBall itself).
+	void SetIgnoredActor(AActor* Actor);
+
+	// Return the predicted path for this shot. This is the most recent whole path the async traces have returned,
+	// so it lags the shot by a frame for each bounce. New traces are only requested if the shot has changed.
+	const TArray<FVector>& GetPath(UWorld* World, const FVector& StartLocation, const FVector& LaunchVelocity, bool isCameraLocked);
+
+	// Trace against this Distance Field instead of the physics scene. Pass null to go back to sweeps.
+	void SetDistanceField(const TSharedPtr<const FSimDistanceField, ESPMode::ThreadSafe>& InDistanceField);
+
+	// Force the next call to GetPath to re-trace the path.
+	FORCEINLINE void Invalidate() { isCacheValid = false; }
+
+	// How far the start location can move before the path is re-traced.
+	float LocationTolerance;
+
+	// How far the launch velocity can change before the path is re-traced.
+	float VelocityTolerance;
+
+	// How many points per second of flight the path is traced with.
+	float SimFrequency;
+
+	// How many seconds of flight to predict.
+	float MaxSimTime;
+
+	// Radius of the sweep. This should match the size of UltraBall.
+	float ProjectileRadius;
+
+	// How much speed is kept when the path bounces off a wall.
+	float Restitution;
+
+	// How many bounces and zones the path follows before stopping.
+	int MaxBounces;
+
+private:
+
+	// A single sweep within a batch and the result that came back for it.
+	struct FSweepSegment
+	{
+		FTraceHandle Handle;
+		FVector Start;
+		FVector End;
+		FVector StartVelocity;
+		TArray<FHitResult> Hits;
+	};
+
+	// Returns whether the cached path can be reused for this shot.
+	bool IsCacheValidFor(const FVector& StartLocation, const FVector& LaunchVelocity, bool isCameraLocked) const;
+
+	// Start tracing a new path from the start of the shot.
+	void StartPrediction(UWorld* World);
+
+	// Request async sweeps along the arc from this location and velocity.
+	void RequestBatch(UWorld* World, const FVector& Location, const FVector& Velocity);
+
+	// Collect the sweeps requested last frame and follow the path through anything they hit.
+	void ProcessBatch(UWorld* World);
+
+	// Trace the whole path against the Distance Field.
+	void TraceDistanceField(UWorld* World);
+
+	// Gather the Bumper triggers the Distance Field traces check.
+	void GatherDistanceFieldBumpers(UWorld* World);
+
+	// Work out how the path continues after a hit. Returns false if the path stops here.
+	bool ResolveHit(const FHitResult& Hit, const FVector& IncomingVelocity, FVector& OutLocation, FVector& OutVelocity);
+
+	// Trace parameters are kept between frames so they are not rebuilt every tick.
+	FCollisionQueryParams QueryParams;
+	FCollisionShape SweepShape;
+
+	// The shot currently being traced, or last traced.
+	FVector CachedStartLocation;
+	FVector CachedLaunchVelocity;
+	bool isCachedCameraLocked;
+	bool isCacheValid;
+
+	// The sweeps waiting on results from the async trace.
+	TArray<FSweepSegment> Batch;
+
+	// The path traced so far for the current shot, and the zones it has already passed through.
+	TArray<FVector> TracingPath;
+	TArray<TWeakObjectPtr<UPrimitiveComponent>> EnteredZones;
+	float TimeRemaining;
+	int BouncesRemaining;
+
+	// The Distance Field for the level, if it has one, and the Bumpers in the level, which it doesn't hold.
+	TSharedPtr<const FSimDistanceField, ESPMode::ThreadSafe> DistanceField;
+	TArray<FSimBumper> DistanceFieldBumpers;
+	bool hasDistanceFieldBumpers;
+
+	// The most recent whole path, returned to the Predictor Rings.
+	TArray<FVector> PathPoints;
+
+};
@@ -0,0 +1,338 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SimWorldBuilder.h"
+#include "Engine/World.h"
+#include "Engine/Level.h"
+#include "Engine/StaticMesh.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "UObject/Package.h"
+#include "Components/BoxComponent.h"
+#include "Components/SphereComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "StaticMeshResources.h"
+#include "UltraBallSimTypes.h"
+#include "Ball.h"
+#include "Bumper.h"
+#include "GravityWell.h"
+#include "FinishTarget.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSimWorldBuilder, Log, All);
+
+void FSimWorldBuilder::BuildWorld(UWorld* World, const FSimSettings& Settings, FSimWorld& OutWorld, FSimLevelInfo& OutLevelInfo)
+{
+	OutWorld = FSimWorld();
+	OutLevelInfo = FSimLevelInfo();
+	if (World == nullptr)
+		return;
+
+	OutLevelInfo.GravityZ = World->GetGravityZ();
+	for (ULevel* Level : World->GetLevels())
+	{
+		if (Level == nullptr)
+			continue;
+
+		for (AActor* Actor : Level->Actors)
+		{
+			if (Actor == nullptr || Actor->IsPendingKill())
+				continue;
+
+			// UltraBall only gives the starting point and the shot settings.
+			if (ABall* Ball = Cast<ABall>(Actor))
+			{
+				OutLevelInfo.hasBall = true;
+				OutLevelInfo.BallLocation = Ball->GetActorLocation();
+				OutLevelInfo.MaxParAllowed = Ball->GetMaxPar();
+				OutLevelInfo.MaxChargePossibleAtFullChargeUp = Ball->MaxChargePossibleAtFullChargeUp;
+				continue;
+			}
+
+			// Bumpers fire UltraBall from their trigger. The Bumper model still blocks UltraBall like any other collider.
+			if (ABumper* Bumper = Cast<ABumper>(Actor))
+			{
+				FSimBumper SimBumper;
+				SimBumper.Trigger = MakeBox(Bumper->Colider->GetComponentTransform(), Bumper->Colider->GetUnscaledBoxExtent());
+				SimBumper.Forward = UltraBallSim::ToSim(Bumper->Bumper->GetForwardVector());
+				SimBumper.BouncePower = Bumper->BouncePower;
+				OutWorld.Bumpers.push_back(SimBumper);
+				AddComponent(Bumper->Bumper, OutWorld);
+				continue;
+			}
+
+			// Wells are only fields.
+			if (AGravityWell* Well = Cast<AGravityWell>(Actor))
+			{
+				FGravityField WellField = Well->GetField();
+				if (Well->IsBlueprintLauncher() && !Well->GetBlueprintLauncherField(WellField))
+				{
+					UE_LOG(LogSimWorldBuilder, Error, TEXT("%s: %s is a Blueprint launcher without a Launch Power variable and an Arrow, so its launch can't be modelled. Reparent it to LauncherWell."),
+						*World->GetMapName(), *Well->GetName());
+					OutLevelInfo.hasUnsupportedActors = true;
+					continue;
+				}
+
+				FSimField Field = UltraBallSim::ToSim(WellField);
+				Field.Id = (int32_t)OutWorld.Fields.size();
+				OutWorld.Fields.push_back(Field);
+				continue;
+			}
+
+			// The Finish Target is finished by touching its outer ring.
+			if (AFinishTarget* Finish = Cast<AFinishTarget>(Actor))
+			{
+				const FBoxSphereBounds Bounds = Finish->UltraBallOuter->CalcBounds(Finish->UltraBallOuter->GetComponentTransform());
+				FSimFinish SimFinish;
+				SimFinish.Center = UltraBallSim::ToSim(Bounds.Origin);
+				SimFinish.Radius = Bounds.SphereRadius;
+				OutWorld.Finishes.push_back(SimFinish);
+				continue;
+			}
+
+			TInlineComponentArray<UPrimitiveComponent*> Components(Actor);
+			for (UPrimitiveComponent* Component : Components)
+				AddComponent(Component, OutWorld);
+		}
+	}
+
+	OutWorld.Build(Settings.GridCellSize);
+}
+
+void FSimWorldBuilder::GatherBoxes(UWorld* World, std::vector<FSimBox>& OutBoxes)
+{
+	OutBoxes.clear();
+	if (World == nullptr)
+		return;
+
+	for (ULevel* Level : World->GetLevels())
+	{
+		if (Level == nullptr)
+			continue;
+
+		for (AActor* Actor : Level->Actors)
+		{
+			// UltraBall, the wells and the Finish Target aren't landed on. Only a Bumper's model blocks UltraBall.
+			if (Actor == nullptr || Actor->IsPendingKill() || Actor->IsA<ABall>() || Actor->IsA<AGravityWell>() || Actor->IsA<AFinishTarget>())
+				continue;
+			if (ABumper* Bumper = Cast<ABumper>(Actor))
+			{
+				AddComponentBoxes(Bumper->Bumper, OutBoxes);
+				continue;
+			}
+
+			TInlineComponentArray<UPrimitiveComponent*> Components(Actor);
+			for (UPrimitiveComponent* Component : Components)
+				AddComponentBoxes(Component, OutBoxes);
+		}
+	}
+}
+
+void FSimWorldBuilder::FindLevelFiles(TArray<FString>& OutLevelFiles)
+{
+	OutLevelFiles.Reset();
+	FPackageName::FindPackagesInDirectory(OutLevelFiles, FPaths::ProjectContentDir() / TEXT("Levels"));
+	OutLevelFiles.RemoveAll([](const FString& File) { return FPaths::GetExtension(File, true) != FPackageName::GetMapPackageExtension(); });
+	OutLevelFiles.Sort();
+}
+
+bool FSimWorldBuilder::BuildLevel(const FString& LevelFile, const FSimSettings& Settings, FSimWorld& OutWorld, FSimLevelInfo& OutLevelInfo)
+{
+	FString PackageName;
+	if (!FPackageName::TryConvertFilenameToLongPackageName(LevelFile, PackageName))
+		return false;
+
+	UPackage* Package = LoadPackage(nullptr, *PackageName, LOAD_None);
+	UWorld* World = Package != nullptr ? UWorld::FindWorldInPackage(Package) : nullptr;
+	if (World == nullptr)
+		return false;
+
+	// The components need to be registered so their transforms are up to date.
+	World->AddToRoot();
+	World->WorldType = EWorldType::Editor;
+	World->InitWorld(UWorld::InitializationValues().AllowAudioPlayback(false).CreatePhysicsScene(false).RequiresHitProxies(false).CreateNavigation(false).CreateAISystem(false).ShouldSimulatePhysics(false));
+	World->UpdateWorldComponents(true, false);
+
+	BuildWorld(World, Settings, OutWorld, OutLevelInfo);
+
+	World->DestroyWorld(false);
+	World->RemoveFromRoot();
+	return true;
+}
+
+bool FSimWorldBuilder::IsBlocking(const UPrimitiveComponent* Component)
+{
+	// Only keep what UltraBall, a physics body, would bump into.
+	return Component != nullptr && Component->IsCollisionEnabled() && Component->GetCollisionResponseToChannel(ECC_PhysicsBody) == ECR_Block;
+}
+
+void FSimWorldBuilder::AddComponentBoxes(UPrimitiveComponent* Component, std::vector<FSimBox>& OutBoxes)
+{
+	if (!IsBlocking(Component))
+		return;
+
+	if (UBoxComponent* Box = Cast<UBoxComponent>(Component))
+	{
+		OutBoxes.push_back(MakeBox(Box->GetComponentTransform(), Box->GetUnscaledBoxExtent()));
+		return;
+	}
+
+	if (USphereComponent* Sphere = Cast<USphereComponent>(Component))
+	{
+		OutBoxes.push_back(MakeBox(Sphere->GetComponentTransform(), FVector(Sphere->GetUnscaledSphereRadius())));
+		return;
+	}
+
+	// Each instance of an Instanced Static Mesh gets its own copy of the boxes.
+	if (UInstancedStaticMeshComponent* Instanced = Cast<UInstancedStaticMeshComponent>(Component))
+	{
+		UBodySetup* BodySetup = Instanced->GetStaticMesh() != nullptr ? Instanced->GetStaticMesh()->BodySetup : nullptr;
+		if (BodySetup == nullptr)
+			return;
+
+		for (int32 i = 0; i < Instanced->GetInstanceCount(); i++)
+		{
+			FTransform InstanceTransform;
+			if (Instanced->GetInstanceTransform(i, InstanceTransform, true))
+				AddAggregateBoxes(BodySetup->AggGeom, InstanceTransform, OutBoxes);
+		}
+		return;
+	}
+
+	// Meshes that only collide with their render mesh have no simple shapes, and are left to the Predictor Rings.
+	if (UBodySetup* BodySetup = Component->GetBodySetup())
+		AddAggregateBoxes(BodySetup->AggGeom, Component->GetComponentTransform(), OutBoxes);
+}
+
+void FSimWorldBuilder::AddAggregateBoxes(const FKAggregateGeom& AggGeom, const FTransform& Transform, std::vector<FSimBox>& OutBoxes)
+{
+	for (const FKBoxElem& Box : AggGeom.BoxElems)
+		OutBoxes.push_back(MakeBox(Box.GetTransform() * Transform, FVector(Box.X, Box.Y, Box.Z) * 0.5f));
+
+	for (const FKSphereElem& Sphere : AggGeom.SphereElems)
+		OutBoxes.push_back(MakeBox(Sphere.GetTransform() * Transform, FVector(Sphere.Radius)));
+
+	for (const FKSphylElem& Sphyl : AggGeom.SphylElems)
+		OutBoxes.push_back(MakeBox(Sphyl.GetTransform() * Transform, FVector(Sphyl.Radius, Sphyl.Radius, Sphyl.Radius + Sphyl.Length * 0.5f)));
+
+	// Convex hulls use the box around them.
+	for (const FKConvexElem& Convex : AggGeom.ConvexElems)
+		OutBoxes.push_back(MakeBox(FTransform(Convex.ElemBox.GetCenter()) * Convex.GetTransform() * Transform, Convex.ElemBox.GetExtent()));
+}
+
+void FSimWorldBuilder::AddComponent(UPrimitiveComponent* Component, FSimWorld& OutWorld)
+{
+	if (!IsBlocking(Component))
+		return;
+
+	if (UBoxComponent* Box = Cast<UBoxComponent>(Component))
+	{
+		AddBox(Box->GetComponentTransform(), Box->GetUnscaledBoxExtent(), OutWorld);
+		return;
+	}
+
+	if (USphereComponent* Sphere = Cast<USphereComponent>(Component))
+	{
+		AddBox(Sphere->GetComponentTransform(), FVector(Sphere->GetUnscaledSphereRadius()), OutWorld);
+		return;
+	}
+
+	// Each instance of an Instanced Static Mesh gets its own copy of the colliders.
+	if (UInstancedStaticMeshComponent* Instanced = Cast<UInstancedStaticMeshComponent>(Component))
+	{
+		UBodySetup* BodySetup = Instanced->GetStaticMesh() != nullptr ? Instanced->GetStaticMesh()->BodySetup : nullptr;
+		if (BodySetup == nullptr)
+			return;
+
+		for (int32 i = 0; i < Instanced->GetInstanceCount(); i++)
+		{
+			FTransform InstanceTransform;
+			if (Instanced->GetInstanceTransform(i, InstanceTransform, true))
+				AddAggregateGeom(BodySetup->AggGeom, InstanceTransform, OutWorld);
+		}
+		return;
+	}
+
+	// Meshes that use their render mesh for collision are added triangle by triangle.
+	if (UStaticMeshComponent* StaticMesh = Cast<UStaticMeshComponent>(Component))
+	{
+		UStaticMesh* Mesh = StaticMesh->GetStaticMesh();
+		UBodySetup* BodySetup = Mesh != nullptr ? Mesh->BodySetup : nullptr;
+		if (BodySetup == nullptr)
+			return;
+
+		const bool isComplex = BodySetup->CollisionTraceFlag == CTF_UseComplexAsSimple || BodySetup->AggGeom.GetElementCount() == 0;
+		if (!isComplex || Mesh->RenderData == nullptr || Mesh->RenderData->LODResources.Num() == 0)
+		{
+			AddAggregateGeom(BodySetup->AggGeom, StaticMesh->GetComponentTransform(), OutWorld);
+			return;
+		}
+
+		const FStaticMeshLODResources& LOD = Mesh->RenderData->LODResources[0];
+		const FTransform& Transform = StaticMesh->GetComponentTransform();
+		FIndexArrayView Indices = LOD.IndexBuffer.GetArrayView();
+		for (int32 i = 0; i + 2 < Indices.Num(); i += 3)
+		{
+			FSimTriangle Triangle;
+			Triangle.A = UltraBallSim::ToSim(Transform.TransformPosition(LOD.VertexBuffers.PositionVertexBuffer.VertexPosition(Indices[i])));
+			Triangle.B = UltraBallSim::ToSim(Transform.TransformPosition(LOD.VertexBuffers.PositionVertexBuffer.VertexPosition(Indices[i + 1])));
+			Triangle.C = UltraBallSim::ToSim(Transform.TransformPosition(LOD.VertexBuffers.PositionVertexBuffer.VertexPosition(Indices[i + 2])));
+			OutWorld.Triangles.push_back(Triangle);
+		}
+		return;
+	}
+
+	// Anything else, such as brushes and skeletal meshes, uses its simple collision.
+	if (UBodySetup* BodySetup = Component->GetBodySetup())
+		AddAggregateGeom(BodySetup->AggGeom, Component->GetComponentTransform(), OutWorld);
+}
+
+void FSimWorldBuilder::AddAggregateGeom(const FKAggregateGeom& AggGeom, const FTransform& Transform, FSimWorld& OutWorld)
+{
+	for (const FKBoxElem& Box : AggGeom.BoxElems)
+		AddBox(Box.GetTransform() * Transform, FVector(Box.X, Box.Y, Box.Z) * 0.5f, OutWorld);
+
+	// Spheres and capsules are close enough to the boxes around them for working out the par.
+	for (const FKSphereElem& Sphere : AggGeom.SphereElems)
+		AddBox(Sphere.GetTransform() * Transform, FVector(Sphere.Radius), OutWorld);
+
+	for (const FKSphylElem& Sphyl : AggGeom.SphylElems)
+		AddBox(Sphyl.GetTransform() * Transform, FVector(Sphyl.Radius, Sphyl.Radius, Sphyl.Radius + Sphyl.Length * 0.5f), OutWorld);
+
+	// Convex hulls are added as triangles. Hulls without their index data fall back to their bounding box.
+	for (const FKConvexElem& Convex : AggGeom.ConvexElems)
+	{
+		const FTransform ConvexTransform = Convex.GetTransform() * Transform;
+		if (Convex.IndexData.Num() < 3)
+		{
+			AddBox(FTransform(Convex.ElemBox.GetCenter()) * ConvexTransform, Convex.ElemBox.GetExtent(), OutWorld);
+			continue;
+		}
+
+		for (int32 i = 0; i + 2 < Convex.IndexData.Num(); i += 3)
+		{
+			FSimTriangle Triangle;
+			Triangle.A = UltraBallSim::ToSim(ConvexTransform.TransformPosition(Convex.VertexData[Convex.IndexData[i]]));
+			Triangle.B = UltraBallSim::ToSim(ConvexTransform.TransformPosition(Convex.VertexData[Convex.IndexData[i + 1]]));
+			Triangle.C = UltraBallSim::ToSim(ConvexTransform.TransformPosition(Convex.VertexData[Convex.IndexData[i + 2]]));
+			OutWorld.Triangles.push_back(Triangle);
+		}
+	}
+}
+
+void FSimWorldBuilder::AddBox(const FTransform& Transform, const FVector& HalfExtents, FSimWorld& OutWorld)
+{
+	OutWorld.Boxes.push_back(MakeBox(Transform, HalfExtents));
+}
+
+FSimBox FSimWorldBuilder::MakeBox(const FTransform& Transform, const FVector& HalfExtents)
+{
+	FSimBox Box;
+	Box.Center = UltraBallSim::ToSim(Transform.GetLocation());
+	Box.HalfExtents = UltraBallSim::ToSim(HalfExtents * Transform.GetScale3D().GetAbs());
+	Box.AxisX = UltraBallSim::ToSim(Transform.GetUnitAxis(EAxis::X));
+	Box.AxisY = UltraBallSim::ToSim(Transform.GetUnitAxis(EAxis::Y));
+	Box.AxisZ = UltraBallSim::ToSim(Transform.GetUnitAxis(EAxis::Z));
+	return Box;
+}
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Simulation/UltraBallSim.h"
+
+class UWorld;
+class UPrimitiveComponent;
+struct FKAggregateGeom;
+
+// The parts of a level the offline tools need besides the colliders.
+struct FSimLevelInfo
+{
+	bool hasBall = false;
+	FVector BallLocation = FVector::ZeroVector;
+	int32 MaxParAllowed = 0;
+	float MaxChargePossibleAtFullChargeUp = 1.0f;
+	float GravityZ = -980.0f;
+
+	// Set when the level has something the simulation can't model, such as a Blueprint launcher whose launch data can't be read.
+	// The level would play differently from its simulation, so the tools skip it.
+	bool hasUnsupportedActors = false;
+};
+
+/**
+ * Copies a loaded level into the engine-free simulation.
+ * Everything that blocks UltraBall becomes boxes and triangles. Bumpers, wells and the Finish Target become their simulation types.
+ */
+class GOLF_API FSimWorldBuilder
+{
+public:
+
+	// Fill OutWorld from every level in World. The collision grid is built before returning.
+	static void BuildWorld(UWorld* World, const FSimSettings& Settings, FSimWorld& OutWorld, FSimLevelInfo& OutLevelInfo);
+
+	// Collect the boxes of everything in World that blocks UltraBall, from simple collision only.
+	// This is cheap enough for the running game, and doesn't need render data, which cooked builds don't keep on the CPU.
+	static void GatherBoxes(UWorld* World, std::vector<FSimBox>& OutBoxes);
+
+	// Find every level file under Content/Levels, sorted by name. Used by the commandlets.
+	static void FindLevelFiles(TArray<FString>& OutLevelFiles);
+
+	// Load a level file, fill OutWorld from it and unload it again. Returns false if the level couldn't be loaded.
+	static bool BuildLevel(const FString& LevelFile, const FSimSettings& Settings, FSimWorld& OutWorld, FSimLevelInfo& OutLevelInfo);
+
+private:
+
+	// Add the colliders of a component that blocks UltraBall.
+	static void AddComponent(UPrimitiveComponent* Component, FSimWorld& OutWorld);
+
+	// Returns whether a component blocks UltraBall.
+	static bool IsBlocking(const UPrimitiveComponent* Component);
+
+	// Add the boxes of a component's simple collision.
+	static void AddComponentBoxes(UPrimitiveComponent* Component, std::vector<FSimBox>& OutBoxes);
+	static void AddAggregateBoxes(const FKAggregateGeom& AggGeom, const FTransform& Transform, std::vector<FSimBox>& OutBoxes);
+
+	// Add simple collision shapes with a transform.
+	static void AddAggregateGeom(const FKAggregateGeom& AggGeom, const FTransform& Transform, FSimWorld& OutWorld);
+
+	// Add a box from an engine transform and unscaled half extents.
+	static void AddBox(const FTransform& Transform, const FVector& HalfExtents, FSimWorld& OutWorld);
+	static FSimBox MakeBox(const FTransform& Transform, const FVector& HalfExtents);
+};
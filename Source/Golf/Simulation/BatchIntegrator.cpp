@@ -0,0 +1,315 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "BatchIntegrator.h"
+#include <algorithm>
+
+// The SSE and AVX kernels are only built for x86. Other CPUs use the scalar kernel.
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+	#define SIM_BATCH_X86 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define SIM_BATCH_AVX_TARGET
+	#else
+		#define SIM_BATCH_AVX_TARGET __attribute__((target("avx")))
+	#endif
+#else
+	#define SIM_BATCH_X86 0
+#endif
+
+// Every array is padded to this many lanes, the width of the AVX kernel.
+static const int32_t BatchLaneWidth = 8;
+
+// Added to the swept bounds so rounding in the kernels can never reach a box the bounds left out.
+static const float SweptBoundsMargin = 1.0f;
+
+FSimAabb FSimAabb::FromBox(const FSimBox& Box)
+{
+	const FSimVector Extent(
+		std::fabs(Box.AxisX.X) * Box.HalfExtents.X + std::fabs(Box.AxisY.X) * Box.HalfExtents.Y + std::fabs(Box.AxisZ.X) * Box.HalfExtents.Z,
+		std::fabs(Box.AxisX.Y) * Box.HalfExtents.X + std::fabs(Box.AxisY.Y) * Box.HalfExtents.Y + std::fabs(Box.AxisZ.Y) * Box.HalfExtents.Z,
+		std::fabs(Box.AxisX.Z) * Box.HalfExtents.X + std::fabs(Box.AxisY.Z) * Box.HalfExtents.Y + std::fabs(Box.AxisZ.Z) * Box.HalfExtents.Z);
+	return { Box.Center - Extent, Box.Center + Extent };
+}
+
+void FSimTrajectoryBatch::Reset(int32_t InCount)
+{
+	Count = std::max(0, InCount);
+	PaddedCount = (Count + BatchLaneWidth - 1) / BatchLaneWidth * BatchLaneWidth;
+	X.assign(PaddedCount, 0.0f);
+	Y.assign(PaddedCount, 0.0f);
+	Z.assign(PaddedCount, 0.0f);
+	VX.assign(PaddedCount, 0.0f);
+	VY.assign(PaddedCount, 0.0f);
+	VZ.assign(PaddedCount, 0.0f);
+	Active.assign(PaddedCount, 0.0f);
+	std::fill(Active.begin(), Active.begin() + Count, 1.0f);
+}
+
+void FSimTrajectoryBatch::SetTrajectory(int32_t Index, const FSimVector& Location, const FSimVector& Velocity)
+{
+	X[Index] = Location.X;
+	Y[Index] = Location.Y;
+	Z[Index] = Location.Z;
+	VX[Index] = Velocity.X;
+	VY[Index] = Velocity.Y;
+	VZ[Index] = Velocity.Z;
+	Active[Index] = 1.0f;
+}
+
+FSimBatchIntegrator::EKernel FSimBatchIntegrator::GetBestKernel()
+{
+#if SIM_BATCH_X86
+	#if defined(_MSC_VER)
+		// AVX needs both the CPU and the OS, which has to save the wider registers.
+		int CpuInfo[4];
+		__cpuid(CpuInfo, 1);
+		const bool hasAVX = (CpuInfo[2] & (1 << 28)) != 0 && (CpuInfo[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+	#else
+		const bool hasAVX = __builtin_cpu_supports("avx");
+	#endif
+	return hasAVX ? EKernel::AVX : EKernel::SSE;
+#else
+	return EKernel::Scalar;
+#endif
+}
+
+void FSimBatchIntegrator::Integrate(FSimTrajectoryBatch& Batch, const FSimBatchSettings& Settings, const FSimBox* Boxes, int32_t NumBoxes, EKernel Kernel)
+{
+	GatherNearbyBoxes(Batch, Settings, Boxes, NumBoxes);
+
+	switch (Kernel)
+	{
+	case EKernel::AVX:
+		IntegrateAVX(Batch, Settings);
+		break;
+	case EKernel::SSE:
+		IntegrateSSE(Batch, Settings);
+		break;
+	default:
+		IntegrateScalar(Batch, Settings);
+		break;
+	}
+}
+
+FSimAabb FSimBatchIntegrator::GetSweptBounds(const FSimTrajectoryBatch& Batch, const FSimBatchSettings& Settings)
+{
+	FSimAabb Bounds = { FSimVector(3.4e38f, 3.4e38f, 3.4e38f), FSimVector(-3.4e38f, -3.4e38f, -3.4e38f) };
+	const double DeltaTime = Settings.TimeStep;
+	const double Steps = std::max(Settings.NumSteps, 0);
+	const double GravityStep = (double)Settings.GravityZ * DeltaTime;
+	for (int32_t i = 0; i < Batch.Count; i++)
+	{
+		if (Batch.Active[i] == 0.0f)
+			continue;
+
+		// Across and along, the trajectory moves in a straight line.
+		const double EndX = Batch.X[i] + Batch.VX[i] * Steps * DeltaTime;
+		const double EndY = Batch.Y[i] + Batch.VY[i] * Steps * DeltaTime;
+		Bounds.Min.X = (float)std::min<double>(Bounds.Min.X, std::min<double>(Batch.X[i], EndX));
+		Bounds.Max.X = (float)std::max<double>(Bounds.Max.X, std::max<double>(Batch.X[i], EndX));
+		Bounds.Min.Y = (float)std::min<double>(Bounds.Min.Y, std::min<double>(Batch.Y[i], EndY));
+		Bounds.Max.Y = (float)std::max<double>(Bounds.Max.Y, std::max<double>(Batch.Y[i], EndY));
+
+		// The height after N steps is a parabola in N, so it is bounded by the ends and the top of the arc.
+		const double VZ = Batch.VZ[i];
+		auto GetHeight = [&](double N) { return Batch.Z[i] + DeltaTime * (N * VZ + GravityStep * N * (N + 1.0) * 0.5); };
+		double MinZ = std::min<double>(Batch.Z[i], GetHeight(Steps));
+		double MaxZ = std::max<double>(Batch.Z[i], GetHeight(Steps));
+		if (GravityStep != 0.0)
+		{
+			const double Top = GetHeight(std::min(std::max(-VZ / GravityStep - 0.5, 0.0), Steps));
+			MinZ = std::min(MinZ, Top);
+			MaxZ = std::max(MaxZ, Top);
+		}
+		Bounds.Min.Z = (float)std::min<double>(Bounds.Min.Z, MinZ);
+		Bounds.Max.Z = (float)std::max<double>(Bounds.Max.Z, MaxZ);
+	}
+
+	const float Margin = Settings.BallRadius + SweptBoundsMargin;
+	Bounds.Min -= FSimVector(Margin, Margin, Margin);
+	Bounds.Max += FSimVector(Margin, Margin, Margin);
+	return Bounds;
+}
+
+void FSimBatchIntegrator::GatherNearbyBoxes(FSimTrajectoryBatch& Batch, const FSimBatchSettings& Settings, const FSimBox* Boxes, int32_t NumBoxes)
+{
+	Batch.NearbyBoxes.clear();
+	const FSimAabb Bounds = GetSweptBounds(Batch, Settings);
+	for (int32_t b = 0; b < NumBoxes; b++)
+	{
+		if (!Bounds.Overlaps(FSimAabb::FromBox(Boxes[b])))
+			continue;
+
+		FSimBox Box = Boxes[b];
+		Box.HalfExtents += FSimVector(Settings.BallRadius, Settings.BallRadius, Settings.BallRadius);
+		Batch.NearbyBoxes.push_back(Box);
+	}
+}
+
+void FSimBatchIntegrator::IntegrateScalar(FSimTrajectoryBatch& Batch, const FSimBatchSettings& Settings)
+{
+	const float DeltaTime = Settings.TimeStep;
+	const float GravityStep = Settings.GravityZ * DeltaTime;
+	const float GroundZ = Settings.hasGroundPlane ? Settings.GroundZ + Settings.BallRadius : -3.4e38f;
+	const FSimBox* Boxes = Batch.NearbyBoxes.data();
+	const int32_t NumBoxes = (int32_t)Batch.NearbyBoxes.size();
+
+	for (int32_t i = 0; i < Batch.Count; i++)
+	{
+		if (Batch.Active[i] == 0.0f)
+			continue;
+
+		float X = Batch.X[i], Y = Batch.Y[i], Z = Batch.Z[i];
+		float VX = Batch.VX[i], VY = Batch.VY[i], VZ = Batch.VZ[i];
+		bool isLanded = false;
+		for (int32_t Step = 0; Step < Settings.NumSteps && !isLanded; Step++)
+		{
+			VZ += GravityStep;
+			X += VX * DeltaTime;
+			Y += VY * DeltaTime;
+			Z += VZ * DeltaTime;
+
+			// Inside a box when the offset from its center is within its extents along each of its axes.
+			isLanded = Z < GroundZ;
+			for (int32_t b = 0; b < NumBoxes && !isLanded; b++)
+			{
+				const FSimBox& Box = Boxes[b];
+				const float DX = X - Box.Center.X, DY = Y - Box.Center.Y, DZ = Z - Box.Center.Z;
+				isLanded = std::fabs(DX * Box.AxisX.X + DY * Box.AxisX.Y + DZ * Box.AxisX.Z) < Box.HalfExtents.X
+					&& std::fabs(DX * Box.AxisY.X + DY * Box.AxisY.Y + DZ * Box.AxisY.Z) < Box.HalfExtents.Y
+					&& std::fabs(DX * Box.AxisZ.X + DY * Box.AxisZ.Y + DZ * Box.AxisZ.Z) < Box.HalfExtents.Z;
+			}
+		}
+
+		Batch.X[i] = X; Batch.Y[i] = Y; Batch.Z[i] = Z;
+		Batch.VX[i] = VX; Batch.VY[i] = VY; Batch.VZ[i] = VZ;
+		Batch.Active[i] = isLanded ? 0.0f : 1.0f;
+	}
+}
+
+#if SIM_BATCH_X86
+
+// Returns all ones in the lanes where the offset lies within the extent along the axis.
+static inline __m128 IsWithinExtentSSE(__m128 DX, __m128 DY, __m128 DZ, const FSimVector& Axis, float Extent)
+{
+	const __m128 Along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(DX, _mm_set1_ps(Axis.X)), _mm_mul_ps(DY, _mm_set1_ps(Axis.Y))), _mm_mul_ps(DZ, _mm_set1_ps(Axis.Z)));
+	return _mm_cmplt_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), Along), _mm_set1_ps(Extent));
+}
+
+void FSimBatchIntegrator::IntegrateSSE(FSimTrajectoryBatch& Batch, const FSimBatchSettings& Settings)
+{
+	const __m128 DeltaTime = _mm_set1_ps(Settings.TimeStep);
+	const __m128 GravityStep = _mm_set1_ps(Settings.GravityZ * Settings.TimeStep);
+	const __m128 GroundZ = _mm_set1_ps(Settings.hasGroundPlane ? Settings.GroundZ + Settings.BallRadius : -3.4e38f);
+	const __m128 Zero = _mm_setzero_ps();
+	const FSimBox* Boxes = Batch.NearbyBoxes.data();
+	const int32_t NumBoxes = (int32_t)Batch.NearbyBoxes.size();
+
+	// Each group of four trajectories is stepped to the end before moving on, so it stays in registers.
+	for (int32_t i = 0; i < Batch.PaddedCount; i += 4)
+	{
+		__m128 Active = _mm_cmpgt_ps(_mm_loadu_ps(&Batch.Active[i]), Zero);
+		if (_mm_movemask_ps(Active) == 0)
+			continue;
+
+		__m128 X = _mm_loadu_ps(&Batch.X[i]), Y = _mm_loadu_ps(&Batch.Y[i]), Z = _mm_loadu_ps(&Batch.Z[i]);
+		__m128 VX = _mm_loadu_ps(&Batch.VX[i]), VY = _mm_loadu_ps(&Batch.VY[i]), VZ = _mm_loadu_ps(&Batch.VZ[i]);
+		for (int32_t Step = 0; Step < Settings.NumSteps; Step++)
+		{
+			// Landed lanes keep their landing point.
+			VZ = _mm_add_ps(VZ, _mm_and_ps(GravityStep, Active));
+			X = _mm_add_ps(X, _mm_and_ps(_mm_mul_ps(VX, DeltaTime), Active));
+			Y = _mm_add_ps(Y, _mm_and_ps(_mm_mul_ps(VY, DeltaTime), Active));
+			Z = _mm_add_ps(Z, _mm_and_ps(_mm_mul_ps(VZ, DeltaTime), Active));
+
+			__m128 Hit = _mm_cmplt_ps(Z, GroundZ);
+			for (int32_t b = 0; b < NumBoxes; b++)
+			{
+				const FSimBox& Box = Boxes[b];
+				const __m128 DX = _mm_sub_ps(X, _mm_set1_ps(Box.Center.X));
+				const __m128 DY = _mm_sub_ps(Y, _mm_set1_ps(Box.Center.Y));
+				const __m128 DZ = _mm_sub_ps(Z, _mm_set1_ps(Box.Center.Z));
+				__m128 Inside = IsWithinExtentSSE(DX, DY, DZ, Box.AxisX, Box.HalfExtents.X);
+				Inside = _mm_and_ps(Inside, IsWithinExtentSSE(DX, DY, DZ, Box.AxisY, Box.HalfExtents.Y));
+				Inside = _mm_and_ps(Inside, IsWithinExtentSSE(DX, DY, DZ, Box.AxisZ, Box.HalfExtents.Z));
+				Hit = _mm_or_ps(Hit, Inside);
+			}
+			Active = _mm_andnot_ps(Hit, Active);
+			if (_mm_movemask_ps(Active) == 0)
+				break;
+		}
+
+		_mm_storeu_ps(&Batch.X[i], X); _mm_storeu_ps(&Batch.Y[i], Y); _mm_storeu_ps(&Batch.Z[i], Z);
+		_mm_storeu_ps(&Batch.VX[i], VX); _mm_storeu_ps(&Batch.VY[i], VY); _mm_storeu_ps(&Batch.VZ[i], VZ);
+		_mm_storeu_ps(&Batch.Active[i], _mm_and_ps(Active, _mm_set1_ps(1.0f)));
+	}
+}
+
+SIM_BATCH_AVX_TARGET static inline __m256 IsWithinExtentAVX(__m256 DX, __m256 DY, __m256 DZ, const FSimVector& Axis, float Extent)
+{
+	const __m256 Along = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(DX, _mm256_set1_ps(Axis.X)), _mm256_mul_ps(DY, _mm256_set1_ps(Axis.Y))), _mm256_mul_ps(DZ, _mm256_set1_ps(Axis.Z)));
+	return _mm256_cmp_ps(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), Along), _mm256_set1_ps(Extent), _CMP_LT_OQ);
+}
+
+SIM_BATCH_AVX_TARGET void FSimBatchIntegrator::IntegrateAVX(FSimTrajectoryBatch& Batch, const FSimBatchSettings& Settings)
+{
+	const __m256 DeltaTime = _mm256_set1_ps(Settings.TimeStep);
+	const __m256 GravityStep = _mm256_set1_ps(Settings.GravityZ * Settings.TimeStep);
+	const __m256 GroundZ = _mm256_set1_ps(Settings.hasGroundPlane ? Settings.GroundZ + Settings.BallRadius : -3.4e38f);
+	const __m256 Zero = _mm256_setzero_ps();
+	const FSimBox* Boxes = Batch.NearbyBoxes.data();
+	const int32_t NumBoxes = (int32_t)Batch.NearbyBoxes.size();
+
+	// The same as the SSE kernel, eight trajectories at a time.
+	for (int32_t i = 0; i < Batch.PaddedCount; i += 8)
+	{
+		__m256 Active = _mm256_cmp_ps(_mm256_loadu_ps(&Batch.Active[i]), Zero, _CMP_GT_OQ);
+		if (_mm256_movemask_ps(Active) == 0)
+			continue;
+
+		__m256 X = _mm256_loadu_ps(&Batch.X[i]), Y = _mm256_loadu_ps(&Batch.Y[i]), Z = _mm256_loadu_ps(&Batch.Z[i]);
+		__m256 VX = _mm256_loadu_ps(&Batch.VX[i]), VY = _mm256_loadu_ps(&Batch.VY[i]), VZ = _mm256_loadu_ps(&Batch.VZ[i]);
+		for (int32_t Step = 0; Step < Settings.NumSteps; Step++)
+		{
+			VZ = _mm256_add_ps(VZ, _mm256_and_ps(GravityStep, Active));
+			X = _mm256_add_ps(X, _mm256_and_ps(_mm256_mul_ps(VX, DeltaTime), Active));
+			Y = _mm256_add_ps(Y, _mm256_and_ps(_mm256_mul_ps(VY, DeltaTime), Active));
+			Z = _mm256_add_ps(Z, _mm256_and_ps(_mm256_mul_ps(VZ, DeltaTime), Active));
+
+			__m256 Hit = _mm256_cmp_ps(Z, GroundZ, _CMP_LT_OQ);
+			for (int32_t b = 0; b < NumBoxes; b++)
+			{
+				const FSimBox& Box = Boxes[b];
+				const __m256 DX = _mm256_sub_ps(X, _mm256_set1_ps(Box.Center.X));
+				const __m256 DY = _mm256_sub_ps(Y, _mm256_set1_ps(Box.Center.Y));
+				const __m256 DZ = _mm256_sub_ps(Z, _mm256_set1_ps(Box.Center.Z));
+				__m256 Inside = IsWithinExtentAVX(DX, DY, DZ, Box.AxisX, Box.HalfExtents.X);
+				Inside = _mm256_and_ps(Inside, IsWithinExtentAVX(DX, DY, DZ, Box.AxisY, Box.HalfExtents.Y));
+				Inside = _mm256_and_ps(Inside, IsWithinExtentAVX(DX, DY, DZ, Box.AxisZ, Box.HalfExtents.Z));
+				Hit = _mm256_or_ps(Hit, Inside);
+			}
+			Active = _mm256_andnot_ps(Hit, Active);
+			if (_mm256_movemask_ps(Active) == 0)
+				break;
+		}
+
+		_mm256_storeu_ps(&Batch.X[i], X); _mm256_storeu_ps(&Batch.Y[i], Y); _mm256_storeu_ps(&Batch.Z[i], Z);
+		_mm256_storeu_ps(&Batch.VX[i], VX); _mm256_storeu_ps(&Batch.VY[i], VY); _mm256_storeu_ps(&Batch.VZ[i], VZ);
+		_mm256_storeu_ps(&Batch.Active[i], _mm256_and_ps(Active, _mm256_set1_ps(1.0f)));
+	}
+}
+
+#else
+
+void FSimBatchIntegrator::IntegrateSSE(FSimTrajectoryBatch& Batch, const FSimBatchSettings& Settings)
+{
+	IntegrateScalar(Batch, Settings);
+}
+
+void FSimBatchIntegrator::IntegrateAVX(FSimTrajectoryBatch& Batch, const FSimBatchSettings& Settings)
+{
+	IntegrateScalar(Batch, Settings);
+}
+
+#endif
@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// This file must not include any engine headers. It is shared by the game and by tools that run without the editor.
+#include "UltraBallSim.h"
+
+// An axis aligned box for the batch integrator.
+struct FSimAabb
+{
+	FSimVector Min;
+	FSimVector Max;
+
+	// Returns the axis aligned box around a rotated box.
+	static FSimAabb FromBox(const FSimBox& Box);
+
+	bool Overlaps(const FSimAabb& Other) const
+	{
+		return Min.X <= Other.Max.X && Max.X >= Other.Min.X && Min.Y <= Other.Max.Y && Max.Y >= Other.Min.Y && Min.Z <= Other.Max.Z && Max.Z >= Other.Min.Z;
+	}
+};
+
+/**
+ * Many trajectories stored as structure of arrays, so the integrator can step several of them with each instruction.
+ * The arrays are padded to a multiple of the widest kernel. Padding lanes start landed and are never moved.
+ */
+struct FSimTrajectoryBatch
+{
+	// Set the number of trajectories. Every trajectory starts at the origin, not moving and not landed.
+	void Reset(int32_t InCount);
+
+	// Set the starting point and velocity of one trajectory.
+	void SetTrajectory(int32_t Index, const FSimVector& Location, const FSimVector& Velocity);
+
+	FSimVector GetLocation(int32_t Index) const { return FSimVector(X[Index], Y[Index], Z[Index]); }
+	bool HasLanded(int32_t Index) const { return Active[Index] == 0.0f; }
+
+	int32_t Count = 0;
+	int32_t PaddedCount = 0;
+	std::vector<float> X, Y, Z;
+	std::vector<float> VX, VY, VZ;
+
+	// 1 while the trajectory is in the air, 0 once it has landed.
+	std::vector<float> Active;
+
+	// The boxes the trajectories could reach, grown by the ball radius. Kept here so the memory is reused between batches.
+	std::vector<FSimBox> NearbyBoxes;
+};
+
+// How the batch is integrated.
+struct FSimBatchSettings
+{
+	float GravityZ = -980.0f;
+	float TimeStep = 1.0f / 30.0f;
+	int32_t NumSteps = 60;
+	float BallRadius = 30.0f;
+
+	// Trajectories land when UltraBall touches this height. Set hasGroundPlane to false to only land on boxes.
+	bool hasGroundPlane = true;
+	float GroundZ = 0.0f;
+};
+
+/**
+ * Steps a batch of trajectories under gravity until each one lands on the ground plane or a box.
+ * A landed trajectory stays where it first touched, so the batch ends up holding the landing points.
+ */
+class FSimBatchIntegrator
+{
+public:
+
+	enum class EKernel : uint8_t
+	{
+		Scalar,
+		SSE,
+		AVX
+	};
+
+	// Returns the widest kernel this CPU can run.
+	static EKernel GetBestKernel();
+
+	// Integrate every trajectory in the batch. Boxes are grown by the ball radius, so corners are treated as square.
+	// Only the boxes inside the bounds swept by the batch are tested, so most of a level's boxes cost nothing.
+	static void Integrate(FSimTrajectoryBatch& Batch, const FSimBatchSettings& Settings, const FSimBox* Boxes, int32_t NumBoxes, EKernel Kernel);
+	static void Integrate(FSimTrajectoryBatch& Batch, const FSimBatchSettings& Settings, const FSimBox* Boxes, int32_t NumBoxes) { Integrate(Batch, Settings, Boxes, NumBoxes, GetBestKernel()); }
+
+	// Returns the bounds of every path the trajectories still in the air could take, grown by the ball radius.
+	static FSimAabb GetSweptBounds(const FSimTrajectoryBatch& Batch, const FSimBatchSettings& Settings);
+
+	// Fill the batch's Nearby Boxes with the boxes inside its swept bounds, grown by the ball radius.
+	static void GatherNearbyBoxes(FSimTrajectoryBatch& Batch, const FSimBatchSettings& Settings, const FSimBox* Boxes, int32_t NumBoxes);
+
+private:
+
+	// The kernels test the batch's Nearby Boxes, which have already been grown by the ball radius.
+	static void IntegrateScalar(FSimTrajectoryBatch& Batch, const FSimBatchSettings& Settings);
+	static void IntegrateSSE(FSimTrajectoryBatch& Batch, const FSimBatchSettings& Settings);
+	static void IntegrateAVX(FSimTrajectoryBatch& Batch, const FSimBatchSettings& Settings);
+};
@@ -0,0 +1,232 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DistanceField.h"
+#include <algorithm>
+#include <cstdio>
+
+static_assert(sizeof(FDistanceFieldHeader) % 64 == 0, "The header must end on a cache line.");
+
+// Returns the distance from a point to the nearest of these colliders.
+static float GetNearestDistance(const FSimWorld& World, const FSimVector& Point, const std::vector<int32_t>& Colliders, float Band)
+{
+	const int32_t NumBoxes = (int32_t)World.Boxes.size();
+	float Distance = Band;
+	for (int32_t Collider : Colliders)
+	{
+		if (Collider < NumBoxes)
+			Distance = std::min(Distance, FUltraBallSim::GetBoxDistance(Point, World.Boxes[Collider]));
+		else
+			Distance = std::min(Distance, (Point - FUltraBallSim::GetClosestPointOnTriangle(Point, World.Triangles[Collider - NumBoxes])).Size());
+	}
+	return Distance;
+}
+
+bool FSimDistanceField::Bake(const std::string& Path, const FSimWorld& World, float VoxelSize, float Band, FSimThreadPool& ThreadPool)
+{
+	using namespace DistanceField;
+	if (VoxelSize <= 0.0f || Band <= 0.0f)
+		return false;
+
+	// Find the bounds of every collider, grown by the band.
+	FSimVector Min(3.4e38f, 3.4e38f, 3.4e38f);
+	FSimVector Max(-3.4e38f, -3.4e38f, -3.4e38f);
+	auto AddPoint = [&](const FSimVector& Point)
+	{
+		Min = FSimVector(std::min(Min.X, Point.X), std::min(Min.Y, Point.Y), std::min(Min.Z, Point.Z));
+		Max = FSimVector(std::max(Max.X, Point.X), std::max(Max.Y, Point.Y), std::max(Max.Z, Point.Z));
+	};
+	for (const FSimBox& Box : World.Boxes)
+	{
+		const FSimVector Extent(
+			std::fabs(Box.AxisX.X) * Box.HalfExtents.X + std::fabs(Box.AxisY.X) * Box.HalfExtents.Y + std::fabs(Box.AxisZ.X) * Box.HalfExtents.Z,
+			std::fabs(Box.AxisX.Y) * Box.HalfExtents.X + std::fabs(Box.AxisY.Y) * Box.HalfExtents.Y + std::fabs(Box.AxisZ.Y) * Box.HalfExtents.Z,
+			std::fabs(Box.AxisX.Z) * Box.HalfExtents.X + std::fabs(Box.AxisY.Z) * Box.HalfExtents.Y + std::fabs(Box.AxisZ.Z) * Box.HalfExtents.Z);
+		AddPoint(Box.Center - Extent);
+		AddPoint(Box.Center + Extent);
+	}
+	for (const FSimTriangle& Triangle : World.Triangles)
+	{
+		AddPoint(Triangle.A);
+		AddPoint(Triangle.B);
+		AddPoint(Triangle.C);
+	}
+	if (Min.X > Max.X)
+		return false;
+
+	const float BrickSize = VoxelSize * BrickVoxels;
+	FDistanceFieldHeader Header = {};
+	Header.Magic = DistanceField::Magic;
+	Header.Version = DistanceField::Version;
+	Header.Origin = Min - FSimVector(Band, Band, Band);
+	Header.VoxelSize = VoxelSize;
+	Header.Band = Band;
+	Header.BrickCountX = (int32_t)std::ceil((Max.X - Min.X + Band * 2.0f) / BrickSize) + 1;
+	Header.BrickCountY = (int32_t)std::ceil((Max.Y - Min.Y + Band * 2.0f) / BrickSize) + 1;
+	Header.BrickCountZ = (int32_t)std::ceil((Max.Z - Min.Z + Band * 2.0f) / BrickSize) + 1;
+	const int32_t NumCells = Header.BrickCountX * Header.BrickCountY * Header.BrickCountZ;
+
+	// Bake every brick cell that has a collider within the band. Bricks where every corner ends up out of the band are dropped.
+	const float EncodeScale = 255.0f / (Band * 2.0f);
+	const float CellReach = BrickSize * 0.8660254f + Band;
+	std::vector<uint8_t> CellData((size_t)NumCells * BrickStride);
+	std::vector<uint8_t> isCellUsed(NumCells, 0);
+	ThreadPool.ParallelFor(NumCells, [&](int32_t Cell)
+	{
+		const int32_t X = Cell % Header.BrickCountX;
+		const int32_t Y = (Cell / Header.BrickCountX) % Header.BrickCountY;
+		const int32_t Z = Cell / (Header.BrickCountX * Header.BrickCountY);
+		const FSimVector Corner = Header.Origin + FSimVector((float)X, (float)Y, (float)Z) * BrickSize;
+
+		std::vector<int32_t> Colliders;
+		World.FindColliders(Corner + FSimVector(BrickSize, BrickSize, BrickSize) * 0.5f, CellReach, Colliders);
+		if (Colliders.empty())
+			return;
+
+		uint8_t* Brick = &CellData[(size_t)Cell * BrickStride];
+		bool isInBand = false;
+		for (int32_t k = 0; k < BrickCorners; k++)
+			for (int32_t j = 0; j < BrickCorners; j++)
+				for (int32_t i = 0; i < BrickCorners; i++)
+				{
+					const float Distance = GetNearestDistance(World, Corner + FSimVector((float)i, (float)j, (float)k) * VoxelSize, Colliders, Band);
+					isInBand |= Distance < Band;
+					const float Encoded = (std::min(std::max(Distance, -Band), Band) + Band) * EncodeScale;
+					Brick[i + BrickCorners * (j + BrickCorners * k)] = (uint8_t)std::lround(Encoded);
+				}
+		isCellUsed[Cell] = isInBand ? 1 : 0;
+	});
+
+	// Pack the used bricks together and build the index.
+	std::vector<int32_t> Index(NumCells, -1);
+	std::vector<uint8_t> Bricks;
+	for (int32_t Cell = 0; Cell < NumCells; Cell++)
+	{
+		if (!isCellUsed[Cell])
+			continue;
+		Index[Cell] = Header.NumBricks++;
+		Bricks.insert(Bricks.end(), CellData.begin() + (size_t)Cell * BrickStride, CellData.begin() + (size_t)(Cell + 1) * BrickStride);
+	}
+
+	Header.IndexOffset = sizeof(FDistanceFieldHeader);
+	Header.BrickOffset = (Header.IndexOffset + Index.size() * sizeof(int32_t) + 63) / 64 * 64;
+	Header.FileSize = Header.BrickOffset + Bricks.size();
+
+	FILE* OutFile = std::fopen(Path.c_str(), "wb");
+	if (OutFile == nullptr)
+		return false;
+
+	static const uint8_t Zeros[64] = {};
+	const size_t IndexBytes = Index.size() * sizeof(int32_t);
+	const size_t PaddingBytes = (size_t)(Header.BrickOffset - Header.IndexOffset - IndexBytes);
+	bool isWritten = std::fwrite(&Header, sizeof(Header), 1, OutFile) == 1;
+	isWritten = isWritten && std::fwrite(Index.data(), 1, IndexBytes, OutFile) == IndexBytes;
+	isWritten = isWritten && std::fwrite(Zeros, 1, PaddingBytes, OutFile) == PaddingBytes;
+	isWritten = isWritten && (Bricks.empty() || std::fwrite(Bricks.data(), 1, Bricks.size(), OutFile) == Bricks.size());
+	return std::fclose(OutFile) == 0 && isWritten;
+}
+
+bool FSimDistanceField::Open(const std::string& Path)
+{
+	Close();
+	if (!File.Open(Path) || File.GetSize() < sizeof(FDistanceFieldHeader))
+	{
+		Close();
+		return false;
+	}
+
+	// Check the header and that the index and bricks fit inside the file.
+	const uint64_t Size = File.GetSize();
+	const FDistanceFieldHeader* MappedHeader = reinterpret_cast<const FDistanceFieldHeader*>(File.GetData());
+	const uint64_t NumCells = (uint64_t)MappedHeader->BrickCountX * MappedHeader->BrickCountY * MappedHeader->BrickCountZ;
+	const bool isValid = MappedHeader->Magic == DistanceField::Magic && MappedHeader->Version == DistanceField::Version
+		&& MappedHeader->FileSize <= Size && MappedHeader->VoxelSize > 0.0f && MappedHeader->Band > 0.0f
+		&& MappedHeader->BrickCountX > 0 && MappedHeader->BrickCountY > 0 && MappedHeader->BrickCountZ > 0 && MappedHeader->NumBricks >= 0
+		&& MappedHeader->IndexOffset + NumCells * sizeof(int32_t) <= MappedHeader->BrickOffset
+		&& MappedHeader->BrickOffset % 64 == 0
+		&& MappedHeader->BrickOffset + (uint64_t)MappedHeader->NumBricks * DistanceField::BrickStride <= Size;
+	if (!isValid)
+	{
+		Close();
+		return false;
+	}
+
+	Header = MappedHeader;
+	BrickIndex = reinterpret_cast<const int32_t*>(File.GetData() + Header->IndexOffset);
+	Bricks = File.GetData() + Header->BrickOffset;
+	DecodeScale = Header->Band * 2.0f / 255.0f;
+	return true;
+}
+
+void FSimDistanceField::Close()
+{
+	File.Close();
+	Header = nullptr;
+	BrickIndex = nullptr;
+	Bricks = nullptr;
+}
+
+const uint8_t* FSimDistanceField::FindBrick(const FSimVector& Location, int32_t& OutX, int32_t& OutY, int32_t& OutZ, FSimVector& OutFraction) const
+{
+	using namespace DistanceField;
+
+	// Work in voxels from the corner of the first brick.
+	const FSimVector Local = (Location - Header->Origin) / Header->VoxelSize;
+	if (Local.X < 0.0f || Local.Y < 0.0f || Local.Z < 0.0f)
+		return nullptr;
+
+	const int32_t CellX = (int32_t)Local.X / BrickVoxels;
+	const int32_t CellY = (int32_t)Local.Y / BrickVoxels;
+	const int32_t CellZ = (int32_t)Local.Z / BrickVoxels;
+	if (CellX >= Header->BrickCountX || CellY >= Header->BrickCountY || CellZ >= Header->BrickCountZ)
+		return nullptr;
+
+	const int32_t Brick = BrickIndex[CellX + Header->BrickCountX * (CellY + Header->BrickCountY * CellZ)];
+	if (Brick < 0)
+		return nullptr;
+
+	const FSimVector InBrick = Local - FSimVector((float)(CellX * BrickVoxels), (float)(CellY * BrickVoxels), (float)(CellZ * BrickVoxels));
+	OutX = std::min((int32_t)InBrick.X, BrickVoxels - 1);
+	OutY = std::min((int32_t)InBrick.Y, BrickVoxels - 1);
+	OutZ = std::min((int32_t)InBrick.Z, BrickVoxels - 1);
+	OutFraction = InBrick - FSimVector((float)OutX, (float)OutY, (float)OutZ);
+	return Bricks + (size_t)Brick * BrickStride;
+}
+
+float FSimDistanceField::GetDistance(const FSimVector& Location) const
+{
+	FSimVector Normal;
+	return GetDistanceAndNormal(Location, Normal);
+}
+
+float FSimDistanceField::GetDistanceAndNormal(const FSimVector& Location, FSimVector& OutNormal) const
+{
+	using namespace DistanceField;
+
+	int32_t X, Y, Z;
+	FSimVector T;
+	const uint8_t* Brick = FindBrick(Location, X, Y, Z, T);
+	if (Brick == nullptr)
+	{
+		OutNormal = FSimVector();
+		return Header->Band;
+	}
+
+	// Blend the eight corners of the voxel. The normal is the slope of the same blend.
+	const uint8_t* Base = Brick + X + BrickCorners * (Y + BrickCorners * Z);
+	const int32_t StepY = BrickCorners;
+	const int32_t StepZ = BrickCorners * BrickCorners;
+	const float C000 = Decode(Base[0]), C100 = Decode(Base[1]);
+	const float C010 = Decode(Base[StepY]), C110 = Decode(Base[StepY + 1]);
+	const float C001 = Decode(Base[StepZ]), C101 = Decode(Base[StepZ + 1]);
+	const float C011 = Decode(Base[StepZ + StepY]), C111 = Decode(Base[StepZ + StepY + 1]);
+
+	const float C00 = C000 + (C100 - C000) * T.X, C10 = C010 + (C110 - C010) * T.X;
+	const float C01 = C001 + (C101 - C001) * T.X, C11 = C011 + (C111 - C011) * T.X;
+	const float C0 = C00 + (C10 - C00) * T.Y, C1 = C01 + (C11 - C01) * T.Y;
+
+	const float DX = ((C100 - C000) * (1.0f - T.Y) + (C110 - C010) * T.Y) * (1.0f - T.Z) + ((C101 - C001) * (1.0f - T.Y) + (C111 - C011) * T.Y) * T.Z;
+	const float DY = (C10 - C00) * (1.0f - T.Z) + (C11 - C01) * T.Z;
+	const float DZ = C1 - C0;
+	OutNormal = FSimVector(DX, DY, DZ).GetSafeNormal();
+	return C0 + (C1 - C0) * T.Z;
+}
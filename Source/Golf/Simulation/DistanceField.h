@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// This file must not include any engine headers. It is shared by the game and by tools that run without the editor.
+#include "UltraBallSim.h"
+#include "MappedFile.h"
+#include "SimThreadPool.h"
+
+/**
+ * Distance Field file layout. Everything is little endian.
+ *
+ * The level is split into bricks of BrickVoxels voxels along each side. Only bricks near a collider are stored.
+ * A dense index gives the brick for every brick cell, or -1 if the cell is empty and everything in it is further than Band away.
+ * Each brick holds the distance at every voxel corner quantised to a byte, so a query never leaves its brick.
+ */
+namespace DistanceField
+{
+	// "UBSD"
+	static const uint32_t Magic = 0x44534255;
+
+	// Bump this whenever the layout of the file changes.
+	static const uint32_t Version = 1;
+
+	static const int32_t BrickVoxels = 8;
+	static const int32_t BrickCorners = BrickVoxels + 1;
+
+	// Each brick is padded out to a whole number of cache lines.
+	static const uint64_t BrickStride = (BrickCorners * BrickCorners * BrickCorners + 63) / 64 * 64;
+}
+
+struct FDistanceFieldHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint64_t FileSize;
+
+	// The corner of the first brick, the size of a voxel, and how far from a collider distances are stored.
+	FSimVector Origin;
+	float VoxelSize;
+	float Band;
+
+	// How many brick cells there are along each side.
+	int32_t BrickCountX, BrickCountY, BrickCountZ;
+	int32_t NumBricks;
+	uint32_t Padding;
+
+	uint64_t IndexOffset;
+	uint64_t BrickOffset;
+
+	// Zero. Pads the header out to a whole number of cache lines and leaves room for later versions.
+	uint32_t Reserved[14];
+};
+
+/**
+ * A memory mapped, sparse Distance Field of a level's colliders.
+ * A query reads one index entry and eight bytes from one brick, with no tree to walk.
+ */
+class FSimDistanceField
+{
+public:
+
+	// Bake the Distance Field of a built world and write it to a file. Bricks are baked across the thread pool.
+	static bool Bake(const std::string& Path, const FSimWorld& World, float VoxelSize, float Band, FSimThreadPool& ThreadPool);
+
+	// Map a Distance Field file. Returns false if it can't be opened or isn't a Distance Field of this version.
+	bool Open(const std::string& Path);
+	void Close();
+	bool IsOpen() const { return Header != nullptr; }
+
+	// Returns the distance to the nearest collider. Anything further than the band returns the band.
+	float GetDistance(const FSimVector& Location) const;
+
+	// Returns the distance to the nearest collider and the direction away from it. The normal is zero outside the band.
+	float GetDistanceAndNormal(const FSimVector& Location, FSimVector& OutNormal) const;
+
+	float GetBand() const { return Header->Band; }
+	float GetVoxelSize() const { return Header->VoxelSize; }
+
+private:
+
+	// Find the brick and the position within it. Returns null if the location is in an empty brick cell.
+	const uint8_t* FindBrick(const FSimVector& Location, int32_t& OutX, int32_t& OutY, int32_t& OutZ, FSimVector& OutFraction) const;
+
+	// Turn a stored byte back into a distance.
+	float Decode(uint8_t Value) const { return Value * DecodeScale - Header->Band; }
+
+	FSimMappedFile File;
+	const FDistanceFieldHeader* Header = nullptr;
+	const int32_t* BrickIndex = nullptr;
+	const uint8_t* Bricks = nullptr;
+	float DecodeScale = 0.0f;
+};
@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LevelSnapshot.h"
+#include <cstdio>
+#include <type_traits>
+
+// The records are written exactly as they are laid out in memory, so their layout must never change without a version bump.
+static_assert(std::is_trivially_copyable<FSimBox>::value && sizeof(FSimBox) == 60, "FSimBox layout changed. Update LevelSnapshot::Version.");
+static_assert(std::is_trivially_copyable<FSimTriangle>::value && sizeof(FSimTriangle) == 36, "FSimTriangle layout changed. Update LevelSnapshot::Version.");
+static_assert(std::is_trivially_copyable<FSimBumper>::value && sizeof(FSimBumper) == 76, "FSimBumper layout changed. Update LevelSnapshot::Version.");
+static_assert(std::is_trivially_copyable<FSimField>::value && sizeof(FSimField) == 48, "FSimField layout changed. Update LevelSnapshot::Version.");
+static_assert(std::is_trivially_copyable<FSimFinish>::value && sizeof(FSimFinish) == 16, "FSimFinish layout changed. Update LevelSnapshot::Version.");
+static_assert(std::is_trivially_copyable<FSimGridCell>::value && sizeof(FSimGridCell) == 20, "FSimGridCell layout changed. Update LevelSnapshot::Version.");
+static_assert(sizeof(FLevelSnapshotHeader) % LevelSnapshot::SectionAlignment == 0, "The header must end on a section boundary.");
+
+static uint64_t AlignSection(uint64_t Offset)
+{
+	return (Offset + LevelSnapshot::SectionAlignment - 1) & ~(LevelSnapshot::SectionAlignment - 1);
+}
+
+bool FLevelSnapshot::Write(const std::string& Path, const FSimWorld& World, const FLevelSnapshotInfo& Info)
+{
+	const FSimGridView Grid = World.GetGrid();
+	const void* SectionData[LevelSnapshot::NumSections] = { World.Boxes.data(), World.Triangles.data(), World.Bumpers.data(), World.Fields.data(), World.Finishes.data(), Grid.Cells, Grid.Colliders };
+	const uint64_t SectionCounts[LevelSnapshot::NumSections] = { World.Boxes.size(), World.Triangles.size(), World.Bumpers.size(), World.Fields.size(), World.Finishes.size(), Grid.NumCells, World.GetNumCellColliders() };
+	const uint64_t RecordSizes[LevelSnapshot::NumSections] = { sizeof(FSimBox), sizeof(FSimTriangle), sizeof(FSimBumper), sizeof(FSimField), sizeof(FSimFinish), sizeof(FSimGridCell), sizeof(int32_t) };
+
+	FLevelSnapshotHeader Header = {};
+	Header.Magic = LevelSnapshot::Magic;
+	Header.Version = LevelSnapshot::Version;
+	Header.BallLocation = Info.BallLocation;
+	Header.MaxParAllowed = Info.MaxParAllowed;
+	Header.MaxChargePossibleAtFullChargeUp = Info.MaxChargePossibleAtFullChargeUp;
+	Header.GravityZ = Info.GravityZ;
+	Header.GridCellSize = Grid.CellSize;
+
+	// Lay out the sections one after another, each on its own boundary.
+	uint64_t Offset = sizeof(FLevelSnapshotHeader);
+	for (uint32_t i = 0; i < LevelSnapshot::NumSections; i++)
+	{
+		Offset = AlignSection(Offset);
+		Header.Sections[i].Offset = Offset;
+		Header.Sections[i].Count = SectionCounts[i];
+		Offset += SectionCounts[i] * RecordSizes[i];
+	}
+	Header.FileSize = AlignSection(Offset);
+
+	FILE* File = std::fopen(Path.c_str(), "wb");
+	if (File == nullptr)
+		return false;
+
+	bool isWritten = std::fwrite(&Header, sizeof(Header), 1, File) == 1;
+	uint64_t Written = sizeof(Header);
+	static const uint8_t Zeros[LevelSnapshot::SectionAlignment] = {};
+	for (uint32_t i = 0; i < LevelSnapshot::NumSections && isWritten; i++)
+	{
+		const uint64_t Bytes = SectionCounts[i] * RecordSizes[i];
+		isWritten = std::fwrite(Zeros, 1, (size_t)(Header.Sections[i].Offset - Written), File) == Header.Sections[i].Offset - Written;
+		if (isWritten && Bytes > 0)
+			isWritten = std::fwrite(SectionData[i], 1, (size_t)Bytes, File) == Bytes;
+		Written = Header.Sections[i].Offset + Bytes;
+	}
+	if (isWritten)
+		isWritten = std::fwrite(Zeros, 1, (size_t)(Header.FileSize - Written), File) == Header.FileSize - Written;
+
+	return std::fclose(File) == 0 && isWritten;
+}
+
+bool FLevelSnapshot::Open(const std::string& Path)
+{
+	Close();
+	if (!File.Open(Path) || File.GetSize() < sizeof(FLevelSnapshotHeader))
+	{
+		Close();
+		return false;
+	}
+
+	// Check the header and that every section fits inside the file.
+	const uint64_t Size = File.GetSize();
+	const FLevelSnapshotHeader* MappedHeader = reinterpret_cast<const FLevelSnapshotHeader*>(File.GetData());
+	bool isValid = MappedHeader->Magic == LevelSnapshot::Magic && MappedHeader->Version == LevelSnapshot::Version && MappedHeader->FileSize <= Size;
+	const uint64_t RecordSizes[LevelSnapshot::NumSections] = { sizeof(FSimBox), sizeof(FSimTriangle), sizeof(FSimBumper), sizeof(FSimField), sizeof(FSimFinish), sizeof(FSimGridCell), sizeof(int32_t) };
+	for (uint32_t i = 0; i < LevelSnapshot::NumSections && isValid; i++)
+	{
+		const FLevelSnapshotSection& Section = MappedHeader->Sections[i];
+		isValid = Section.Offset % LevelSnapshot::SectionAlignment == 0 && Section.Offset <= Size && Section.Count <= (Size - Section.Offset) / RecordSizes[i];
+	}
+	if (!isValid)
+	{
+		Close();
+		return false;
+	}
+
+	Data = File.GetData();
+	Header = MappedHeader;
+	return true;
+}
+
+void FLevelSnapshot::Close()
+{
+	File.Close();
+	Data = nullptr;
+	Header = nullptr;
+}
+
+FLevelSnapshotInfo FLevelSnapshot::GetInfo() const
+{
+	FLevelSnapshotInfo Info;
+	Info.BallLocation = Header->BallLocation;
+	Info.MaxParAllowed = Header->MaxParAllowed;
+	Info.MaxChargePossibleAtFullChargeUp = Header->MaxChargePossibleAtFullChargeUp;
+	Info.GravityZ = Header->GravityZ;
+	return Info;
+}
+
+FSimGridView FLevelSnapshot::GetGrid() const
+{
+	size_t NumCells, NumColliders;
+	FSimGridView Grid;
+	Grid.CellSize = Header->GridCellSize;
+	Grid.Cells = GetSection<FSimGridCell>(LevelSnapshot::GridCells, NumCells);
+	Grid.NumCells = NumCells;
+	Grid.Colliders = GetSection<int32_t>(LevelSnapshot::GridColliders, NumColliders);
+	return Grid;
+}
+
+void FLevelSnapshot::CopyToWorld(FSimWorld& OutWorld) const
+{
+	size_t Count;
+	const FSimBox* Boxes = GetBoxes(Count);
+	OutWorld.Boxes.assign(Boxes, Boxes + Count);
+	const FSimTriangle* Triangles = GetTriangles(Count);
+	OutWorld.Triangles.assign(Triangles, Triangles + Count);
+	const FSimBumper* Bumpers = GetBumpers(Count);
+	OutWorld.Bumpers.assign(Bumpers, Bumpers + Count);
+	const FSimField* Fields = GetFields(Count);
+	OutWorld.Fields.assign(Fields, Fields + Count);
+	const FSimFinish* Finishes = GetFinishes(Count);
+	OutWorld.Finishes.assign(Finishes, Finishes + Count);
+
+	size_t NumColliders;
+	const FSimGridView Grid = GetGrid();
+	GetSection<int32_t>(LevelSnapshot::GridColliders, NumColliders);
+	OutWorld.SetGrid(Grid.CellSize, Grid.Cells, Grid.NumCells, Grid.Colliders, NumColliders);
+}
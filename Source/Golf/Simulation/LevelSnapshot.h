@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// This file must not include any engine headers. It is shared by the game and by tools that run without the editor.
+#include "UltraBallSim.h"
+#include "MappedFile.h"
+
+/**
+ * Level Snapshot file layout. Everything is little endian.
+ *
+ * The file starts with FLevelSnapshotHeader, followed by one section for each array. Each section starts on a 64 byte
+ * boundary, so the records can be read straight out of a memory mapped file without copying or parsing.
+ * The records use the simulation's own types, which are checked below to have a fixed layout.
+ */
+namespace LevelSnapshot
+{
+	// "UBLS"
+	static const uint32_t Magic = 0x534C4255;
+
+	// Bump this whenever the layout of the file or of any record changes.
+	static const uint32_t Version = 1;
+
+	// Every section starts on a boundary of this many bytes.
+	static const uint64_t SectionAlignment = 64;
+
+	enum ESection : uint32_t
+	{
+		Boxes,
+		Triangles,
+		Bumpers,
+		Fields,
+		Finishes,
+		GridCells,
+		GridColliders,
+		NumSections
+	};
+}
+
+// Where a section is in the file and how many records it holds.
+struct FLevelSnapshotSection
+{
+	uint64_t Offset;
+	uint64_t Count;
+};
+
+struct FLevelSnapshotHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint64_t FileSize;
+
+	// Where UltraBall starts and the shot settings for the level.
+	FSimVector BallLocation;
+	int32_t MaxParAllowed;
+	float MaxChargePossibleAtFullChargeUp;
+	float GravityZ;
+
+	float GridCellSize;
+
+	// Zero. Pads the header out to a section boundary and leaves room for later versions.
+	uint32_t Reserved[9];
+
+	FLevelSnapshotSection Sections[LevelSnapshot::NumSections];
+};
+
+// The level information stored alongside the colliders.
+struct FLevelSnapshotInfo
+{
+	FSimVector BallLocation;
+	int32_t MaxParAllowed = 0;
+	float MaxChargePossibleAtFullChargeUp = 1.0f;
+	float GravityZ = -980.0f;
+};
+
+/**
+ * A memory mapped Level Snapshot.
+ * Opening a snapshot only checks the header. The arrays point straight into the mapped file, so many processes loading
+ * the same snapshot share one copy in the page cache.
+ */
+class FLevelSnapshot
+{
+public:
+
+	// Write a built world to a file. Returns false if the file couldn't be written.
+	static bool Write(const std::string& Path, const FSimWorld& World, const FLevelSnapshotInfo& Info);
+
+	// Map a snapshot file. Returns false if it can't be opened or isn't a snapshot of this version.
+	bool Open(const std::string& Path);
+
+	// Unmap the file. Any pointers taken from the snapshot are no longer valid.
+	void Close();
+
+	bool IsOpen() const { return Header != nullptr; }
+	const FLevelSnapshotHeader& GetHeader() const { return *Header; }
+	FLevelSnapshotInfo GetInfo() const;
+
+	const FSimBox* GetBoxes(size_t& OutCount) const { return GetSection<FSimBox>(LevelSnapshot::Boxes, OutCount); }
+	const FSimTriangle* GetTriangles(size_t& OutCount) const { return GetSection<FSimTriangle>(LevelSnapshot::Triangles, OutCount); }
+	const FSimBumper* GetBumpers(size_t& OutCount) const { return GetSection<FSimBumper>(LevelSnapshot::Bumpers, OutCount); }
+	const FSimField* GetFields(size_t& OutCount) const { return GetSection<FSimField>(LevelSnapshot::Fields, OutCount); }
+	const FSimFinish* GetFinishes(size_t& OutCount) const { return GetSection<FSimFinish>(LevelSnapshot::Finishes, OutCount); }
+
+	// The collision grid, ready to be queried in place.
+	FSimGridView GetGrid() const;
+
+	// Copy the snapshot into a world for the simulation. The grid is copied as is, so it isn't rebuilt.
+	void CopyToWorld(FSimWorld& OutWorld) const;
+
+private:
+
+	template<typename T>
+	const T* GetSection(LevelSnapshot::ESection Section, size_t& OutCount) const
+	{
+		OutCount = (size_t)Header->Sections[Section].Count;
+		return reinterpret_cast<const T*>(Data + Header->Sections[Section].Offset);
+	}
+
+	FSimMappedFile File;
+	const uint8_t* Data = nullptr;
+	const FLevelSnapshotHeader* Header = nullptr;
+};
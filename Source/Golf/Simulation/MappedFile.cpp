@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MappedFile.h"
+
+#if defined(_WIN32) && defined(WITH_ENGINE)
+	// Built into the game, windows.h comes through the engine's wrappers so its macros and types don't leak into the module.
+	#include "Windows/AllowWindowsPlatformTypes.h"
+	#include "Windows/WindowsHWrapper.h"
+	#include "Windows/HideWindowsPlatformTypes.h"
+#elif defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+FSimMappedFile::~FSimMappedFile()
+{
+	Close();
+}
+
+bool FSimMappedFile::Open(const std::string& Path)
+{
+	Close();
+
+#if defined(_WIN32)
+	HANDLE File = CreateFileA(Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
+		return false;
+	FileHandle = File;
+
+	LARGE_INTEGER FileSize;
+	HANDLE Mapping = GetFileSizeEx(File, &FileSize) && FileSize.QuadPart > 0 ? CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	MappingHandle = Mapping;
+	const void* View = Mapping != nullptr ? MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (View == nullptr)
+	{
+		Close();
+		return false;
+	}
+	Size = (uint64_t)FileSize.QuadPart;
+#else
+	const int File = open(Path.c_str(), O_RDONLY);
+	if (File < 0)
+		return false;
+
+	// The mapping stays valid once the file is closed.
+	struct stat FileStat;
+	void* View = fstat(File, &FileStat) == 0 && FileStat.st_size > 0 ? mmap(nullptr, (size_t)FileStat.st_size, PROT_READ, MAP_SHARED, File, 0) : MAP_FAILED;
+	close(File);
+	if (View == MAP_FAILED)
+		return false;
+	Size = (uint64_t)FileStat.st_size;
+#endif
+
+	Data = static_cast<const uint8_t*>(View);
+	return true;
+}
+
+void FSimMappedFile::Close()
+{
+#if defined(_WIN32)
+	if (Data != nullptr)
+		UnmapViewOfFile(Data);
+	if (MappingHandle != nullptr)
+		CloseHandle(MappingHandle);
+	if (FileHandle != nullptr)
+		CloseHandle(FileHandle);
+#else
+	if (Data != nullptr)
+		munmap(const_cast<uint8_t*>(Data), (size_t)Size);
+#endif
+
+	Data = nullptr;
+	Size = 0;
+	FileHandle = nullptr;
+	MappingHandle = nullptr;
+}
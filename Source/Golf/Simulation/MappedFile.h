@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// This file must not include any engine headers. It is shared by the game and by tools that run without the editor.
+// On Windows, MappedFile.cpp takes windows.h through the engine's wrappers when it is built into the game.
+#include <cstdint>
+#include <string>
+
+/**
+ * A read only memory mapped file.
+ * Pages are loaded by the OS as they are touched, and processes that map the same file share one copy in the page cache.
+ */
+class FSimMappedFile
+{
+public:
+
+	FSimMappedFile() = default;
+	~FSimMappedFile();
+
+	FSimMappedFile(const FSimMappedFile&) = delete;
+	FSimMappedFile& operator=(const FSimMappedFile&) = delete;
+
+	// Map a file. Returns false if it can't be opened or is empty.
+	bool Open(const std::string& Path);
+
+	// Unmap the file. Any pointers into it are no longer valid.
+	void Close();
+
+	bool IsOpen() const { return Data != nullptr; }
+	const uint8_t* GetData() const { return Data; }
+	uint64_t GetSize() const { return Size; }
+
+private:
+
+	const uint8_t* Data = nullptr;
+	uint64_t Size = 0;
+
+	// Platform handles for the mapping.
+	void* FileHandle = nullptr;
+	void* MappingHandle = nullptr;
+};
@@ -0,0 +1,128 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ParSolver.h"
+#include <algorithm>
+#include <unordered_set>
+
+FParSolver::FParSolver(const FSimWorld& InWorld, const FSimSettings& InSimSettings, const FParSolverSettings& InSettings, FSimThreadPool& InThreadPool)
+	: World(InWorld)
+	, SimSettings(InSimSettings)
+	, Settings(InSettings)
+	, ThreadPool(InThreadPool)
+{
+	BuildShots();
+}
+
+void FParSolver::BuildShots()
+{
+	const float DegreesToRadians = 3.14159265f / 180.0f;
+	const int32_t NumYawSteps = std::max(1, Settings.NumYawSteps);
+	const int32_t NumPitchSteps = std::max(1, Settings.NumPitchSteps);
+	const int32_t NumChargeSteps = std::max(1, Settings.NumChargeSteps);
+
+	Shots.clear();
+	for (int32_t YawStep = 0; YawStep < NumYawSteps; YawStep++)
+	{
+		const float Yaw = 360.0f * YawStep / NumYawSteps * DegreesToRadians;
+		for (int32_t PitchStep = 0; PitchStep < NumPitchSteps; PitchStep++)
+		{
+			const float PitchAlpha = NumPitchSteps > 1 ? (float)PitchStep / (NumPitchSteps - 1) : 0.0f;
+			const float Pitch = (Settings.MinPitch + (Settings.MaxPitch - Settings.MinPitch) * PitchAlpha) * DegreesToRadians;
+			const FSimVector Direction(std::cos(Pitch) * std::cos(Yaw), std::cos(Pitch) * std::sin(Yaw), std::sin(Pitch));
+			for (int32_t ChargeStep = 0; ChargeStep < NumChargeSteps; ChargeStep++)
+			{
+				FParShot Shot;
+				Shot.Direction = Direction;
+				Shot.Charge = Settings.MinCharge + (1.0f - Settings.MinCharge) * (ChargeStep + 1) / NumChargeSteps;
+				Shots.push_back(Shot);
+			}
+		}
+	}
+}
+
+uint64_t FParSolver::GetMemoKey(const FSimVector& Location) const
+{
+	// Pack 21 bits of each cell coordinate into one key.
+	const uint64_t Mask = (1 << 21) - 1;
+	const uint64_t X = (uint64_t)(int64_t)std::floor(Location.X / Settings.MemoCellSize) & Mask;
+	const uint64_t Y = (uint64_t)(int64_t)std::floor(Location.Y / Settings.MemoCellSize) & Mask;
+	const uint64_t Z = (uint64_t)(int64_t)std::floor(Location.Z / Settings.MemoCellSize) & Mask;
+	return X | (Y << 21) | (Z << 42);
+}
+
+FParSolution FParSolver::Solve(const FSimVector& StartLocation)
+{
+	FParSolution Solution;
+
+	std::vector<FNode> Nodes;
+	FNode Start;
+	Start.State.Location = StartLocation;
+	Start.State.isAtRest = true;
+	Start.Parent = -1;
+	Nodes.push_back(Start);
+
+	std::unordered_set<uint64_t> Visited;
+	Visited.insert(GetMemoKey(StartLocation));
+
+	std::vector<int32_t> Frontier(1, 0);
+	std::vector<int32_t> NextFrontier;
+	std::vector<FSimShotResult> Results;
+	const int32_t NumShots = (int32_t)Shots.size();
+	const int32_t NodesPerBatch = std::max(1, Settings.ShotsPerBatch / std::max(1, NumShots));
+
+	for (int32_t Par = 1; Par <= Settings.MaxPar && !Frontier.empty(); Par++)
+	{
+		// Try every shot from every spot found by the last shot, a batch of spots at a time.
+		NextFrontier.clear();
+		for (int32_t FirstNode = 0; FirstNode < (int32_t)Frontier.size(); FirstNode += NodesPerBatch)
+		{
+			const int32_t NumNodes = std::min(NodesPerBatch, (int32_t)Frontier.size() - FirstNode);
+			const int32_t Count = NumNodes * NumShots;
+			Results.resize(Count);
+			ThreadPool.ParallelFor(Count, [&](int32_t Index)
+			{
+				const FNode& Node = Nodes[Frontier[FirstNode + Index / NumShots]];
+				const FParShot& Shot = Shots[Index % NumShots];
+				const FSimVector LaunchVelocity = FUltraBallSim::GetLaunchVelocity(Shot.Direction, Shot.Charge, Settings.MaxChargePossibleAtFullChargeUp);
+				Results[Index] = FUltraBallSim::SimulateShot(World, SimSettings, Node.State, LaunchVelocity, Settings.MaxShotTime);
+			});
+			Solution.SimulatedShots += Count;
+
+			// Go through the results in order. The first shot to finish wins.
+			for (int32_t Index = 0; Index < Count; Index++)
+			{
+				FSimBallState& State = Results[Index].FinalState;
+				if (State.isOutOfBounds || !(State.isFinished || State.isAtRest))
+					continue;
+
+				const int32_t Parent = Frontier[FirstNode + Index / NumShots];
+				if (State.isFinished)
+				{
+					FParShot Shot = Shots[Index % NumShots];
+					Shot.Landing = State.Location;
+					Solution.isSolved = true;
+					Solution.Par = Par;
+					Solution.Shots.push_back(Shot);
+					for (int32_t Step = Parent; Nodes[Step].Parent >= 0; Step = Nodes[Step].Parent)
+						Solution.Shots.insert(Solution.Shots.begin(), Nodes[Step].Shot);
+					return Solution;
+				}
+
+				// Skip any spot that has already been reached in as few shots. Only new spots are copied out of the results.
+				if ((int32_t)NextFrontier.size() >= Settings.MaxStatesPerPar || !Visited.insert(GetMemoKey(State.Location)).second)
+					continue;
+
+				FNode Node;
+				Node.State = std::move(State);
+				Node.Parent = Parent;
+				Node.Shot = Shots[Index % NumShots];
+				Node.Shot.Landing = Node.State.Location;
+				NextFrontier.push_back((int32_t)Nodes.size());
+				Nodes.push_back(std::move(Node));
+			}
+		}
+		Frontier.swap(NextFrontier);
+	}
+
+	return Solution;
+}
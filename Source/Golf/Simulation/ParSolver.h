@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// This file must not include any engine headers. It is shared by the game and by tools that run without the editor.
+#include "UltraBallSim.h"
+#include "SimThreadPool.h"
+
+// A single shot in a solution.
+struct FParShot
+{
+	// The direction UltraBall is fired in.
+	FSimVector Direction;
+
+	// How far the shot was charged, from 0 to 1. Multiply by MaxChargePossibleAtFullChargeUp for the charge amount.
+	float Charge = 0.0f;
+
+	// Where UltraBall ended up after the shot.
+	FSimVector Landing;
+};
+
+// How thoroughly the Par Solver searches.
+struct FParSolverSettings
+{
+	// The launch directions tried for every shot. Pitch is in degrees above the horizon.
+	int32_t NumYawSteps = 32;
+	int32_t NumPitchSteps = 4;
+	float MinPitch = 0.0f;
+	float MaxPitch = 60.0f;
+
+	// The charges tried for every direction, spread evenly from MinCharge to full charge.
+	int32_t NumChargeSteps = 8;
+	float MinCharge = 0.1f;
+
+	// Matches ABall.
+	float MaxChargePossibleAtFullChargeUp = 1.0f;
+
+	// Stop searching after this many shots. The commandlet sets this to each level's MaxParAllowed, which defaults to 20.
+	int32_t MaxPar = 20;
+
+	// How long a shot is simulated for before it is given up on.
+	float MaxShotTime = 15.0f;
+
+	// Resting spots closer together than this are treated as the same spot, so each is only searched once.
+	float MemoCellSize = 25.0f;
+
+	// The most resting spots searched for each shot. The first ones found are kept.
+	int32_t MaxStatesPerPar = 4096;
+
+	// How many shots are simulated at once. Only one batch of results is held at a time, however wide the search gets.
+	int32_t ShotsPerBatch = 8192;
+};
+
+// The best result the Par Solver found.
+struct FParSolution
+{
+	bool isSolved = false;
+	int32_t Par = 0;
+	std::vector<FParShot> Shots;
+
+	// How many shots were simulated to find the solution.
+	int64_t SimulatedShots = 0;
+};
+
+/**
+ * Finds the fewest shots needed to reach the Finish Target.
+ * Every shot is searched breadth first, so the first solution found uses the fewest shots. Shots are simulated on a thread pool
+ * in batches, and results are always processed in the same order so the solution doesn't depend on the number of threads
+ * or the size of a batch. Spots that round to the same memo cell are only kept once.
+ */
+class FParSolver
+{
+public:
+
+	FParSolver(const FSimWorld& InWorld, const FSimSettings& InSimSettings, const FParSolverSettings& InSettings, FSimThreadPool& InThreadPool);
+
+	// Search for the best solution starting with UltraBall resting at this location.
+	FParSolution Solve(const FSimVector& StartLocation);
+
+private:
+
+	// A spot UltraBall came to rest in, and the shot that got it there.
+	struct FNode
+	{
+		FSimBallState State;
+		int32_t Parent;
+		FParShot Shot;
+	};
+
+	// Build the list of directions and charges tried for every shot.
+	void BuildShots();
+
+	// Returns a key for the memo cell this location falls in.
+	uint64_t GetMemoKey(const FSimVector& Location) const;
+
+	const FSimWorld& World;
+	FSimSettings SimSettings;
+	FParSolverSettings Settings;
+	FSimThreadPool& ThreadPool;
+	std::vector<FParShot> Shots;
+};
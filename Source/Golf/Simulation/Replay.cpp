@@ -0,0 +1,325 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Replay.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static_assert(sizeof(FReplayHeader) == 64, "The header must fill a cache line.");
+static_assert(sizeof(FReplayChunkHeader) == 32, "The chunk header must stay the same size.");
+static_assert(sizeof(FReplayEvent) == 24, "Events are written as they are, so their layout must not change.");
+
+// The three smallest components of a unit quaternion are never bigger than this.
+static const float SmallestThreeRange = 0.70710678f;
+static const float RotationScale = 32767.0f / SmallestThreeRange;
+
+// Signed values are zigzagged so small negative changes take as few bytes as small positive ones.
+static void WriteVarint(std::vector<uint8_t>& Bytes, int32_t Value)
+{
+	uint32_t Zigzag = ((uint32_t)Value << 1) ^ (uint32_t)(Value >> 31);
+	while (Zigzag >= 0x80)
+	{
+		Bytes.push_back((uint8_t)(Zigzag | 0x80));
+		Zigzag >>= 7;
+	}
+	Bytes.push_back((uint8_t)Zigzag);
+}
+
+// Returns false if the varint runs past the end.
+static bool ReadVarint(const uint8_t*& Read, const uint8_t* End, int32_t& OutValue)
+{
+	uint32_t Zigzag = 0;
+	for (uint32_t Shift = 0; Shift < 35; Shift += 7)
+	{
+		if (Read >= End)
+			return false;
+
+		const uint8_t Byte = *Read++;
+		Zigzag |= (uint32_t)(Byte & 0x7F) << Shift;
+		if ((Byte & 0x80) == 0)
+		{
+			OutValue = (int32_t)(Zigzag >> 1) ^ -(int32_t)(Zigzag & 1);
+			return true;
+		}
+	}
+	return false;
+}
+
+// Quantise a sample into its flags and six values.
+static uint8_t Quantise(const FReplaySample& Sample, float PositionQuantum, int32_t OutValues[6])
+{
+	OutValues[0] = (int32_t)std::lround(Sample.Location.X / PositionQuantum);
+	OutValues[1] = (int32_t)std::lround(Sample.Location.Y / PositionQuantum);
+	OutValues[2] = (int32_t)std::lround(Sample.Location.Z / PositionQuantum);
+
+	// Leave out the largest component, which can be worked out from the other three.
+	// q and -q are the same rotation, so flip the sign to make it positive.
+	const float Components[4] = { Sample.Rotation.X, Sample.Rotation.Y, Sample.Rotation.Z, Sample.Rotation.W };
+	uint8_t Largest = 0;
+	for (uint8_t i = 1; i < 4; i++)
+	{
+		if (std::fabs(Components[i]) > std::fabs(Components[Largest]))
+			Largest = i;
+	}
+	const float Sign = Components[Largest] < 0.0f ? -1.0f : 1.0f;
+	for (uint8_t i = 0, Out = 3; i < 4; i++)
+	{
+		if (i != Largest)
+			OutValues[Out++] = (int32_t)std::lround(std::max(-SmallestThreeRange, std::min(SmallestThreeRange, Components[i] * Sign)) * RotationScale);
+	}
+
+	return Largest | (uint8_t)((Sample.ZoneState << Replay::FlagZoneShift) & Replay::FlagZoneMask);
+}
+
+static FReplaySample Dequantise(uint8_t Flags, const int32_t Values[6], float PositionQuantum)
+{
+	FReplaySample Sample;
+	Sample.Location = FSimVector(Values[0] * PositionQuantum, Values[1] * PositionQuantum, Values[2] * PositionQuantum);
+	Sample.ZoneState = (Flags & Replay::FlagZoneMask) >> Replay::FlagZoneShift;
+
+	const uint8_t Largest = Flags & 3;
+	float Components[4];
+	float SumSquared = 0.0f;
+	for (uint8_t i = 0, In = 3; i < 4; i++)
+	{
+		if (i == Largest)
+			continue;
+
+		Components[i] = Values[In++] / RotationScale;
+		SumSquared += Components[i] * Components[i];
+	}
+	Components[Largest] = std::sqrt(std::max(0.0f, 1.0f - SumSquared));
+
+	Sample.Rotation.X = Components[0];
+	Sample.Rotation.Y = Components[1];
+	Sample.Rotation.Z = Components[2];
+	Sample.Rotation.W = Components[3];
+	return Sample;
+}
+
+FReplayEncoder::FReplayEncoder(float SampleRate, float PositionQuantum, const char* LevelName, int64_t StartTime)
+{
+	std::memset(&Header, 0, sizeof(Header));
+	Header.Magic = Replay::Magic;
+	Header.Version = Replay::Version;
+	Header.SampleRate = SampleRate;
+	Header.PositionQuantum = PositionQuantum;
+	Header.StartTime = StartTime;
+	std::strncpy(Header.LevelName, LevelName, sizeof(Header.LevelName) - 1);
+
+	std::memset(Previous, 0, sizeof(Previous));
+	SampleBytes.reserve(Replay::ChunkSamples * 8);
+}
+
+void FReplayEncoder::AddSample(const FReplaySample& Sample)
+{
+	int32_t Values[6];
+	const uint8_t Flags = Quantise(Sample, Header.PositionQuantum, Values);
+
+	// A ball at rest is the common case, so it is written as a single byte.
+	if (NumChunkSamples > 0 && Flags == PreviousFlags && std::memcmp(Values, Previous, sizeof(Values)) == 0)
+	{
+		SampleBytes.push_back(Flags | Replay::FlagRepeat);
+	}
+	else
+	{
+		SampleBytes.push_back(Flags);
+		for (int32_t i = 0; i < 6; i++)
+			WriteVarint(SampleBytes, Values[i] - Previous[i]);
+	}
+
+	std::memcpy(Previous, Values, sizeof(Values));
+	PreviousFlags = Flags;
+	NumChunkSamples++;
+	NumSamples++;
+}
+
+void FReplayEncoder::AddEvent(const FReplayEvent& Event)
+{
+	Events.push_back(Event);
+	Events.back().Sample = NumSamples;
+}
+
+void FReplayEncoder::TakeChunk(std::vector<uint8_t>& OutChunk)
+{
+	// Pad the samples so the events and the next chunk header stay aligned.
+	while (SampleBytes.size() % 4 != 0)
+		SampleBytes.push_back(0);
+
+	FReplayChunkHeader ChunkHeader = {};
+	ChunkHeader.Magic = Replay::ChunkMagic;
+	ChunkHeader.FirstSample = NumSamples - NumChunkSamples;
+	ChunkHeader.NumSamples = NumChunkSamples;
+	ChunkHeader.NumEvents = (uint32_t)Events.size();
+	ChunkHeader.SampleBytes = (uint32_t)SampleBytes.size();
+
+	OutChunk.resize(sizeof(ChunkHeader) + SampleBytes.size() + Events.size() * sizeof(FReplayEvent));
+	std::memcpy(OutChunk.data(), &ChunkHeader, sizeof(ChunkHeader));
+	if (!SampleBytes.empty())
+		std::memcpy(OutChunk.data() + sizeof(ChunkHeader), SampleBytes.data(), SampleBytes.size());
+	if (!Events.empty())
+		std::memcpy(OutChunk.data() + sizeof(ChunkHeader) + SampleBytes.size(), Events.data(), Events.size() * sizeof(FReplayEvent));
+
+	// The next chunk starts from scratch.
+	SampleBytes.clear();
+	Events.clear();
+	std::memset(Previous, 0, sizeof(Previous));
+	PreviousFlags = 0;
+	NumChunkSamples = 0;
+}
+
+bool FReplayReader::Open(const std::string& Path)
+{
+	Close();
+	if (!File.Open(Path) || File.GetSize() < sizeof(FReplayHeader))
+	{
+		Close();
+		return false;
+	}
+
+	const FReplayHeader& Header = GetHeader();
+	if (Header.Magic != Replay::Magic || Header.Version != Replay::Version || Header.SampleRate <= 0.0f || Header.PositionQuantum <= 0.0f)
+	{
+		Close();
+		return false;
+	}
+
+	// Index the chunks. A recording that was cut short ends in a partial chunk, which is left out.
+	const uint64_t Size = File.GetSize();
+	uint64_t Offset = sizeof(FReplayHeader);
+	while (Offset + sizeof(FReplayChunkHeader) <= Size)
+	{
+		const FReplayChunkHeader* ChunkHeader = reinterpret_cast<const FReplayChunkHeader*>(File.GetData() + Offset);
+		const uint64_t ChunkSize = sizeof(FReplayChunkHeader) + (uint64_t)ChunkHeader->SampleBytes + (uint64_t)ChunkHeader->NumEvents * sizeof(FReplayEvent);
+		if (ChunkHeader->Magic != Replay::ChunkMagic || ChunkHeader->FirstSample != NumSamples || ChunkHeader->NumSamples > Replay::ChunkSamples
+			|| ChunkHeader->SampleBytes % 4 != 0 || ChunkSize > Size - Offset)
+			break;
+
+		Chunks.push_back({ ChunkHeader->FirstSample, ChunkHeader->NumSamples, Offset });
+		NumSamples += ChunkHeader->NumSamples;
+		Offset += ChunkSize;
+	}
+	return true;
+}
+
+void FReplayReader::Close()
+{
+	File.Close();
+	Chunks.clear();
+	NumSamples = 0;
+	DecodedChunk = -1;
+	Decoded.clear();
+}
+
+bool FReplayReader::GetSample(uint32_t Index, FReplaySample& OutSample)
+{
+	if (Index >= NumSamples)
+		return false;
+
+	const int32_t ChunkIndex = FindChunk(Index);
+	if (ChunkIndex != DecodedChunk)
+		DecodeChunk(ChunkIndex);
+
+	const uint32_t SampleInChunk = Index - Chunks[ChunkIndex].FirstSample;
+	if (SampleInChunk >= Decoded.size())
+		return false;
+
+	OutSample = Decoded[SampleInChunk];
+	return true;
+}
+
+bool FReplayReader::GetSampleAtTime(float Time, FReplaySample& OutSample)
+{
+	if (NumSamples == 0)
+		return false;
+
+	const float Position = std::max(0.0f, Time * GetHeader().SampleRate);
+	const uint32_t Index = std::min((uint32_t)Position, NumSamples - 1);
+	FReplaySample Next;
+	if (!GetSample(Index, OutSample))
+		return false;
+	if (Index + 1 >= NumSamples || !GetSample(Index + 1, Next))
+		return true;
+
+	// Blend towards the next sample. The zone state is taken from the earlier one.
+	const float Alpha = Position - Index;
+	OutSample.Location = OutSample.Location + (Next.Location - OutSample.Location) * Alpha;
+
+	// Take the shortest way round, then normalise the blended rotation.
+	FSimQuat& A = OutSample.Rotation;
+	const FSimQuat& B = Next.Rotation;
+	const float Sign = A.X * B.X + A.Y * B.Y + A.Z * B.Z + A.W * B.W < 0.0f ? -1.0f : 1.0f;
+	A.X += (B.X * Sign - A.X) * Alpha;
+	A.Y += (B.Y * Sign - A.Y) * Alpha;
+	A.Z += (B.Z * Sign - A.Z) * Alpha;
+	A.W += (B.W * Sign - A.W) * Alpha;
+	const float Length = std::sqrt(A.X * A.X + A.Y * A.Y + A.Z * A.Z + A.W * A.W);
+	if (Length > 1e-6f)
+	{
+		A.X /= Length;
+		A.Y /= Length;
+		A.Z /= Length;
+		A.W /= Length;
+	}
+	return true;
+}
+
+void FReplayReader::GetEvents(uint32_t First, uint32_t Last, std::vector<FReplayEvent>& OutEvents) const
+{
+	// Events sit in the chunk that was being filled when they happened, so a chunk holds events up to the sample just past its end.
+	for (size_t i = 0; i < Chunks.size(); i++)
+	{
+		const FChunk& Chunk = Chunks[i];
+		if (Chunk.FirstSample + Chunk.NumSamples < First)
+			continue;
+		if (Chunk.FirstSample >= Last)
+			break;
+
+		const FReplayChunkHeader* ChunkHeader = reinterpret_cast<const FReplayChunkHeader*>(File.GetData() + Chunk.Offset);
+		const FReplayEvent* Events = reinterpret_cast<const FReplayEvent*>(File.GetData() + Chunk.Offset + sizeof(FReplayChunkHeader) + ChunkHeader->SampleBytes);
+		for (uint32_t Event = 0; Event < ChunkHeader->NumEvents; Event++)
+		{
+			if (Events[Event].Sample >= First && Events[Event].Sample < Last)
+				OutEvents.push_back(Events[Event]);
+		}
+	}
+}
+
+int32_t FReplayReader::FindChunk(uint32_t Sample) const
+{
+	// Chunks are in order of their first sample, so the one holding a sample is the last that starts at or before it.
+	const auto It = std::upper_bound(Chunks.begin(), Chunks.end(), Sample, [](uint32_t Value, const FChunk& Chunk) { return Value < Chunk.FirstSample; });
+	return (int32_t)(It - Chunks.begin()) - 1;
+}
+
+void FReplayReader::DecodeChunk(int32_t ChunkIndex)
+{
+	const FChunk& Chunk = Chunks[ChunkIndex];
+	const FReplayChunkHeader* ChunkHeader = reinterpret_cast<const FReplayChunkHeader*>(File.GetData() + Chunk.Offset);
+	const uint8_t* Read = File.GetData() + Chunk.Offset + sizeof(FReplayChunkHeader);
+	const uint8_t* End = Read + ChunkHeader->SampleBytes;
+	const float PositionQuantum = GetHeader().PositionQuantum;
+
+	Decoded.clear();
+	DecodedChunk = ChunkIndex;
+
+	// A damaged sample ends the chunk early, which GetSample reports as a missing sample.
+	int32_t Values[6] = {};
+	for (uint32_t i = 0; i < Chunk.NumSamples && Read < End; i++)
+	{
+		const uint8_t Flags = *Read++;
+		if ((Flags & Replay::FlagRepeat) == 0)
+		{
+			bool isValid = true;
+			for (int32_t Value = 0; Value < 6 && isValid; Value++)
+			{
+				int32_t Delta = 0;
+				isValid = ReadVarint(Read, End, Delta);
+				Values[Value] += Delta;
+			}
+			if (!isValid)
+				break;
+		}
+		Decoded.push_back(Dequantise(Flags & ~Replay::FlagRepeat, Values, PositionQuantum));
+	}
+}
@@ -0,0 +1,191 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// This file must not include any engine headers. It is shared by the game and by tools that run without the editor.
+#include "UltraBallSim.h"
+#include "MappedFile.h"
+
+/**
+ * Replay file layout. Everything is little endian.
+ *
+ * A header is followed by chunks, each holding up to ChunkSamples samples taken at a fixed rate and the events in between.
+ * Every chunk starts from scratch, so it can be decoded without reading anything before it, and a file cut short by a
+ * crash is still readable up to its last whole chunk.
+ *
+ * Each sample is one flags byte followed by six varints: the change in the quantised location and in the three
+ * smallest quantised rotation components since the previous sample. A sample that hasn't changed is just its flags byte.
+ */
+namespace Replay
+{
+	// "UBRP"
+	static const uint32_t Magic = 0x50524255;
+
+	// "UBRC"
+	static const uint32_t ChunkMagic = 0x43524255;
+
+	// Bump this whenever the layout of the file changes.
+	static const uint32_t Version = 1;
+
+	static const uint32_t ChunkSamples = 256;
+
+	// Sample flags. The low two bits hold the index of the rotation component that was left out.
+	static const uint8_t FlagZoneShift = 2;
+	static const uint8_t FlagZoneMask = 0x0C;
+	static const uint8_t FlagRepeat = 0x10;
+}
+
+struct FReplayHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+
+	// How many samples are taken each second, and the size of a step of the quantised location.
+	float SampleRate;
+	float PositionQuantum;
+
+	// When the recording started, in seconds since 1970.
+	int64_t StartTime;
+
+	// The level that was recorded. Always ends in a zero.
+	char LevelName[40];
+};
+
+struct FReplayChunkHeader
+{
+	uint32_t Magic;
+	uint32_t FirstSample;
+	uint32_t NumSamples;
+	uint32_t NumEvents;
+
+	// How many bytes of samples follow this header. The events come after them.
+	uint32_t SampleBytes;
+	uint32_t Reserved[3];
+};
+
+// A rotation. The same layout as FQuat.
+struct FSimQuat
+{
+	float X = 0.0f;
+	float Y = 0.0f;
+	float Z = 0.0f;
+	float W = 1.0f;
+};
+
+// Where UltraBall was at one sample.
+struct FReplaySample
+{
+	FSimVector Location;
+	FSimQuat Rotation;
+
+	// Which kind of zone UltraBall was in. Matches ABall's zone states.
+	uint8_t ZoneState = 0;
+};
+
+enum class EReplayEventType : uint8_t
+{
+	// UltraBall was fired.
+	Shot,
+
+	// UltraBall reached the Finish Target.
+	Finish
+};
+
+// Something that happened between two samples.
+struct FReplayEvent
+{
+	// The sample the event happened before.
+	uint32_t Sample = 0;
+	EReplayEventType Type = EReplayEventType::Shot;
+	uint8_t Padding = 0;
+
+	// The par after the event, and for shots the charge and launch velocity.
+	int16_t Par = 0;
+	float Charge = 0.0f;
+	FSimVector Velocity;
+};
+
+/**
+ * Turns samples and events into replay chunks.
+ * The encoder only holds the chunk being filled, so it can run for any length of session.
+ */
+class FReplayEncoder
+{
+public:
+
+	FReplayEncoder(float SampleRate, float PositionQuantum, const char* LevelName, int64_t StartTime);
+
+	// Returns the file header, which is written before any chunks.
+	const FReplayHeader& GetHeader() const { return Header; }
+
+	void AddSample(const FReplaySample& Sample);
+
+	// Add an event before the next sample.
+	void AddEvent(const FReplayEvent& Event);
+
+	bool IsChunkFull() const { return NumChunkSamples >= Replay::ChunkSamples; }
+	bool IsChunkEmpty() const { return NumChunkSamples == 0 && Events.empty(); }
+
+	// Move the encoded chunk into OutChunk and start a new one.
+	void TakeChunk(std::vector<uint8_t>& OutChunk);
+
+private:
+
+	FReplayHeader Header;
+	uint32_t NumSamples = 0;
+	uint32_t NumChunkSamples = 0;
+	std::vector<uint8_t> SampleBytes;
+	std::vector<FReplayEvent> Events;
+
+	// The quantised state of the previous sample in this chunk.
+	int32_t Previous[6];
+	uint8_t PreviousFlags = 0;
+};
+
+/**
+ * Plays back a memory mapped replay.
+ * Only the chunk holding the requested sample is decoded, so a long session costs its chunk index and one chunk of samples.
+ * Not safe to use from more than one thread at once.
+ */
+class FReplayReader
+{
+public:
+
+	// Map a replay. Returns false if it can't be opened or isn't a replay of this version.
+	bool Open(const std::string& Path);
+	void Close();
+	bool IsOpen() const { return File.IsOpen(); }
+
+	const FReplayHeader& GetHeader() const { return *reinterpret_cast<const FReplayHeader*>(File.GetData()); }
+	uint32_t GetNumSamples() const { return NumSamples; }
+
+	// Returns the sample at an index. Returns false if it is past the end.
+	bool GetSample(uint32_t Index, FReplaySample& OutSample);
+
+	// Returns the sample at a time since the start, blended between the samples either side.
+	bool GetSampleAtTime(float Time, FReplaySample& OutSample);
+
+	// Find every event from sample First up to but not including sample Last.
+	void GetEvents(uint32_t First, uint32_t Last, std::vector<FReplayEvent>& OutEvents) const;
+
+private:
+
+	struct FChunk
+	{
+		uint32_t FirstSample;
+		uint32_t NumSamples;
+		uint64_t Offset;
+	};
+
+	// Returns the chunk holding a sample.
+	int32_t FindChunk(uint32_t Sample) const;
+
+	void DecodeChunk(int32_t ChunkIndex);
+
+	FSimMappedFile File;
+	std::vector<FChunk> Chunks;
+	uint32_t NumSamples = 0;
+
+	int32_t DecodedChunk = -1;
+	std::vector<FReplaySample> Decoded;
+};
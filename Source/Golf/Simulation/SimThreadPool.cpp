@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "SimThreadPool.h"
+#include <algorithm>
+
+FSimThreadPool::FSimThreadPool(int32_t NumThreads)
+	: CurrentTask(nullptr)
+	, Remaining(0)
+{
+	if (NumThreads <= 0)
+		NumThreads = std::max(1, (int32_t)std::thread::hardware_concurrency());
+
+	// Queue 0 belongs to the thread that calls ParallelFor.
+	for (int32_t i = 0; i < NumThreads; i++)
+		Queues.push_back(std::make_unique<FQueue>());
+	for (int32_t i = 1; i < NumThreads; i++)
+		Threads.emplace_back(&FSimThreadPool::WorkerLoop, this, i);
+}
+
+FSimThreadPool::~FSimThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> Lock(PoolMutex);
+		isStopping = true;
+	}
+	WorkCondition.notify_all();
+	for (std::thread& Thread : Threads)
+		Thread.join();
+}
+
+void FSimThreadPool::ParallelFor(int32_t Count, const std::function<void(int32_t)>& Task)
+{
+	if (Count <= 0)
+		return;
+
+	// Split the work into a few ranges per thread so there is something left to steal when the work is uneven.
+	const int32_t NumQueues = (int32_t)Queues.size();
+	const int32_t RangeSize = std::max(1, Count / (NumQueues * 8));
+	CurrentTask = &Task;
+	Remaining = Count;
+	int32_t QueueIndex = 0;
+	for (int32_t Begin = 0; Begin < Count; Begin += RangeSize)
+	{
+		FQueue& Queue = *Queues[QueueIndex];
+		std::lock_guard<std::mutex> Lock(Queue.Mutex);
+		Queue.Ranges.push_back({ Begin, std::min(Count, Begin + RangeSize) });
+		QueueIndex = (QueueIndex + 1) % NumQueues;
+	}
+
+	{
+		std::lock_guard<std::mutex> Lock(PoolMutex);
+		Generation++;
+	}
+	WorkCondition.notify_all();
+
+	RunRanges(0);
+
+	// Wait for the ranges the other threads are still running.
+	std::unique_lock<std::mutex> Lock(PoolMutex);
+	DoneCondition.wait(Lock, [this]() { return Remaining.load() == 0; });
+	CurrentTask = nullptr;
+}
+
+void FSimThreadPool::WorkerLoop(int32_t QueueIndex)
+{
+	uint64_t SeenGeneration = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> Lock(PoolMutex);
+			WorkCondition.wait(Lock, [this, SeenGeneration]() { return isStopping || Generation != SeenGeneration; });
+			if (isStopping)
+				return;
+			SeenGeneration = Generation;
+		}
+		RunRanges(QueueIndex);
+	}
+}
+
+void FSimThreadPool::RunRanges(int32_t QueueIndex)
+{
+	FRange Range;
+	while (PopRange(QueueIndex, Range) || StealRange(QueueIndex, Range))
+	{
+		// The task is only read once a range has been taken, so it always belongs to the ParallelFor the range came from.
+		const std::function<void(int32_t)>& Task = *CurrentTask.load();
+		for (int32_t i = Range.Begin; i < Range.End; i++)
+			Task(i);
+
+		const int32_t RangeCount = Range.End - Range.Begin;
+		if (Remaining.fetch_sub(RangeCount) == RangeCount)
+		{
+			std::lock_guard<std::mutex> Lock(PoolMutex);
+			DoneCondition.notify_all();
+		}
+	}
+}
+
+bool FSimThreadPool::PopRange(int32_t QueueIndex, FRange& OutRange)
+{
+	FQueue& Queue = *Queues[QueueIndex];
+	std::lock_guard<std::mutex> Lock(Queue.Mutex);
+	if (Queue.Ranges.empty())
+		return false;
+	OutRange = Queue.Ranges.back();
+	Queue.Ranges.pop_back();
+	return true;
+}
+
+bool FSimThreadPool::StealRange(int32_t QueueIndex, FRange& OutRange)
+{
+	const int32_t NumQueues = (int32_t)Queues.size();
+	for (int32_t Offset = 1; Offset < NumQueues; Offset++)
+	{
+		FQueue& Queue = *Queues[(QueueIndex + Offset) % NumQueues];
+		std::lock_guard<std::mutex> Lock(Queue.Mutex);
+		if (Queue.Ranges.empty())
+			continue;
+		OutRange = Queue.Ranges.front();
+		Queue.Ranges.pop_front();
+		return true;
+	}
+	return false;
+}
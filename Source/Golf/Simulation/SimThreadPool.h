@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// This file must not include any engine headers. It is shared by the game and by tools that run without the editor.
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A work stealing thread pool for running many simulations at once.
+ * Work is split into ranges and shared out between the threads. A thread that runs out of work steals ranges from the others.
+ */
+class FSimThreadPool
+{
+public:
+
+	// Start the pool. Zero threads uses one per core.
+	explicit FSimThreadPool(int32_t NumThreads = 0);
+	~FSimThreadPool();
+
+	FSimThreadPool(const FSimThreadPool&) = delete;
+	FSimThreadPool& operator=(const FSimThreadPool&) = delete;
+
+	// Call Task for every index from 0 to Count - 1 and wait for them all to finish. The calling thread helps out.
+	void ParallelFor(int32_t Count, const std::function<void(int32_t)>& Task);
+
+	// Returns the number of threads working on each ParallelFor, including the calling thread.
+	int32_t GetNumThreads() const { return (int32_t)Queues.size(); }
+
+private:
+
+	struct FRange
+	{
+		int32_t Begin, End;
+	};
+
+	// Each thread takes work from the back of its own queue and steals from the front of the others.
+	struct FQueue
+	{
+		std::mutex Mutex;
+		std::deque<FRange> Ranges;
+	};
+
+	void WorkerLoop(int32_t QueueIndex);
+
+	// Run ranges until there are none left to take.
+	void RunRanges(int32_t QueueIndex);
+
+	bool PopRange(int32_t QueueIndex, FRange& OutRange);
+	bool StealRange(int32_t QueueIndex, FRange& OutRange);
+
+	std::vector<std::unique_ptr<FQueue>> Queues;
+	std::vector<std::thread> Threads;
+
+	std::mutex PoolMutex;
+	std::condition_variable WorkCondition;
+	std::condition_variable DoneCondition;
+	uint64_t Generation = 0;
+	bool isStopping = false;
+
+	std::atomic<const std::function<void(int32_t)>*> CurrentTask;
+	std::atomic<int32_t> Remaining;
+};
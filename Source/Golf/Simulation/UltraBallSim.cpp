@@ -0,0 +1,446 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "UltraBallSim.h"
+#include <algorithm>
+
+void FSimWorld::Build(float InCellSize)
+{
+	CellSize = InCellSize;
+	Cells.clear();
+	CellColliders.clear();
+
+	// Work out which cells every collider's bounds overlap.
+	struct FEntry
+	{
+		int32_t X, Y, Z, Collider;
+		bool operator<(const FEntry& Other) const
+		{
+			if (X != Other.X) return X < Other.X;
+			if (Y != Other.Y) return Y < Other.Y;
+			if (Z != Other.Z) return Z < Other.Z;
+			return Collider < Other.Collider;
+		}
+	};
+	std::vector<FEntry> Entries;
+
+	const FSimGridView Grid = GetGrid();
+	auto AddBounds = [&](int32_t Collider, const FSimVector& Min, const FSimVector& Max)
+	{
+		int32_t MinX, MinY, MinZ, MaxX, MaxY, MaxZ;
+		Grid.GetCell(Min, MinX, MinY, MinZ);
+		Grid.GetCell(Max, MaxX, MaxY, MaxZ);
+		for (int32_t X = MinX; X <= MaxX; X++)
+			for (int32_t Y = MinY; Y <= MaxY; Y++)
+				for (int32_t Z = MinZ; Z <= MaxZ; Z++)
+					Entries.push_back({ X, Y, Z, Collider });
+	};
+
+	const int32_t NumBoxes = (int32_t)Boxes.size();
+	for (int32_t i = 0; i < NumBoxes; i++)
+	{
+		const FSimBox& Box = Boxes[i];
+		const FSimVector Extent(
+			std::fabs(Box.AxisX.X) * Box.HalfExtents.X + std::fabs(Box.AxisY.X) * Box.HalfExtents.Y + std::fabs(Box.AxisZ.X) * Box.HalfExtents.Z,
+			std::fabs(Box.AxisX.Y) * Box.HalfExtents.X + std::fabs(Box.AxisY.Y) * Box.HalfExtents.Y + std::fabs(Box.AxisZ.Y) * Box.HalfExtents.Z,
+			std::fabs(Box.AxisX.Z) * Box.HalfExtents.X + std::fabs(Box.AxisY.Z) * Box.HalfExtents.Y + std::fabs(Box.AxisZ.Z) * Box.HalfExtents.Z);
+		AddBounds(i, Box.Center - Extent, Box.Center + Extent);
+	}
+
+	for (int32_t i = 0; i < (int32_t)Triangles.size(); i++)
+	{
+		const FSimTriangle& Triangle = Triangles[i];
+		const FSimVector Min(std::min({ Triangle.A.X, Triangle.B.X, Triangle.C.X }), std::min({ Triangle.A.Y, Triangle.B.Y, Triangle.C.Y }), std::min({ Triangle.A.Z, Triangle.B.Z, Triangle.C.Z }));
+		const FSimVector Max(std::max({ Triangle.A.X, Triangle.B.X, Triangle.C.X }), std::max({ Triangle.A.Y, Triangle.B.Y, Triangle.C.Y }), std::max({ Triangle.A.Z, Triangle.B.Z, Triangle.C.Z }));
+		AddBounds(NumBoxes + i, Min, Max);
+	}
+
+	// Group the entries by cell. Cells end up sorted, so they can be found with a binary search.
+	std::sort(Entries.begin(), Entries.end());
+	CellColliders.reserve(Entries.size());
+	for (const FEntry& Entry : Entries)
+	{
+		if (Cells.empty() || Cells.back().X != Entry.X || Cells.back().Y != Entry.Y || Cells.back().Z != Entry.Z)
+			Cells.push_back({ Entry.X, Entry.Y, Entry.Z, (uint32_t)CellColliders.size(), 0 });
+		CellColliders.push_back(Entry.Collider);
+		Cells.back().Count++;
+	}
+}
+
+void FSimWorld::SetGrid(float InCellSize, const FSimGridCell* InCells, size_t NumCells, const int32_t* InColliders, size_t NumColliders)
+{
+	CellSize = InCellSize;
+	Cells.assign(InCells, InCells + NumCells);
+	CellColliders.assign(InColliders, InColliders + NumColliders);
+}
+
+void FSimGridView::FindColliders(const FSimVector& Center, float Radius, std::vector<int32_t>& OutColliders) const
+{
+	OutColliders.clear();
+
+	int32_t MinX, MinY, MinZ, MaxX, MaxY, MaxZ;
+	GetCell(Center - FSimVector(Radius, Radius, Radius), MinX, MinY, MinZ);
+	GetCell(Center + FSimVector(Radius, Radius, Radius), MaxX, MaxY, MaxZ);
+	for (int32_t X = MinX; X <= MaxX; X++)
+		for (int32_t Y = MinY; Y <= MaxY; Y++)
+			for (int32_t Z = MinZ; Z <= MaxZ; Z++)
+			{
+				const FSimGridCell* Cell = FindCell(X, Y, Z);
+				if (Cell != nullptr)
+					OutColliders.insert(OutColliders.end(), Colliders + Cell->First, Colliders + Cell->First + Cell->Count);
+			}
+
+	// A collider can be in more than one of the cells, so remove the duplicates.
+	std::sort(OutColliders.begin(), OutColliders.end());
+	OutColliders.erase(std::unique(OutColliders.begin(), OutColliders.end()), OutColliders.end());
+}
+
+void FSimGridView::GetCell(const FSimVector& Location, int32_t& OutX, int32_t& OutY, int32_t& OutZ) const
+{
+	OutX = (int32_t)std::floor(Location.X / CellSize);
+	OutY = (int32_t)std::floor(Location.Y / CellSize);
+	OutZ = (int32_t)std::floor(Location.Z / CellSize);
+}
+
+const FSimGridCell* FSimGridView::FindCell(int32_t X, int32_t Y, int32_t Z) const
+{
+	const FSimGridCell* End = Cells + NumCells;
+	const FSimGridCell* It = std::lower_bound(Cells, End, FSimGridCell{ X, Y, Z, 0, 0 }, [](const FSimGridCell& A, const FSimGridCell& B)
+	{
+		if (A.X != B.X) return A.X < B.X;
+		if (A.Y != B.Y) return A.Y < B.Y;
+		return A.Z < B.Z;
+	});
+	if (It == End || It->X != X || It->Y != Y || It->Z != Z)
+		return nullptr;
+	return It;
+}
+
+FSimVector FUltraBallSim::GetLaunchVelocity(const FSimVector& Direction, float CurrentCharge, float MaxChargePossibleAtFullChargeUp)
+{
+	const float ChargeAmount = CurrentCharge * MaxChargePossibleAtFullChargeUp;
+	return Direction.GetSafeNormal() * ChargeAmount * 1000.0f;
+}
+
+FSimVector FUltraBallSim::GetBumperVelocity(const FSimVector& Forward, float BouncePower)
+{
+	return Forward * BouncePower * 1000.0f;
+}
+
+FSimVector FUltraBallSim::GetLauncherVelocity(const FSimVector& LaunchDirection, float LaunchPower)
+{
+	return LaunchDirection * LaunchPower * 1000.0f;
+}
+
+FSimFieldPull FUltraBallSim::GetFieldPull(const FSimVector& Location, const FSimField* Fields, int32_t NumFields, float GravityZ, float DeltaTime)
+{
+	FSimFieldPull Pull;
+	if (NumFields <= 0 || DeltaTime <= 0.0f)
+		return Pull;
+
+	// Pull towards every field at once. The pull is capped at the fastest field so overlapping fields don't stack up speed.
+	float MaxPullSpeed = 0.0f;
+	float NearestDistanceSquared = 0.0f;
+	for (int32_t i = 0; i < NumFields; i++)
+	{
+		const FSimVector ToCenter = Fields[i].Center - Location;
+		Pull.Velocity += ToCenter.GetSafeNormal() * Fields[i].PullSpeed;
+		MaxPullSpeed = std::max(MaxPullSpeed, Fields[i].PullSpeed);
+		if (Pull.NearestIndex < 0 || ToCenter.SizeSquared() < NearestDistanceSquared)
+		{
+			Pull.NearestIndex = i;
+			NearestDistanceSquared = ToCenter.SizeSquared();
+		}
+	}
+	const float PullSpeed = Pull.Velocity.Size();
+	if (PullSpeed > MaxPullSpeed)
+		Pull.Velocity = Pull.Velocity * (MaxPullSpeed / PullSpeed);
+	Pull.Result = ESimFieldResult::Pulling;
+
+	// Once UltraBall reaches the center of the nearest field, stop exactly on it rather than overshooting.
+	const FSimField& Nearest = Fields[Pull.NearestIndex];
+	const FSimVector ToCenter = Nearest.Center - Location;
+	if (ToCenter.Size() <= std::max(Nearest.CaptureRadius, MaxPullSpeed * DeltaTime))
+	{
+		if (Nearest.isLauncher)
+		{
+			Pull.Result = ESimFieldResult::Launched;
+			Pull.Velocity = GetLauncherVelocity(Nearest.LaunchDirection, Nearest.LaunchPower);
+			return Pull;
+		}
+		Pull.Velocity = ToCenter / DeltaTime;
+	}
+
+	// The fields replace gravity, so cancel out the gravity this step is about to apply.
+	Pull.Velocity.Z -= GravityZ * DeltaTime;
+	return Pull;
+}
+
+bool FUltraBallSim::IsInsideBox(const FSimVector& Point, const FSimBox& Box)
+{
+	const FSimVector Offset = Point - Box.Center;
+	return std::fabs(Offset.Dot(Box.AxisX)) <= Box.HalfExtents.X
+		&& std::fabs(Offset.Dot(Box.AxisY)) <= Box.HalfExtents.Y
+		&& std::fabs(Offset.Dot(Box.AxisZ)) <= Box.HalfExtents.Z;
+}
+
+bool FUltraBallSim::CollideSphereBox(const FSimVector& Center, float Radius, const FSimBox& Box, FSimVector& OutNormal, float& OutDepth)
+{
+	// Move the sphere into the box's space.
+	const FSimVector Offset = Center - Box.Center;
+	const float Local[3] = { Offset.Dot(Box.AxisX), Offset.Dot(Box.AxisY), Offset.Dot(Box.AxisZ) };
+	const float Extents[3] = { Box.HalfExtents.X, Box.HalfExtents.Y, Box.HalfExtents.Z };
+	const FSimVector Axes[3] = { Box.AxisX, Box.AxisY, Box.AxisZ };
+
+	// Find the closest point on the box.
+	bool isInside = true;
+	FSimVector Closest = Box.Center;
+	for (int i = 0; i < 3; i++)
+	{
+		float Clamped = Local[i];
+		if (Clamped > Extents[i]) { Clamped = Extents[i]; isInside = false; }
+		if (Clamped < -Extents[i]) { Clamped = -Extents[i]; isInside = false; }
+		Closest += Axes[i] * Clamped;
+	}
+
+	// If the center is inside the box, push it out through the nearest face.
+	if (isInside)
+	{
+		int BestAxis = 0;
+		float BestDistance = Extents[0] - std::fabs(Local[0]);
+		for (int i = 1; i < 3; i++)
+		{
+			const float Distance = Extents[i] - std::fabs(Local[i]);
+			if (Distance < BestDistance)
+			{
+				BestAxis = i;
+				BestDistance = Distance;
+			}
+		}
+		OutNormal = Local[BestAxis] >= 0.0f ? Axes[BestAxis] : -Axes[BestAxis];
+		OutDepth = BestDistance + Radius;
+		return true;
+	}
+
+	const FSimVector Separation = Center - Closest;
+	const float DistanceSquared = Separation.SizeSquared();
+	if (DistanceSquared >= Radius * Radius)
+		return false;
+
+	const float Distance = std::sqrt(DistanceSquared);
+	OutNormal = Distance > 1.e-6f ? Separation / Distance : Box.AxisZ;
+	OutDepth = Radius - Distance;
+	return true;
+}
+
+FSimVector FUltraBallSim::GetClosestPointOnTriangle(const FSimVector& Point, const FSimTriangle& Triangle)
+{
+	// Work out which of the triangle's regions the point is closest to, using barycentric coordinates.
+	const FSimVector& A = Triangle.A;
+	const FSimVector& B = Triangle.B;
+	const FSimVector& C = Triangle.C;
+	const FSimVector AB = B - A;
+	const FSimVector AC = C - A;
+	const FSimVector AP = Point - A;
+
+	const float D1 = AB.Dot(AP);
+	const float D2 = AC.Dot(AP);
+	const FSimVector BP = Point - B;
+	const float D3 = AB.Dot(BP);
+	const float D4 = AC.Dot(BP);
+	const FSimVector CP = Point - C;
+	const float D5 = AB.Dot(CP);
+	const float D6 = AC.Dot(CP);
+	const float VC = D1 * D4 - D3 * D2;
+	const float VB = D5 * D2 - D1 * D6;
+	const float VA = D3 * D6 - D5 * D4;
+
+	if (D1 <= 0.0f && D2 <= 0.0f)
+		return A;
+	if (D3 >= 0.0f && D4 <= D3)
+		return B;
+	if (D6 >= 0.0f && D5 <= D6)
+		return C;
+	if (VC <= 0.0f && D1 >= 0.0f && D3 <= 0.0f)
+		return A + AB * (D1 / (D1 - D3));
+	if (VB <= 0.0f && D2 >= 0.0f && D6 <= 0.0f)
+		return A + AC * (D2 / (D2 - D6));
+	if (VA <= 0.0f && (D4 - D3) >= 0.0f && (D5 - D6) >= 0.0f)
+		return B + (C - B) * ((D4 - D3) / ((D4 - D3) + (D5 - D6)));
+
+	const float Denominator = 1.0f / (VA + VB + VC);
+	return A + AB * (VB * Denominator) + AC * (VC * Denominator);
+}
+
+float FUltraBallSim::GetBoxDistance(const FSimVector& Point, const FSimBox& Box)
+{
+	// Measure in the box's space. Outside, this is the distance to the nearest point. Inside, it is minus the distance to the nearest face.
+	const FSimVector Offset = Point - Box.Center;
+	const FSimVector Local(std::fabs(Offset.Dot(Box.AxisX)) - Box.HalfExtents.X, std::fabs(Offset.Dot(Box.AxisY)) - Box.HalfExtents.Y, std::fabs(Offset.Dot(Box.AxisZ)) - Box.HalfExtents.Z);
+	const FSimVector Outside(std::max(Local.X, 0.0f), std::max(Local.Y, 0.0f), std::max(Local.Z, 0.0f));
+	return Outside.Size() + std::min(std::max(Local.X, std::max(Local.Y, Local.Z)), 0.0f);
+}
+
+bool FUltraBallSim::CollideSphereTriangle(const FSimVector& Center, float Radius, const FSimTriangle& Triangle, FSimVector& OutNormal, float& OutDepth)
+{
+	const FSimVector Separation = Center - GetClosestPointOnTriangle(Center, Triangle);
+	const float DistanceSquared = Separation.SizeSquared();
+	if (DistanceSquared >= Radius * Radius)
+		return false;
+
+	const float Distance = std::sqrt(DistanceSquared);
+	OutNormal = Distance > 1.e-6f ? Separation / Distance : (Triangle.B - Triangle.A).Cross(Triangle.C - Triangle.A).GetSafeNormal();
+	OutDepth = Radius - Distance;
+	return true;
+}
+
+void FUltraBallSim::Step(const FSimWorld& World, const FSimSettings& Settings, FSimBallState& State)
+{
+	if (State.isFinished || State.isOutOfBounds)
+		return;
+
+	const float DeltaTime = Settings.TimeStep;
+
+	// Gather the fields UltraBall is in. Fields it has been fired out of are ignored until it has left them.
+	FSimField ActiveFields[8];
+	int32_t NumActiveFields = 0;
+	std::vector<int32_t> StillInside;
+	for (const FSimField& Field : World.Fields)
+	{
+		if ((State.Location - Field.Center).SizeSquared() > Field.Radius * Field.Radius)
+			continue;
+		if (std::find(State.ReleasedFieldIds.begin(), State.ReleasedFieldIds.end(), Field.Id) != State.ReleasedFieldIds.end())
+			StillInside.push_back(Field.Id);
+		else if (NumActiveFields < 8)
+			ActiveFields[NumActiveFields++] = Field;
+	}
+	State.ReleasedFieldIds.swap(StillInside);
+
+	// Fields set UltraBall's velocity directly. Otherwise it falls under gravity.
+	const FSimFieldPull Pull = GetFieldPull(State.Location, ActiveFields, NumActiveFields, Settings.GravityZ, DeltaTime);
+	if (Pull.Result == ESimFieldResult::Launched)
+	{
+		for (int32_t i = 0; i < NumActiveFields; i++)
+			State.ReleasedFieldIds.push_back(ActiveFields[i].Id);
+	}
+	if (Pull.Result != ESimFieldResult::None)
+		State.Velocity = Pull.Velocity;
+	State.Velocity.Z += Settings.GravityZ * DeltaTime;
+
+	// Clamp to the terminal velocity set in the physics settings.
+	const float Speed = State.Velocity.Size();
+	if (Speed > Settings.TerminalVelocity)
+		State.Velocity = State.Velocity * (Settings.TerminalVelocity / Speed);
+
+	State.Location += State.Velocity * DeltaTime;
+
+	// Bumpers fire UltraBall once each time it enters their trigger.
+	for (int32_t i = 0; i < (int32_t)World.Bumpers.size(); i++)
+	{
+		const FSimBumper& Bumper = World.Bumpers[i];
+		auto Inside = std::find(State.InsideBumpers.begin(), State.InsideBumpers.end(), i);
+		FSimVector Normal;
+		float Depth;
+		if (CollideSphereBox(State.Location, Settings.BallRadius, Bumper.Trigger, Normal, Depth))
+		{
+			if (Inside == State.InsideBumpers.end())
+			{
+				State.Velocity = GetBumperVelocity(Bumper.Forward, Bumper.BouncePower);
+				State.InsideBumpers.push_back(i);
+			}
+		}
+		else if (Inside != State.InsideBumpers.end())
+			State.InsideBumpers.erase(Inside);
+	}
+
+	// Push UltraBall out of anything it has hit and bounce off it.
+	std::vector<int32_t> Colliders;
+	World.FindColliders(State.Location, Settings.BallRadius, Colliders);
+	const int32_t NumBoxes = (int32_t)World.Boxes.size();
+	bool isTouching = false;
+	for (int32_t Collider : Colliders)
+	{
+		FSimVector Normal;
+		float Depth;
+		const bool isHit = Collider < NumBoxes
+			? CollideSphereBox(State.Location, Settings.BallRadius, World.Boxes[Collider], Normal, Depth)
+			: CollideSphereTriangle(State.Location, Settings.BallRadius, World.Triangles[Collider - NumBoxes], Normal, Depth);
+		if (!isHit)
+			continue;
+
+		isTouching = true;
+		State.Location += Normal * Depth;
+
+		const float NormalSpeed = State.Velocity.Dot(Normal);
+		if (NormalSpeed >= 0.0f)
+			continue;
+
+		// Bounce if the impact is fast enough, otherwise just stop moving into the surface.
+		const FSimVector NormalVelocity = Normal * NormalSpeed;
+		FSimVector TangentVelocity = State.Velocity - NormalVelocity;
+		const float BounceSpeed = -NormalSpeed > Settings.BounceThresholdVelocity ? -NormalSpeed * Settings.Restitution : 0.0f;
+
+		// Friction takes away tangential speed in proportion to the impact.
+		const float TangentSpeed = TangentVelocity.Size();
+		if (TangentSpeed > 0.0f)
+		{
+			const float FrictionLoss = std::min(TangentSpeed, -NormalSpeed * Settings.Friction);
+			TangentVelocity = TangentVelocity * ((TangentSpeed - FrictionLoss) / TangentSpeed);
+		}
+		State.Velocity = TangentVelocity + Normal * BounceSpeed;
+	}
+
+	// Rolling along the ground slowly bleeds off speed.
+	if (isTouching)
+		State.Velocity = State.Velocity * std::max(0.0f, 1.0f - Settings.RollingDamping * DeltaTime);
+
+	// Check for the Finish Target.
+	for (const FSimFinish& Finish : World.Finishes)
+	{
+		const float Reach = Finish.Radius + Settings.BallRadius;
+		if ((State.Location - Finish.Center).SizeSquared() <= Reach * Reach)
+			State.isFinished = true;
+	}
+
+	if (State.Location.Z < Settings.KillZ)
+		State.isOutOfBounds = true;
+
+	// UltraBall comes to rest once it has been slow for long enough. Fields keep it awake.
+	if (Pull.Result == ESimFieldResult::None && State.Velocity.Size() < Settings.RestSpeed && isTouching)
+		State.RestTimer += DeltaTime;
+	else
+		State.RestTimer = 0.0f;
+	State.isAtRest = State.RestTimer >= Settings.RestTime || (Pull.Result == ESimFieldResult::Pulling && State.Velocity.Size() < Settings.RestSpeed);
+}
+
+FSimShotResult FUltraBallSim::SimulateShot(const FSimWorld& World, const FSimSettings& Settings, const FSimBallState& StartState, const FSimVector& LaunchVelocity, float MaxTime, std::vector<FSimVector>* OutPath)
+{
+	FSimShotResult Result;
+	Result.FinalState = StartState;
+	FSimBallState& State = Result.FinalState;
+
+	// Firing releases UltraBall from any field it is in, matching ABall::EndFire.
+	for (const FSimField& Field : World.Fields)
+	{
+		if ((State.Location - Field.Center).SizeSquared() <= Field.Radius * Field.Radius)
+			State.ReleasedFieldIds.push_back(Field.Id);
+	}
+	State.Velocity = LaunchVelocity;
+	State.RestTimer = 0.0f;
+	State.isAtRest = false;
+
+	if (OutPath != nullptr)
+		OutPath->push_back(State.Location);
+
+	const int32_t MaxSteps = (int32_t)std::ceil(MaxTime / Settings.TimeStep);
+	while (Result.Steps < MaxSteps)
+	{
+		Step(World, Settings, State);
+		Result.Steps++;
+		if (OutPath != nullptr)
+			OutPath->push_back(State.Location);
+		if (State.isAtRest || State.isFinished || State.isOutOfBounds)
+			break;
+	}
+	Result.Time = Result.Steps * Settings.TimeStep;
+	return Result;
+}
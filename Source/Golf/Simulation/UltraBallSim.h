@@ -0,0 +1,258 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// This file must not include any engine headers. It is shared by the game and by tools that run without the editor.
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// A plain 3D vector used by the simulation.
+struct FSimVector
+{
+	float X, Y, Z;
+
+	FSimVector() : X(0.0f), Y(0.0f), Z(0.0f) {}
+	FSimVector(float InX, float InY, float InZ) : X(InX), Y(InY), Z(InZ) {}
+
+	FSimVector operator+(const FSimVector& V) const { return FSimVector(X + V.X, Y + V.Y, Z + V.Z); }
+	FSimVector operator-(const FSimVector& V) const { return FSimVector(X - V.X, Y - V.Y, Z - V.Z); }
+	FSimVector operator*(float Scale) const { return FSimVector(X * Scale, Y * Scale, Z * Scale); }
+	FSimVector operator/(float Scale) const { return FSimVector(X / Scale, Y / Scale, Z / Scale); }
+	FSimVector operator-() const { return FSimVector(-X, -Y, -Z); }
+	FSimVector& operator+=(const FSimVector& V) { X += V.X; Y += V.Y; Z += V.Z; return *this; }
+	FSimVector& operator-=(const FSimVector& V) { X -= V.X; Y -= V.Y; Z -= V.Z; return *this; }
+
+	float Dot(const FSimVector& V) const { return X * V.X + Y * V.Y + Z * V.Z; }
+	FSimVector Cross(const FSimVector& V) const { return FSimVector(Y * V.Z - Z * V.Y, Z * V.X - X * V.Z, X * V.Y - Y * V.X); }
+	float SizeSquared() const { return Dot(*this); }
+	float Size() const { return std::sqrt(SizeSquared()); }
+
+	// Returns a unit vector, or zero if the vector is too small to normalise.
+	FSimVector GetSafeNormal() const
+	{
+		const float SquareSum = SizeSquared();
+		return SquareSum > 1.e-8f ? *this * (1.0f / std::sqrt(SquareSum)) : FSimVector();
+	}
+};
+
+// A box collider. The axes must be unit length and at right angles to each other.
+struct FSimBox
+{
+	FSimVector Center;
+	FSimVector HalfExtents;
+	FSimVector AxisX = FSimVector(1.0f, 0.0f, 0.0f);
+	FSimVector AxisY = FSimVector(0.0f, 1.0f, 0.0f);
+	FSimVector AxisZ = FSimVector(0.0f, 0.0f, 1.0f);
+};
+
+// A single triangle of a mesh collider.
+struct FSimTriangle
+{
+	FSimVector A, B, C;
+};
+
+// A Bumper. UltraBall is fired along Forward when it enters the trigger box.
+struct FSimBumper
+{
+	FSimBox Trigger;
+	FSimVector Forward;
+	float BouncePower = 2.0f;
+};
+
+// A Gravity or Launcher field, matching FGravityField in the game.
+struct FSimField
+{
+	int32_t Id = -1;
+	bool isLauncher = false;
+	FSimVector Center;
+	float Radius = 0.0f;
+	float PullSpeed = 800.0f;
+	float CaptureRadius = 10.0f;
+	FSimVector LaunchDirection;
+	float LaunchPower = 0.0f;
+};
+
+// The Finish Target. Touching it finishes the level.
+struct FSimFinish
+{
+	FSimVector Center;
+	float Radius = 0.0f;
+};
+
+// Tunable values for the simulation. The defaults match DefaultEngine.ini and ABall.
+struct FSimSettings
+{
+	float GravityZ = -980.0f;
+	float TerminalVelocity = 4000.0f;
+	float TimeStep = 1.0f / 120.0f;
+	float BallRadius = 30.0f;
+	float Restitution = 0.5f;
+	float Friction = 0.7f;
+	float BounceThresholdVelocity = 200.0f;
+	float RollingDamping = 0.5f;
+
+	// UltraBall is at rest once it has been slower than RestSpeed for RestTime.
+	float RestSpeed = 5.0f;
+	float RestTime = 0.5f;
+
+	// UltraBall is out of the level below this height.
+	float KillZ = -10000.0f;
+
+	// Size of each cell in the collision grid.
+	float GridCellSize = 500.0f;
+};
+
+// What a set of fields does to UltraBall for one step.
+enum class ESimFieldResult : uint8_t
+{
+	// Not in any field.
+	None,
+
+	// Being pulled towards a center, or held on it.
+	Pulling,
+
+	// Launched out of a Launcher field.
+	Launched
+};
+
+// The velocity a set of fields gives UltraBall for one step.
+struct FSimFieldPull
+{
+	ESimFieldResult Result = ESimFieldResult::None;
+	FSimVector Velocity;
+	int32_t NearestIndex = -1;
+};
+
+// The state of UltraBall.
+struct FSimBallState
+{
+	FSimVector Location;
+	FSimVector Velocity;
+	float RestTimer = 0.0f;
+	bool isAtRest = false;
+	bool isFinished = false;
+	bool isOutOfBounds = false;
+
+	// Fields UltraBall has been fired out of and is still inside. These are ignored until it leaves them.
+	std::vector<int32_t> ReleasedFieldIds;
+
+	// Bumpers UltraBall is currently inside, so each one only fires once per visit.
+	std::vector<int32_t> InsideBumpers;
+};
+
+// The result of simulating a single shot.
+struct FSimShotResult
+{
+	FSimBallState FinalState;
+	float Time = 0.0f;
+	int32_t Steps = 0;
+};
+
+// A cell of the collision grid. Its colliders are Count entries of the collider list starting at First.
+struct FSimGridCell
+{
+	int32_t X, Y, Z;
+	uint32_t First, Count;
+};
+
+/**
+ * A read only view of a collision grid. The grid can live in an FSimWorld or in a memory mapped Level Snapshot.
+ * Cells are sorted by X, then Y, then Z, so a cell is found with a binary search.
+ */
+struct FSimGridView
+{
+	float CellSize = 500.0f;
+	const FSimGridCell* Cells = nullptr;
+	size_t NumCells = 0;
+	const int32_t* Colliders = nullptr;
+
+	// Find the colliders in every cell a sphere overlaps, without duplicates.
+	// This is safe to call from many threads at once.
+	void FindColliders(const FSimVector& Center, float Radius, std::vector<int32_t>& OutColliders) const;
+
+	// Returns the grid cell that contains this location.
+	void GetCell(const FSimVector& Location, int32_t& OutX, int32_t& OutY, int32_t& OutZ) const;
+
+	// Returns the cell, or null if it is empty.
+	const FSimGridCell* FindCell(int32_t X, int32_t Y, int32_t Z) const;
+};
+
+/**
+ * The static level UltraBall plays in.
+ * Call Build once all of the colliders are added, so they can be sorted into the collision grid.
+ */
+class FSimWorld
+{
+public:
+	std::vector<FSimBox> Boxes;
+	std::vector<FSimTriangle> Triangles;
+	std::vector<FSimBumper> Bumpers;
+	std::vector<FSimField> Fields;
+	std::vector<FSimFinish> Finishes;
+
+	// Sort the colliders into the collision grid.
+	void Build(float CellSize);
+
+	// Use a collision grid that has already been built, such as one loaded from a Level Snapshot.
+	void SetGrid(float InCellSize, const FSimGridCell* InCells, size_t NumCells, const int32_t* InColliders, size_t NumColliders);
+
+	// Returns a view of the collision grid.
+	FSimGridView GetGrid() const { return { CellSize, Cells.data(), Cells.size(), CellColliders.data() }; }
+	size_t GetNumCellColliders() const { return CellColliders.size(); }
+
+	// Find the boxes and triangles that might touch a sphere. Indices below the number of boxes are boxes, the rest are triangles.
+	// This is safe to call from many threads at once.
+	void FindColliders(const FSimVector& Center, float Radius, std::vector<int32_t>& OutColliders) const { GetGrid().FindColliders(Center, Radius, OutColliders); }
+
+private:
+
+	float CellSize = 500.0f;
+	std::vector<FSimGridCell> Cells;
+	std::vector<int32_t> CellColliders;
+};
+
+/**
+ * The gameplay rules of UltraBall, written without the engine.
+ * ABall, ABumper and AGravityWell call these same functions, so the game and offline tools can't drift apart.
+ */
+class FUltraBallSim
+{
+public:
+
+	// The velocity a shot gives UltraBall. CurrentCharge is a fraction of a full charge, from 0 to 1, so a full charge
+	// fires at MaxChargePossibleAtFullChargeUp * 1000. Matches the impulse ABall::EndFire used to apply.
+	static FSimVector GetLaunchVelocity(const FSimVector& Direction, float CurrentCharge, float MaxChargePossibleAtFullChargeUp);
+
+	// The velocity a Bumper gives UltraBall. Matches the impulse of Mass * BouncePower * 1000 applied by ABumper.
+	static FSimVector GetBumperVelocity(const FSimVector& Forward, float BouncePower);
+
+	// The velocity a Launcher field gives UltraBall once it reaches the center.
+	static FSimVector GetLauncherVelocity(const FSimVector& LaunchDirection, float LaunchPower);
+
+	// Combine every field UltraBall is inside into the velocity it should have for this step.
+	// Fields replace gravity, so the returned pull already cancels out the gravity the step will apply.
+	static FSimFieldPull GetFieldPull(const FSimVector& Location, const FSimField* Fields, int32_t NumFields, float GravityZ, float DeltaTime);
+
+	// Advance UltraBall by one fixed step.
+	static void Step(const FSimWorld& World, const FSimSettings& Settings, FSimBallState& State);
+
+	// Fire UltraBall from a state and simulate it until it rests, finishes, falls out or runs out of time.
+	// If OutPath is given, the location at every step is recorded into it.
+	static FSimShotResult SimulateShot(const FSimWorld& World, const FSimSettings& Settings, const FSimBallState& StartState, const FSimVector& LaunchVelocity, float MaxTime, std::vector<FSimVector>* OutPath = nullptr);
+
+	// Push a sphere out of a box. Returns false if they don't touch.
+	static bool CollideSphereBox(const FSimVector& Center, float Radius, const FSimBox& Box, FSimVector& OutNormal, float& OutDepth);
+
+	// Push a sphere out of a triangle. Returns false if they don't touch.
+	static bool CollideSphereTriangle(const FSimVector& Center, float Radius, const FSimTriangle& Triangle, FSimVector& OutNormal, float& OutDepth);
+
+	// Returns the closest point on a triangle to a point.
+	static FSimVector GetClosestPointOnTriangle(const FSimVector& Point, const FSimTriangle& Triangle);
+
+	// Returns how far a point is from the surface of a box. This is negative inside the box.
+	static float GetBoxDistance(const FSimVector& Point, const FSimBox& Box);
+
+	// Returns whether a point is inside a box.
+	static bool IsInsideBox(const FSimVector& Point, const FSimBox& Box);
+};
@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GravityFieldSubsystem.h"
+#include "Simulation/UltraBallSim.h"
+
+// Conversions between the engine types and the types used by the UltraBall simulation.
+namespace UltraBallSim
+{
+	inline FSimVector ToSim(const FVector& Vector)
+	{
+		return FSimVector(Vector.X, Vector.Y, Vector.Z);
+	}
+
+	inline FVector FromSim(const FSimVector& Vector)
+	{
+		return FVector(Vector.X, Vector.Y, Vector.Z);
+	}
+
+	inline FSimField ToSim(const FGravityField& Field)
+	{
+		FSimField SimField;
+		SimField.Id = Field.Id;
+		SimField.isLauncher = Field.Type == EGravityFieldType::Launcher;
+		SimField.Center = ToSim(Field.Center);
+		SimField.Radius = Field.Radius;
+		SimField.PullSpeed = Field.PullSpeed;
+		SimField.CaptureRadius = Field.CaptureRadius;
+		SimField.LaunchDirection = ToSim(Field.LaunchDirection);
+		SimField.LaunchPower = Field.LaunchPower;
+		return SimField;
+	}
+}
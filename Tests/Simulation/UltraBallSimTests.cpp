@@ -0,0 +1,762 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+// Checks the engine-free simulation in Source/Golf/Simulation without the editor. Built and run by Scripts/RunSimTests.sh.
+// This lives outside Source so the game module doesn't pick up its main.
+#include "UltraBallSim.h"
+#include "BatchIntegrator.h"
+#include "Replay.h"
+#include "LevelSnapshot.h"
+#include "DistanceField.h"
+#include "ParSolver.h"
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static int NumFailures = 0;
+
+#define CHECK(Condition) \
+	do { if (!(Condition)) { std::printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #Condition); NumFailures++; } } while (0)
+
+static bool IsNear(float A, float B, float Tolerance = 1.e-3f)
+{
+	return std::fabs(A - B) <= Tolerance;
+}
+
+static bool IsNear(const FSimVector& A, const FSimVector& B, float Tolerance = 1.e-3f)
+{
+	return IsNear(A.X, B.X, Tolerance) && IsNear(A.Y, B.Y, Tolerance) && IsNear(A.Z, B.Z, Tolerance);
+}
+
+// Returns a path for a scratch file. RunSimTests.sh points TMPDIR at a folder it removes afterwards.
+static std::string GetScratchPath(const char* Name)
+{
+	const char* Folder = std::getenv("TMPDIR");
+	if (Folder == nullptr)
+		Folder = std::getenv("TEMP");
+	return std::string(Folder != nullptr ? Folder : ".") + "/" + Name;
+}
+
+static bool WriteScratchFile(const std::string& Path, const std::vector<uint8_t>& Bytes)
+{
+	FILE* File = std::fopen(Path.c_str(), "wb");
+	if (File == nullptr)
+		return false;
+
+	const bool isWritten = Bytes.empty() || std::fwrite(Bytes.data(), 1, Bytes.size(), File) == Bytes.size();
+	return std::fclose(File) == 0 && isWritten;
+}
+
+static bool ReadScratchFile(const std::string& Path, std::vector<uint8_t>& OutBytes)
+{
+	FILE* File = std::fopen(Path.c_str(), "rb");
+	if (File == nullptr)
+		return false;
+
+	OutBytes.clear();
+	uint8_t Buffer[4096];
+	size_t Read;
+	while ((Read = std::fread(Buffer, 1, sizeof(Buffer), File)) > 0)
+		OutBytes.insert(OutBytes.end(), Buffer, Buffer + Read);
+	std::fclose(File);
+	return true;
+}
+
+static void TestCollideSphereBox()
+{
+	FSimBox Box;
+	Box.HalfExtents = FSimVector(50.0f, 50.0f, 50.0f);
+	FSimVector Normal;
+	float Depth;
+
+	// Resting on top of the box.
+	CHECK(FUltraBallSim::CollideSphereBox(FSimVector(0.0f, 0.0f, 70.0f), 30.0f, Box, Normal, Depth));
+	CHECK(IsNear(Normal, FSimVector(0.0f, 0.0f, 1.0f)));
+	CHECK(IsNear(Depth, 10.0f));
+
+	// Clear of the box.
+	CHECK(!FUltraBallSim::CollideSphereBox(FSimVector(0.0f, 0.0f, 90.0f), 30.0f, Box, Normal, Depth));
+
+	// Against an edge, the push is along the diagonal.
+	CHECK(FUltraBallSim::CollideSphereBox(FSimVector(60.0f, 0.0f, 60.0f), 30.0f, Box, Normal, Depth));
+	CHECK(IsNear(Normal, FSimVector(0.70710678f, 0.0f, 0.70710678f)));
+	CHECK(IsNear(Depth, 30.0f - 14.1421356f));
+
+	// With the center inside, the sphere is pushed out through the nearest face.
+	CHECK(FUltraBallSim::CollideSphereBox(FSimVector(0.0f, -40.0f, 0.0f), 30.0f, Box, Normal, Depth));
+	CHECK(IsNear(Normal, FSimVector(0.0f, -1.0f, 0.0f)));
+	CHECK(IsNear(Depth, 40.0f));
+
+	// A box turned 90 degrees about Z swaps its X and Y extents.
+	FSimBox Turned;
+	Turned.HalfExtents = FSimVector(100.0f, 10.0f, 10.0f);
+	Turned.AxisX = FSimVector(0.0f, 1.0f, 0.0f);
+	Turned.AxisY = FSimVector(-1.0f, 0.0f, 0.0f);
+	CHECK(FUltraBallSim::CollideSphereBox(FSimVector(0.0f, 120.0f, 0.0f), 30.0f, Turned, Normal, Depth));
+	CHECK(IsNear(Normal, FSimVector(0.0f, 1.0f, 0.0f)));
+	CHECK(!FUltraBallSim::CollideSphereBox(FSimVector(120.0f, 0.0f, 0.0f), 30.0f, Turned, Normal, Depth));
+}
+
+static void TestCollideSphereTriangle()
+{
+	FSimTriangle Triangle;
+	Triangle.A = FSimVector(-100.0f, -100.0f, 0.0f);
+	Triangle.B = FSimVector(100.0f, -100.0f, 0.0f);
+	Triangle.C = FSimVector(0.0f, 100.0f, 0.0f);
+	FSimVector Normal;
+	float Depth;
+
+	// Above and below the face.
+	CHECK(FUltraBallSim::CollideSphereTriangle(FSimVector(0.0f, 0.0f, 20.0f), 30.0f, Triangle, Normal, Depth));
+	CHECK(IsNear(Normal, FSimVector(0.0f, 0.0f, 1.0f)));
+	CHECK(IsNear(Depth, 10.0f));
+	CHECK(FUltraBallSim::CollideSphereTriangle(FSimVector(0.0f, 0.0f, -20.0f), 30.0f, Triangle, Normal, Depth));
+	CHECK(IsNear(Normal, FSimVector(0.0f, 0.0f, -1.0f)));
+
+	// Clear of the face.
+	CHECK(!FUltraBallSim::CollideSphereTriangle(FSimVector(0.0f, 0.0f, 40.0f), 30.0f, Triangle, Normal, Depth));
+
+	// Against an edge and a corner.
+	CHECK(FUltraBallSim::CollideSphereTriangle(FSimVector(0.0f, -120.0f, 0.0f), 30.0f, Triangle, Normal, Depth));
+	CHECK(IsNear(Normal, FSimVector(0.0f, -1.0f, 0.0f)));
+	CHECK(IsNear(Depth, 10.0f));
+	CHECK(FUltraBallSim::CollideSphereTriangle(FSimVector(0.0f, 120.0f, 0.0f), 30.0f, Triangle, Normal, Depth));
+	CHECK(IsNear(Normal, FSimVector(0.0f, 1.0f, 0.0f)));
+	CHECK(!FUltraBallSim::CollideSphereTriangle(FSimVector(-140.0f, -140.0f, 0.0f), 30.0f, Triangle, Normal, Depth));
+}
+
+static void TestFieldPull()
+{
+	const float GravityZ = -980.0f;
+	const float DeltaTime = 1.0f / 120.0f;
+	FSimField Field;
+	Field.Id = 1;
+	Field.Radius = 500.0f;
+	Field.PullSpeed = 800.0f;
+	Field.CaptureRadius = 10.0f;
+
+	// Outside every field nothing happens.
+	CHECK(FUltraBallSim::GetFieldPull(FSimVector(), nullptr, 0, GravityZ, DeltaTime).Result == ESimFieldResult::None);
+
+	// Pulled towards the center at the field's speed, with gravity cancelled out.
+	FSimFieldPull Pull = FUltraBallSim::GetFieldPull(FSimVector(200.0f, 0.0f, 0.0f), &Field, 1, GravityZ, DeltaTime);
+	CHECK(Pull.Result == ESimFieldResult::Pulling);
+	CHECK(Pull.NearestIndex == 0);
+	CHECK(IsNear(Pull.Velocity, FSimVector(-800.0f, 0.0f, -GravityZ * DeltaTime)));
+
+	// Captured on the center, stopping exactly on it rather than overshooting.
+	Pull = FUltraBallSim::GetFieldPull(FSimVector(5.0f, 0.0f, 0.0f), &Field, 1, GravityZ, DeltaTime);
+	CHECK(Pull.Result == ESimFieldResult::Pulling);
+	CHECK(IsNear(Pull.Velocity, FSimVector(-5.0f / DeltaTime, 0.0f, -GravityZ * DeltaTime)));
+
+	// A Launcher fires UltraBall out once it reaches the center.
+	Field.isLauncher = true;
+	Field.LaunchDirection = FSimVector(0.0f, 0.0f, 1.0f);
+	Field.LaunchPower = 2.0f;
+	Pull = FUltraBallSim::GetFieldPull(FSimVector(5.0f, 0.0f, 0.0f), &Field, 1, GravityZ, DeltaTime);
+	CHECK(Pull.Result == ESimFieldResult::Launched);
+	CHECK(IsNear(Pull.Velocity, FUltraBallSim::GetLauncherVelocity(Field.LaunchDirection, Field.LaunchPower)));
+
+	// Overlapping fields don't add up to more than the fastest one.
+	FSimField Fields[2] = { Field, Field };
+	Fields[0].isLauncher = Fields[1].isLauncher = false;
+	Fields[1].Center = FSimVector(0.0f, 400.0f, 0.0f);
+	Pull = FUltraBallSim::GetFieldPull(FSimVector(200.0f, 200.0f, 0.0f), Fields, 2, 0.0f, DeltaTime);
+	CHECK(Pull.Velocity.Size() <= 800.0f + 1.e-2f);
+}
+
+static void TestBumperRefire()
+{
+	FSimWorld World;
+	FSimBumper Bumper;
+	Bumper.Trigger.HalfExtents = FSimVector(10.0f, 10.0f, 10.0f);
+	Bumper.Forward = FSimVector(1.0f, 0.0f, 0.0f);
+	Bumper.BouncePower = 2.0f;
+	World.Bumpers.push_back(Bumper);
+	World.Build(500.0f);
+
+	FSimSettings Settings;
+	Settings.GravityZ = 0.0f;
+	const FSimVector BumperVelocity = FUltraBallSim::GetBumperVelocity(Bumper.Forward, Bumper.BouncePower);
+
+	// Entering the trigger fires UltraBall.
+	FSimBallState State;
+	State.Location = FSimVector(-42.0f, 0.0f, 0.0f);
+	State.Velocity = FSimVector(600.0f, 0.0f, 0.0f);
+	FUltraBallSim::Step(World, Settings, State);
+	CHECK(IsNear(State.Velocity, BumperVelocity));
+	CHECK(State.InsideBumpers.size() == 1);
+
+	// Staying inside doesn't fire it again.
+	State.Location = FSimVector(-30.0f, 0.0f, 0.0f);
+	State.Velocity = FSimVector();
+	FUltraBallSim::Step(World, Settings, State);
+	CHECK(IsNear(State.Velocity, FSimVector()));
+	CHECK(State.InsideBumpers.size() == 1);
+
+	// Leaving lets it fire the next time UltraBall enters.
+	State.Location = FSimVector(-100.0f, 0.0f, 0.0f);
+	FUltraBallSim::Step(World, Settings, State);
+	CHECK(State.InsideBumpers.empty());
+	State.Location = FSimVector(-42.0f, 0.0f, 0.0f);
+	State.Velocity = FSimVector(600.0f, 0.0f, 0.0f);
+	FUltraBallSim::Step(World, Settings, State);
+	CHECK(IsNear(State.Velocity, BumperVelocity));
+}
+
+// A floor, a wall, a ramp, a bumper and a gravity well, so every rule is used along the way.
+static void BuildReferenceScene(FSimWorld& World)
+{
+	FSimBox Floor;
+	Floor.Center = FSimVector(0.0f, 0.0f, -50.0f);
+	Floor.HalfExtents = FSimVector(5000.0f, 5000.0f, 50.0f);
+	World.Boxes.push_back(Floor);
+	FSimBox Wall;
+	Wall.Center = FSimVector(2000.0f, 0.0f, 200.0f);
+	Wall.HalfExtents = FSimVector(50.0f, 1000.0f, 200.0f);
+	World.Boxes.push_back(Wall);
+	FSimTriangle Ramp;
+	Ramp.A = FSimVector(400.0f, -300.0f, 0.0f);
+	Ramp.B = FSimVector(800.0f, -300.0f, 100.0f);
+	Ramp.C = FSimVector(400.0f, 300.0f, 0.0f);
+	World.Triangles.push_back(Ramp);
+	FSimBumper Bumper;
+	Bumper.Trigger.Center = FSimVector(1200.0f, 0.0f, 30.0f);
+	Bumper.Trigger.HalfExtents = FSimVector(20.0f, 200.0f, 50.0f);
+	Bumper.Forward = FSimVector(0.0f, 1.0f, 0.2f).GetSafeNormal();
+	World.Bumpers.push_back(Bumper);
+	FSimField Well;
+	Well.Id = 7;
+	Well.Center = FSimVector(1200.0f, 1500.0f, 300.0f);
+	Well.Radius = 400.0f;
+	World.Fields.push_back(Well);
+	World.Build(500.0f);
+}
+
+static void TestSimulateShotIsDeterministic()
+{
+	FSimWorld World;
+	BuildReferenceScene(World);
+
+	FSimSettings Settings;
+	FSimBallState Start;
+	Start.Location = FSimVector(0.0f, 0.0f, Settings.BallRadius);
+	const FSimVector Launch = FUltraBallSim::GetLaunchVelocity(FSimVector(1.0f, 0.0f, 0.3f), 0.5f, 6.0f);
+
+	std::vector<FSimVector> PathA, PathB;
+	const FSimShotResult ResultA = FUltraBallSim::SimulateShot(World, Settings, Start, Launch, 10.0f, &PathA);
+	const FSimShotResult ResultB = FUltraBallSim::SimulateShot(World, Settings, Start, Launch, 10.0f, &PathB);
+
+	// The same shot gives exactly the same path, bit for bit.
+	CHECK(ResultA.Steps == ResultB.Steps);
+	CHECK(PathA.size() == PathB.size());
+	CHECK(PathA.size() == (size_t)ResultA.Steps + 1);
+	CHECK(PathA.size() == PathB.size() && std::memcmp(PathA.data(), PathB.data(), PathA.size() * sizeof(FSimVector)) == 0);
+	CHECK(std::memcmp(&ResultA.FinalState.Location, &ResultB.FinalState.Location, sizeof(FSimVector)) == 0);
+	CHECK(ResultA.FinalState.isAtRest == ResultB.FinalState.isAtRest);
+
+	// UltraBall never sinks into the floor.
+	for (const FSimVector& Location : PathA)
+		CHECK(Location.Z >= Settings.BallRadius - 1.0f);
+}
+
+// The shots played through the reference scene for its golden trajectories.
+struct FReferenceShot
+{
+	FSimVector Direction;
+	float Charge;
+};
+
+static const FReferenceShot ReferenceShots[] =
+{
+	{ FSimVector(1.0f, 0.0f, 0.3f), 0.5f },
+	{ FSimVector(1.0f, 0.2f, 0.1f), 1.0f },
+	{ FSimVector(0.6f, 1.0f, 0.5f), 0.8f },
+	{ FSimVector(-1.0f, 0.4f, 0.7f), 0.3f }
+};
+
+// How far a recorded location may be from its golden one. The files are written to a thousandth, so this only allows for rounding.
+static const float GoldenTolerance = 0.01f;
+
+// Play the reference shots, then save their paths to GoldenFile or check them against it.
+// The paths are written in the same form as the benchmark's golden trajectories.
+static void TestGoldenTrajectories(const char* GoldenFile, bool isRecording)
+{
+	FSimWorld World;
+	BuildReferenceScene(World);
+	FSimSettings Settings;
+	FSimBallState Start;
+	Start.Location = FSimVector(0.0f, 0.0f, Settings.BallRadius);
+
+	const int32_t NumShots = (int32_t)(sizeof(ReferenceShots) / sizeof(ReferenceShots[0]));
+	std::vector<std::vector<FSimVector>> Paths(NumShots);
+	for (int32_t Shot = 0; Shot < NumShots; Shot++)
+	{
+		const FSimVector Launch = FUltraBallSim::GetLaunchVelocity(ReferenceShots[Shot].Direction, ReferenceShots[Shot].Charge, 6.0f);
+		FUltraBallSim::SimulateShot(World, Settings, Start, Launch, 10.0f, &Paths[Shot]);
+	}
+
+	if (isRecording)
+	{
+		FILE* File = std::fopen(GoldenFile, "w");
+		CHECK(File != nullptr);
+		if (File == nullptr)
+			return;
+
+		std::fprintf(File, "Shot,Frame,X,Y,Z\n");
+		for (int32_t Shot = 0; Shot < NumShots; Shot++)
+		{
+			for (size_t Frame = 0; Frame < Paths[Shot].size(); Frame++)
+				std::fprintf(File, "%d,%d,%.3f,%.3f,%.3f\n", (int)Shot, (int)Frame, Paths[Shot][Frame].X, Paths[Shot][Frame].Y, Paths[Shot][Frame].Z);
+		}
+		std::fclose(File);
+		std::printf("Golden trajectories for %d shots written to %s.\n", (int)NumShots, GoldenFile);
+		return;
+	}
+
+	FILE* File = std::fopen(GoldenFile, "r");
+	if (File == nullptr)
+	{
+		std::printf("No golden trajectories to compare with at %s.\n", GoldenFile);
+		NumFailures++;
+		return;
+	}
+
+	// Read the golden paths, then check every shot strays no further than the tolerance and lasts as long.
+	std::vector<std::vector<FSimVector>> GoldenPaths(NumShots);
+	char Header[64];
+	int Shot, Frame;
+	FSimVector Location;
+	if (std::fgets(Header, sizeof(Header), File) != nullptr)
+	{
+		while (std::fscanf(File, "%d,%d,%f,%f,%f", &Shot, &Frame, &Location.X, &Location.Y, &Location.Z) == 5)
+		{
+			if (Shot >= 0 && Shot < NumShots)
+				GoldenPaths[Shot].push_back(Location);
+		}
+	}
+	std::fclose(File);
+
+	for (Shot = 0; Shot < NumShots; Shot++)
+	{
+		CHECK(Paths[Shot].size() == GoldenPaths[Shot].size());
+		for (size_t i = 0; i < Paths[Shot].size() && i < GoldenPaths[Shot].size(); i++)
+		{
+			if (!IsNear(Paths[Shot][i], GoldenPaths[Shot][i], GoldenTolerance))
+			{
+				std::printf("Shot %d strayed from its golden trajectory on frame %d.\n", Shot, (int)i);
+				NumFailures++;
+				break;
+			}
+		}
+	}
+}
+
+// Fill a batch with shots spread through a cone, like the Uncertainty Markers.
+static void FillUncertaintyBatch(FSimTrajectoryBatch& Batch, int32_t Count)
+{
+	Batch.Reset(Count);
+	for (int32_t i = 0; i < Count; i++)
+	{
+		const float Angle = i * 2.39996323f;
+		const float Spread = 0.3f * std::sqrt((i + 0.5f) / Count);
+		const FSimVector Direction(1.0f, std::cos(Angle) * Spread, 0.4f + std::sin(Angle) * Spread);
+		Batch.SetTrajectory(i, FSimVector(0.0f, 0.0f, 30.0f), FUltraBallSim::GetLaunchVelocity(Direction, 0.3f + 0.01f * (i % 7), 6.0f));
+	}
+}
+
+static void TestBatchKernelsAgree()
+{
+	FSimWorld World;
+	BuildReferenceScene(World);
+	FSimBox Turned;
+	Turned.Center = FSimVector(900.0f, 200.0f, 100.0f);
+	Turned.HalfExtents = FSimVector(150.0f, 40.0f, 100.0f);
+	Turned.AxisX = FSimVector(0.70710678f, 0.70710678f, 0.0f);
+	Turned.AxisY = FSimVector(-0.70710678f, 0.70710678f, 0.0f);
+	World.Boxes.push_back(Turned);
+
+	FSimBatchSettings Settings;
+	Settings.NumSteps = 90;
+	Settings.hasGroundPlane = false;
+
+	// An odd count, so the padding lanes are used too.
+	const int32_t Count = 101;
+	FSimTrajectoryBatch Scalar;
+	FillUncertaintyBatch(Scalar, Count);
+	FSimBatchIntegrator::Integrate(Scalar, Settings, World.Boxes.data(), (int32_t)World.Boxes.size(), FSimBatchIntegrator::EKernel::Scalar);
+
+	// The wide kernels only run where the CPU has them. Elsewhere they fall back to the scalar kernel.
+	std::vector<FSimBatchIntegrator::EKernel> Kernels = { FSimBatchIntegrator::EKernel::SSE };
+	if (FSimBatchIntegrator::GetBestKernel() == FSimBatchIntegrator::EKernel::AVX)
+		Kernels.push_back(FSimBatchIntegrator::EKernel::AVX);
+	for (FSimBatchIntegrator::EKernel Kernel : Kernels)
+	{
+		FSimTrajectoryBatch Wide;
+		FillUncertaintyBatch(Wide, Count);
+		FSimBatchIntegrator::Integrate(Wide, Settings, World.Boxes.data(), (int32_t)World.Boxes.size(), Kernel);
+		for (int32_t i = 0; i < Count; i++)
+		{
+			CHECK(Wide.HasLanded(i) == Scalar.HasLanded(i));
+			CHECK(IsNear(Wide.GetLocation(i), Scalar.GetLocation(i), 0.01f));
+		}
+	}
+
+	// Most shots land on something in the scene.
+	int32_t NumLanded = 0;
+	for (int32_t i = 0; i < Count; i++)
+		NumLanded += Scalar.HasLanded(i) ? 1 : 0;
+	CHECK(NumLanded > Count / 2);
+}
+
+static void TestBatchBroadphase()
+{
+	FSimBatchSettings Settings;
+	Settings.NumSteps = 90;
+	Settings.hasGroundPlane = false;
+
+	// A box turned 45 degrees about Z. A shot dropped past its corner misses it, though it is inside the box's bounds.
+	FSimBox Turned;
+	Turned.HalfExtents = FSimVector(100.0f, 100.0f, 100.0f);
+	Turned.AxisX = FSimVector(0.70710678f, 0.70710678f, 0.0f);
+	Turned.AxisY = FSimVector(-0.70710678f, 0.70710678f, 0.0f);
+	FSimTrajectoryBatch Batch;
+	Batch.Reset(2);
+	Batch.SetTrajectory(0, FSimVector(0.0f, 0.0f, 300.0f), FSimVector());
+	Batch.SetTrajectory(1, FSimVector(100.0f, 100.0f, 300.0f), FSimVector());
+	FSimBatchIntegrator::Integrate(Batch, Settings, &Turned, 1, FSimBatchIntegrator::EKernel::Scalar);
+	CHECK(Batch.HasLanded(0));
+	CHECK(IsNear(Batch.GetLocation(0).Z, 130.0f, 20.0f));
+	CHECK(!Batch.HasLanded(1));
+
+	// The swept bounds hold every step of every shot, and boxes outside them are left out.
+	FSimTrajectoryBatch Cone;
+	FillUncertaintyBatch(Cone, 64);
+	const FSimAabb Bounds = FSimBatchIntegrator::GetSweptBounds(Cone, Settings);
+	for (int32_t i = 0; i < Cone.Count; i++)
+	{
+		FSimVector Location = Cone.GetLocation(i);
+		FSimVector Velocity(Cone.VX[i], Cone.VY[i], Cone.VZ[i]);
+		for (int32_t Step = 0; Step < Settings.NumSteps; Step++)
+		{
+			Velocity.Z += Settings.GravityZ * Settings.TimeStep;
+			Location += Velocity * Settings.TimeStep;
+			CHECK(Bounds.Overlaps({ Location, Location }));
+		}
+	}
+
+	FSimBox Boxes[2];
+	Boxes[0].Center = FSimVector(1000.0f, 0.0f, 0.0f);
+	Boxes[0].HalfExtents = FSimVector(100.0f, 100.0f, 100.0f);
+	Boxes[1].Center = FSimVector(-5000.0f, 0.0f, 0.0f);
+	Boxes[1].HalfExtents = FSimVector(100.0f, 100.0f, 100.0f);
+	FSimBatchIntegrator::GatherNearbyBoxes(Cone, Settings, Boxes, 2);
+	CHECK(Cone.NearbyBoxes.size() == 1);
+	CHECK(Cone.NearbyBoxes.size() == 1 && IsNear(Cone.NearbyBoxes[0].HalfExtents.X, 100.0f + Settings.BallRadius));
+}
+
+// Returns true if two rotations are the same, allowing for q and -q being the same rotation.
+static bool IsSameRotation(const FSimQuat& A, const FSimQuat& B, float Tolerance = 1.e-3f)
+{
+	return std::fabs(A.X * B.X + A.Y * B.Y + A.Z * B.Z + A.W * B.W) >= 1.0f - Tolerance;
+}
+
+// The sample recorded at an index of the replay test. It rolls, rests, then rolls again, and its rotation flips sign.
+static FReplaySample GetReplayTestSample(uint32_t Index)
+{
+	FReplaySample Sample;
+	const float Time = (Index < 200 ? Index : Index < 400 ? 200 : Index - 200) / 30.0f;
+	Sample.Location = FSimVector(Time * 310.0f, -Time * 45.5f, 30.0f + std::fabs(std::sin(Time)) * 120.0f);
+	const float HalfAngle = Time * 1.7f;
+	const FSimVector Axis = FSimVector(0.3f, 1.0f, 0.2f).GetSafeNormal();
+	const float Sign = Index % 3 == 0 ? -1.0f : 1.0f;
+	Sample.Rotation.X = Axis.X * std::sin(HalfAngle) * Sign;
+	Sample.Rotation.Y = Axis.Y * std::sin(HalfAngle) * Sign;
+	Sample.Rotation.Z = Axis.Z * std::sin(HalfAngle) * Sign;
+	Sample.Rotation.W = std::cos(HalfAngle) * Sign;
+	Sample.ZoneState = (uint8_t)(Index / 100 % 3);
+	return Sample;
+}
+
+static void TestReplayRoundTrip()
+{
+	const float PositionQuantum = 0.1f;
+	const uint32_t NumSamples = 600;
+	FReplayEncoder Encoder(30.0f, PositionQuantum, "ReferenceScene", 1700000000);
+	std::vector<uint8_t> Bytes(sizeof(FReplayHeader));
+	std::memcpy(Bytes.data(), &Encoder.GetHeader(), sizeof(FReplayHeader));
+
+	// Write the chunks as the Replay Subsystem does, remembering where the last one starts.
+	std::vector<uint8_t> Chunk;
+	size_t LastChunkOffset = 0;
+	for (uint32_t i = 0; i < NumSamples; i++)
+	{
+		if (i == 50 || i == 450)
+		{
+			FReplayEvent Shot;
+			Shot.Par = i == 50 ? 1 : 2;
+			Shot.Charge = 0.5f;
+			Shot.Velocity = FSimVector(1500.0f, 0.0f, 450.0f);
+			Encoder.AddEvent(Shot);
+		}
+		Encoder.AddSample(GetReplayTestSample(i));
+		if (Encoder.IsChunkFull() || i + 1 == NumSamples)
+		{
+			Encoder.TakeChunk(Chunk);
+			LastChunkOffset = Bytes.size();
+			Bytes.insert(Bytes.end(), Chunk.begin(), Chunk.end());
+		}
+	}
+
+	// A ball at rest costs a byte a sample, even when its rotation flips sign.
+	FReplayEncoder RestEncoder(30.0f, PositionQuantum, "ReferenceScene", 1700000000);
+	RestEncoder.AddSample(GetReplayTestSample(200));
+	RestEncoder.TakeChunk(Chunk);
+	FReplayChunkHeader MovingHeader;
+	std::memcpy(&MovingHeader, Chunk.data(), sizeof(MovingHeader));
+	for (uint32_t i = 0; i < 101; i++)
+		RestEncoder.AddSample(GetReplayTestSample(200 + i % 2));
+	RestEncoder.TakeChunk(Chunk);
+	FReplayChunkHeader RestHeader;
+	std::memcpy(&RestHeader, Chunk.data(), sizeof(RestHeader));
+	CHECK(RestHeader.NumSamples == 101);
+	CHECK(RestHeader.SampleBytes <= MovingHeader.SampleBytes + 100 + 3);
+
+	const std::string Path = GetScratchPath("UltraBallSimTests.ubreplay");
+	CHECK(WriteScratchFile(Path, Bytes));
+	FReplayReader Reader;
+	CHECK(Reader.Open(Path));
+	CHECK(Reader.GetNumSamples() == NumSamples);
+	CHECK(std::strcmp(Reader.GetHeader().LevelName, "ReferenceScene") == 0);
+	for (uint32_t i = 0; i < Reader.GetNumSamples(); i++)
+	{
+		const FReplaySample Expected = GetReplayTestSample(i);
+		FReplaySample Sample;
+		CHECK(Reader.GetSample(i, Sample));
+		CHECK(IsNear(Sample.Location, Expected.Location, PositionQuantum * 0.5f + 1.e-3f));
+		CHECK(IsSameRotation(Sample.Rotation, Expected.Rotation));
+		CHECK(Sample.ZoneState == Expected.ZoneState);
+	}
+	FReplaySample Sample;
+	CHECK(!Reader.GetSample(NumSamples, Sample));
+
+	// Halfway between two samples, the rotation blends the short way round even though their signs differ.
+	CHECK(Reader.GetSampleAtTime(2.5f / 30.0f, Sample));
+	CHECK(IsNear(Sample.Location, (GetReplayTestSample(2).Location + GetReplayTestSample(3).Location) * 0.5f, 0.1f));
+	CHECK(IsSameRotation(Sample.Rotation, GetReplayTestSample(2).Rotation, 2.e-3f));
+
+	std::vector<FReplayEvent> Events;
+	Reader.GetEvents(0, NumSamples, Events);
+	CHECK(Events.size() == 2);
+	CHECK(Events.size() == 2 && Events[0].Sample == 50 && Events[0].Par == 1 && Events[1].Sample == 450 && Events[1].Par == 2);
+	Events.clear();
+	Reader.GetEvents(100, 449, Events);
+	CHECK(Events.empty());
+	Reader.Close();
+
+	// A recording cut short in its last chunk is read up to the last whole chunk.
+	Bytes.resize(LastChunkOffset + (Bytes.size() - LastChunkOffset) / 2);
+	CHECK(WriteScratchFile(Path, Bytes));
+	CHECK(Reader.Open(Path));
+	CHECK(Reader.GetNumSamples() == 2 * Replay::ChunkSamples);
+	CHECK(Reader.GetSample(2 * Replay::ChunkSamples - 1, Sample));
+	CHECK(IsNear(Sample.Location, GetReplayTestSample(2 * Replay::ChunkSamples - 1).Location, PositionQuantum));
+	CHECK(!Reader.GetSample(2 * Replay::ChunkSamples, Sample));
+	Reader.Close();
+
+	// Anything that isn't a replay is refused.
+	Bytes.resize(sizeof(FReplayHeader));
+	Bytes[0] ^= 0xFF;
+	CHECK(WriteScratchFile(Path, Bytes));
+	CHECK(!Reader.Open(Path));
+	std::remove(Path.c_str());
+}
+
+static void TestLevelSnapshot()
+{
+	FSimWorld World;
+	BuildReferenceScene(World);
+	FLevelSnapshotInfo Info;
+	Info.BallLocation = FSimVector(0.0f, 0.0f, 30.0f);
+	Info.MaxParAllowed = 4;
+	Info.MaxChargePossibleAtFullChargeUp = 6.0f;
+
+	const std::string Path = GetScratchPath("UltraBallSimTests.ubsnapshot");
+	CHECK(FLevelSnapshot::Write(Path, World, Info));
+	FLevelSnapshot Snapshot;
+	CHECK(Snapshot.Open(Path));
+	if (!Snapshot.IsOpen())
+		return;
+
+	size_t NumBoxes, NumBumpers, NumFields;
+	const FSimBox* Boxes = Snapshot.GetBoxes(NumBoxes);
+	Snapshot.GetBumpers(NumBumpers);
+	Snapshot.GetFields(NumFields);
+	CHECK(NumBoxes == World.Boxes.size() && NumBumpers == World.Bumpers.size() && NumFields == World.Fields.size());
+	CHECK(NumBoxes == World.Boxes.size() && std::memcmp(Boxes, World.Boxes.data(), NumBoxes * sizeof(FSimBox)) == 0);
+	CHECK(Snapshot.GetInfo().MaxParAllowed == 4);
+	CHECK(IsNear(Snapshot.GetInfo().BallLocation, Info.BallLocation));
+
+	// A shot through the mapped level follows exactly the same path as through the level it was written from.
+	FSimWorld Mapped;
+	Snapshot.CopyToWorld(Mapped);
+	FSimSettings Settings;
+	FSimBallState Start;
+	Start.Location = Info.BallLocation;
+	const FSimVector Launch = FUltraBallSim::GetLaunchVelocity(ReferenceShots[1].Direction, ReferenceShots[1].Charge, 6.0f);
+	std::vector<FSimVector> ShotPath, MappedPath;
+	FUltraBallSim::SimulateShot(World, Settings, Start, Launch, 10.0f, &ShotPath);
+	FUltraBallSim::SimulateShot(Mapped, Settings, Start, Launch, 10.0f, &MappedPath);
+	CHECK(ShotPath.size() == MappedPath.size() && std::memcmp(ShotPath.data(), MappedPath.data(), ShotPath.size() * sizeof(FSimVector)) == 0);
+	Snapshot.Close();
+
+	// Damaged snapshots are refused rather than read past their end.
+	std::vector<uint8_t> Bytes;
+	CHECK(ReadScratchFile(Path, Bytes));
+	std::vector<uint8_t> Damaged(Bytes.begin(), Bytes.begin() + Bytes.size() / 2);
+	CHECK(WriteScratchFile(Path, Damaged));
+	CHECK(!Snapshot.Open(Path));
+
+	Damaged = Bytes;
+	Damaged[0] ^= 0xFF;
+	CHECK(WriteScratchFile(Path, Damaged));
+	CHECK(!Snapshot.Open(Path));
+
+	FLevelSnapshotHeader Header;
+	std::memcpy(&Header, Bytes.data(), sizeof(Header));
+	Header.Sections[LevelSnapshot::Boxes].Count = Bytes.size();
+	Damaged = Bytes;
+	std::memcpy(Damaged.data(), &Header, sizeof(Header));
+	CHECK(WriteScratchFile(Path, Damaged));
+	CHECK(!Snapshot.Open(Path));
+
+	Damaged.resize(sizeof(FLevelSnapshotHeader) - 1);
+	CHECK(WriteScratchFile(Path, Damaged));
+	CHECK(!Snapshot.Open(Path));
+	std::remove(Path.c_str());
+}
+
+static void TestDistanceField()
+{
+	// A block and a box turned 30 degrees about Z, sitting apart.
+	FSimWorld World;
+	FSimBox Block;
+	Block.Center = FSimVector(0.0f, 0.0f, 50.0f);
+	Block.HalfExtents = FSimVector(100.0f, 80.0f, 50.0f);
+	World.Boxes.push_back(Block);
+	FSimBox Turned;
+	Turned.Center = FSimVector(400.0f, 100.0f, 60.0f);
+	Turned.HalfExtents = FSimVector(120.0f, 40.0f, 60.0f);
+	Turned.AxisX = FSimVector(0.8660254f, 0.5f, 0.0f);
+	Turned.AxisY = FSimVector(-0.5f, 0.8660254f, 0.0f);
+	World.Boxes.push_back(Turned);
+	World.Build(200.0f);
+
+	const float VoxelSize = 10.0f;
+	const float Band = 60.0f;
+	const std::string Path = GetScratchPath("UltraBallSimTests.ubsdf");
+	FSimThreadPool ThreadPool(2);
+	CHECK(FSimDistanceField::Bake(Path, World, VoxelSize, Band, ThreadPool));
+	FSimDistanceField Field;
+	CHECK(Field.Open(Path));
+	if (!Field.IsOpen())
+		return;
+	CHECK(IsNear(Field.GetVoxelSize(), VoxelSize) && IsNear(Field.GetBand(), Band));
+
+	// Within the band, the field matches the exact distance to within a voxel's blending and a byte's rounding.
+	// Further out it holds the band.
+	const float Tolerance = VoxelSize * 0.5f + Band * 2.0f / 255.0f;
+	int32_t NumInBand = 0;
+	for (float Z = -40.0f; Z <= 200.0f; Z += 13.0f)
+		for (float Y = -200.0f; Y <= 300.0f; Y += 17.0f)
+			for (float X = -200.0f; X <= 600.0f; X += 19.0f)
+			{
+				const FSimVector Point(X, Y, Z);
+				const float Exact = std::min(FUltraBallSim::GetBoxDistance(Point, Block), FUltraBallSim::GetBoxDistance(Point, Turned));
+				const float Distance = Field.GetDistance(Point);
+				if (Exact < Band - Tolerance)
+				{
+					NumInBand++;
+					CHECK(IsNear(Distance, std::max(Exact, -Band), Tolerance));
+				}
+				else if (Exact > Band + Tolerance)
+					CHECK(IsNear(Distance, Band, Tolerance));
+			}
+	CHECK(NumInBand > 1000);
+
+	// The normal points away from the nearest face, and is zero out of the band.
+	FSimVector Normal;
+	CHECK(IsNear(Field.GetDistanceAndNormal(FSimVector(0.0f, 0.0f, 130.0f), Normal), 30.0f, Tolerance));
+	CHECK(IsNear(Normal, FSimVector(0.0f, 0.0f, 1.0f), 0.05f));
+	CHECK(IsNear(Field.GetDistanceAndNormal(Turned.Center + Turned.AxisY * 70.0f, Normal), 30.0f, Tolerance));
+	CHECK(IsNear(Normal, Turned.AxisY, 0.05f));
+	CHECK(IsNear(Field.GetDistanceAndNormal(FSimVector(0.0f, 0.0f, 2000.0f), Normal), Band));
+	CHECK(IsNear(Normal, FSimVector()));
+	Field.Close();
+
+	// A file cut short is refused.
+	std::vector<uint8_t> Bytes;
+	CHECK(ReadScratchFile(Path, Bytes));
+	Bytes.resize(Bytes.size() - 1);
+	CHECK(WriteScratchFile(Path, Bytes));
+	CHECK(!Field.Open(Path));
+	std::remove(Path.c_str());
+}
+
+static void TestParSolverBatches()
+{
+	FSimWorld World;
+	BuildReferenceScene(World);
+	FSimFinish Finish;
+	Finish.Center = FSimVector(1600.0f, 600.0f, 30.0f);
+	Finish.Radius = 80.0f;
+	World.Finishes.push_back(Finish);
+
+	FSimSettings SimSettings;
+	FParSolverSettings Settings;
+	Settings.NumYawSteps = 16;
+	Settings.NumPitchSteps = 2;
+	Settings.NumChargeSteps = 4;
+	Settings.MaxChargePossibleAtFullChargeUp = 6.0f;
+	Settings.MaxPar = 3;
+	Settings.MaxShotTime = 8.0f;
+	FSimThreadPool ThreadPool(4);
+
+	// Small batches find exactly the same solution as one big batch, and never simulate more shots.
+	const FSimVector Start(0.0f, 0.0f, SimSettings.BallRadius);
+	const FParSolution Whole = FParSolver(World, SimSettings, Settings, ThreadPool).Solve(Start);
+	Settings.ShotsPerBatch = 16;
+	const FParSolution Batched = FParSolver(World, SimSettings, Settings, ThreadPool).Solve(Start);
+	CHECK(Whole.isSolved);
+	CHECK(Batched.isSolved == Whole.isSolved && Batched.Par == Whole.Par);
+	CHECK(Batched.Shots.size() == Whole.Shots.size() && Batched.Shots.size() == (size_t)Whole.Par);
+	for (size_t i = 0; i < Batched.Shots.size() && i < Whole.Shots.size(); i++)
+		CHECK(IsNear(Batched.Shots[i].Landing, Whole.Shots[i].Landing, 0.0f) && Batched.Shots[i].Charge == Whole.Shots[i].Charge);
+	CHECK(Batched.SimulatedShots <= Whole.SimulatedShots);
+}
+
+// Usage: UltraBallSimTests [Golden trajectory file] [Record]
+int main(int argc, char** argv)
+{
+	TestCollideSphereBox();
+	TestCollideSphereTriangle();
+	TestFieldPull();
+	TestBumperRefire();
+	TestSimulateShotIsDeterministic();
+	TestBatchKernelsAgree();
+	TestBatchBroadphase();
+	TestReplayRoundTrip();
+	TestLevelSnapshot();
+	TestDistanceField();
+	TestParSolverBatches();
+	if (argc > 1)
+		TestGoldenTrajectories(argv[1], argc > 2 && std::strcmp(argv[2], "Record") == 0);
+
+	if (NumFailures > 0)
+	{
+		std::printf("%d checks failed.\n", NumFailures);
+		return 1;
+	}
+	std::printf("All simulation checks passed.\n");
+	return 0;
+}